@@ -0,0 +1,383 @@
+#ifndef _ALLOY_ALIGNED_BUFFER_HPP
+#define _ALLOY_ALIGNED_BUFFER_HPP
+#pragma once
+
+#include "memlayout.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace alloy {
+
+//
+// SIMD ready arrays.
+//
+// `aligned_buffer<T, Align>` (fixed size) and `aligned_vector<T, Align>`
+// (growable) keep their elements in storage aligned to `Align` bytes, 64 by
+// default for AVX-512 and cache lines, 32 for AVX2, and padded to a whole
+// number of `Align` byte vectors. The storage layout is
+// `Layout::create<T>().repeat(n)` raised with `align_to(Align)` and rounded
+// with `pad_to_align()`.
+//
+// The elements past `size()`, up to `padded_size()`, are always zero, so a
+// kernel can run over whole vectors with aligned loads and no scalar
+// remainder loop, as long as zeros are neutral for it:
+//
+//     alloy::aligned_vector<float> xs = load();
+//     const float *p = xs.data();           // std::assume_aligned<64>
+//     for (size_t i = 0; i < xs.padded_size(); i += xs.lanes) {
+//         __m512 v = _mm512_load_ps(p + i); // never faults, never peels
+//         ...
+//     }
+//
+// Elements are trivially copyable and tile a vector: `Align` is a multiple
+// of `sizeof(T)`.
+//
+
+namespace details {
+
+// storage for `n` elements of `T`, aligned and padded to `Align`.
+template <typename T, size_t Align>
+M_CEXPR std::optional<Layout> simd_layout(size_t n) noexcept {
+    if (auto array = Layout::of<T>().repeat(n)) {
+        if (auto aligned = array.value().first.align_to(Align)) {
+            return aligned.value().pad_to_align();
+        }
+    }
+    return {};
+}
+
+template <typename T, size_t Align> struct simd_traits {
+    static_assert(std::is_trivially_copyable_v<T> &&
+                      std::is_trivially_default_constructible_v<T>,
+                  "SIMD buffers hold trivial elements");
+    static_assert(is_power_of_two(Align) && Align >= alignof(T),
+                  "alignment must be a power of two, at least the element's");
+    static_assert(Align % sizeof(T) == 0,
+                  "elements must tile an Align byte vector");
+
+    static constexpr size_t lanes = Align / sizeof(T);
+
+    // `n` rounded up to whole vectors, saturated so that too large sizes
+    // still fail `simd_layout`.
+    static M_CEXPR size_t padded(size_t n) noexcept {
+        if (n > std::numeric_limits<size_t>::max() - lanes) {
+            return std::numeric_limits<size_t>::max();
+        }
+        return (n + lanes - 1) / lanes * lanes;
+    }
+
+    static T *allocate(Layout layout) {
+        return static_cast<T *>(
+            ::operator new(layout.size(), std::align_val_t(Align)));
+    }
+
+    static void deallocate(T *p) noexcept {
+        ::operator delete(p, std::align_val_t(Align));
+    }
+};
+
+} // namespace details
+
+//
+// Fixed size aligned array, zero initialized.
+//
+
+template <typename T, size_t Align = 64> class aligned_buffer {
+    using traits = details::simd_traits<T, Align>;
+
+    T *data_;
+    size_t size_;
+
+  public:
+    using value_type = T;
+    using iterator = T *;
+    using const_iterator = const T *;
+
+    static constexpr size_t alignment = Align;
+    static constexpr size_t lanes = traits::lanes;
+
+    // storage layout of `n` elements.
+    static M_CEXPR std::optional<Layout> layout_for(size_t n) noexcept {
+        return details::simd_layout<T, Align>(n);
+    }
+
+    aligned_buffer() noexcept
+        : data_(nullptr)
+        , size_(0) {}
+
+    explicit aligned_buffer(size_t n)
+        : aligned_buffer() {
+        if (size_t bytes = allocate(n)) {
+            std::memset(static_cast<void *>(data_), 0, bytes);
+        }
+    }
+
+    aligned_buffer(size_t n, const T &value)
+        : aligned_buffer(n) {
+        std::fill_n(data_, n, value);
+    }
+
+    aligned_buffer(std::initializer_list<T> values)
+        : aligned_buffer(values.size()) {
+        std::copy(values.begin(), values.end(), data_);
+    }
+
+    aligned_buffer(const aligned_buffer &other)
+        : aligned_buffer() {
+        allocate(other.size_);
+        copy_padded(other.data_);
+    }
+
+    aligned_buffer(aligned_buffer &&other) noexcept
+        : data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0)) {}
+
+    aligned_buffer &operator=(aligned_buffer other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~aligned_buffer() {
+        if (data_) {
+            traits::deallocate(data_);
+        }
+    }
+
+    void swap(aligned_buffer &other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+    }
+
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    // `size()` rounded up to whole vectors; the elements in between are 0.
+    size_t padded_size() const noexcept { return traits::padded(size_); }
+
+    T *data() noexcept { return std::assume_aligned<Align>(data_); }
+    const T *data() const noexcept {
+        return std::assume_aligned<Align>(data_);
+    }
+
+    std::span<T> span() noexcept { return { data(), size_ }; }
+    std::span<const T> span() const noexcept { return { data(), size_ }; }
+
+    // every element of the storage, padding included.
+    std::span<T> padded_span() noexcept { return { data(), padded_size() }; }
+    std::span<const T> padded_span() const noexcept {
+        return { data(), padded_size() };
+    }
+
+    T &operator[](size_t i) noexcept { return data_[i]; }
+    const T &operator[](size_t i) const noexcept { return data_[i]; }
+
+    iterator begin() noexcept { return data_; }
+    iterator end() noexcept { return data_ + size_; }
+    const_iterator begin() const noexcept { return data_; }
+    const_iterator end() const noexcept { return data_ + size_; }
+
+  private:
+    template <typename, size_t> friend class aligned_vector;
+
+    struct uninitialized_t {};
+
+    // storage for `n` elements with only the padding zeroed.
+    aligned_buffer(size_t n, uninitialized_t)
+        : aligned_buffer() {
+        if (size_t bytes = allocate(n)) {
+            std::memset(static_cast<void *>(data_ + n), 0,
+                        bytes - n * sizeof(T));
+        }
+    }
+
+    // bytes of storage, padding included.
+    size_t allocate(size_t n) {
+        auto layout = layout_for(n);
+        if (!layout) {
+            throw std::length_error("aligned_buffer is too large");
+        }
+        if (n) {
+            data_ = traits::allocate(layout.value());
+        }
+        size_ = n;
+        return layout.value().size();
+    }
+
+    void copy_padded(const T *from) noexcept {
+        if (size_) {
+            std::memcpy(static_cast<void *>(data_), from,
+                        padded_size() * sizeof(T));
+        }
+    }
+};
+
+//
+// Growable aligned array, zero past its size up to its capacity.
+//
+
+template <typename T, size_t Align = 64> class aligned_vector {
+    using buffer_type = aligned_buffer<T, Align>;
+    using traits = details::simd_traits<T, Align>;
+
+    buffer_type storage_; // `storage_.size()` is the capacity.
+    size_t size_;
+
+  public:
+    using value_type = T;
+    using iterator = T *;
+    using const_iterator = const T *;
+
+    static constexpr size_t alignment = Align;
+    static constexpr size_t lanes = traits::lanes;
+
+    aligned_vector() noexcept
+        : size_(0) {}
+
+    explicit aligned_vector(size_t n)
+        : storage_(traits::padded(n))
+        , size_(n) {}
+
+    aligned_vector(size_t n, const T &value)
+        : aligned_vector(n) {
+        std::fill_n(storage_.data(), n, value);
+    }
+
+    aligned_vector(std::initializer_list<T> values)
+        : aligned_vector(values.size()) {
+        std::copy(values.begin(), values.end(), storage_.data());
+    }
+
+    aligned_vector(const aligned_vector &) = default;
+
+    aligned_vector(aligned_vector &&other) noexcept
+        : storage_(std::move(other.storage_))
+        , size_(std::exchange(other.size_, 0)) {}
+
+    aligned_vector &operator=(aligned_vector other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    void swap(aligned_vector &other) noexcept {
+        storage_.swap(other.storage_);
+        std::swap(size_, other.size_);
+    }
+
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    size_t capacity() const noexcept { return storage_.size(); }
+
+    // `size()` rounded up to whole vectors; the elements in between are 0.
+    size_t padded_size() const noexcept { return traits::padded(size_); }
+
+    T *data() noexcept { return storage_.data(); }
+    const T *data() const noexcept { return storage_.data(); }
+
+    std::span<T> span() noexcept { return { data(), size_ }; }
+    std::span<const T> span() const noexcept { return { data(), size_ }; }
+
+    std::span<T> padded_span() noexcept { return { data(), padded_size() }; }
+    std::span<const T> padded_span() const noexcept {
+        return { data(), padded_size() };
+    }
+
+    T &operator[](size_t i) noexcept { return storage_[i]; }
+    const T &operator[](size_t i) const noexcept { return storage_[i]; }
+
+    T &back() noexcept { return storage_[size_ - 1]; }
+    const T &back() const noexcept { return storage_[size_ - 1]; }
+
+    iterator begin() noexcept { return data(); }
+    iterator end() noexcept { return data() + size_; }
+    const_iterator begin() const noexcept { return data(); }
+    const_iterator end() const noexcept { return data() + size_; }
+
+    void reserve(size_t n) {
+        if (n > capacity()) {
+            reallocate(traits::padded(n));
+        }
+    }
+
+    // `value` may be an element: it is copied before the storage grows.
+    void push_back(const T &value) {
+        T copy = value;
+        if (size_ == capacity()) {
+            grow(size_ + 1);
+        }
+        storage_[size_++] = copy;
+    }
+
+    void pop_back() noexcept {
+        storage_[--size_] = T{};
+    }
+
+    // new elements are zero.
+    void resize(size_t n) {
+        if (n > capacity()) {
+            grow(n);
+        } else if (n < size_) {
+            zero(n, size_);
+        }
+        size_ = n;
+    }
+
+    void resize(size_t n, const T &value) {
+        T copy = value;
+        size_t old = size_;
+        resize(n);
+        if (n > old) {
+            std::fill(data() + old, data() + n, copy);
+        }
+    }
+
+    void clear() noexcept {
+        zero(0, size_);
+        size_ = 0;
+    }
+
+    void shrink_to_fit() {
+        if (traits::padded(size_) < capacity()) {
+            reallocate(traits::padded(size_));
+        }
+    }
+
+  private:
+    void zero(size_t first, size_t last) noexcept {
+        if (first == last) {
+            return;
+        }
+        std::memset(static_cast<void *>(data() + first), 0,
+                    (last - first) * sizeof(T));
+    }
+
+    void grow(size_t n) {
+        reallocate(traits::padded(std::max(n, 2 * capacity())));
+    }
+
+    // capacities are whole vectors, so the new storage has no padding of its
+    // own and everything past `size_` is zeroed here.
+    void reallocate(size_t capacity) {
+        buffer_type storage(capacity, typename buffer_type::uninitialized_t());
+        if (size_) {
+            std::memcpy(static_cast<void *>(storage.data()), data(),
+                        size_ * sizeof(T));
+        }
+        storage_.swap(storage);
+        if (capacity > size_) {
+            zero(size_, capacity);
+        }
+    }
+};
+
+} // namespace alloy
+
+#endif
@@ -0,0 +1,585 @@
+#ifndef _ALLOY_ALLOCATION_TRACE_HPP
+#define _ALLOY_ALLOCATION_TRACE_HPP
+#pragma once
+
+#include "allocator.hpp"
+#include "memlayout.hpp"
+#include "record_file.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace alloy {
+
+//
+// Allocation tracing and replay.
+//
+// `Traced<A>` is a `LayoutAllocator` that forwards to `A` and records every
+// call (time, thread, operation, layout and pointer) as a `TraceEvent` into
+// a `Tracer`. Each thread records into a lock-free ring of its own; full
+// rings, `flush()` and the destructor drain the rings into a record file
+// (`alloy/record_file.hpp`), on disk or in memory.
+//
+//     alloy::Tracer tracer(
+//         alloy::RecordWriter<alloy::TraceEvent>::create("app.trace").value());
+//     alloy::Traced<alloy::SlabAllocator> slab(tracer);
+//     ...                                   // run the workload on `slab`
+//     tracer.finish();
+//
+// `replay(events, allocator)` runs a trace against any allocator and
+// reports its throughput, the resident memory it took and how much of that
+// held live blocks, so size classes and chunk sizes can be tuned offline on
+// a captured workload. `tools/trace_replay.cpp` does it from the command
+// line.
+//
+// A deallocation is recorded before the block is given back and an
+// allocation after the block is handed out, so a block reused by another
+// thread is always freed before it is allocated again in trace order.
+//
+
+enum class TraceOp : uint8_t { allocate = 0, deallocate = 1, reset = 2 };
+
+// one call into a traced allocator.
+struct TraceEvent {
+    uint64_t time;   // nanoseconds since the tracer was created.
+    uint64_t ptr;    // the block, 0 for a failed allocation or a reset.
+    uint64_t size;   // layout of the block.
+    uint32_t align;
+    uint16_t thread; // index of the recording thread in the trace.
+    uint8_t op;      // a `TraceOp`.
+    uint8_t reserved;
+};
+
+static_assert(sizeof(TraceEvent) == 32);
+
+//
+// Collects the events of every thread and streams them to a record file.
+//
+// Threads get a ring of `ring_size` events the first time they record. A
+// thread whose ring is full drains every ring under the tracer's lock, so
+// recording only blocks on that lock once every `ring_size` events. Events
+// reach the file ring by ring: in order for each thread, sorted by time by
+// the replay.
+//
+// Rings of exited threads are adopted by new threads, which then record
+// under the same thread index. No thread may record while the tracer is
+// destroyed.
+//
+
+class Tracer {
+    struct alignas(64) Ring {
+        // written by the thread draining the rings, under the tracer lock.
+        std::atomic<size_t> head{ 0 };
+        // written by the recording thread.
+        alignas(64) std::atomic<size_t> tail{ 0 };
+        std::atomic<bool> active{ false };
+        uint16_t thread = 0;
+        std::unique_ptr<TraceEvent[]> events;
+    };
+
+    // per thread list of the rings it holds, one per live tracer.
+    struct ThreadRings {
+        struct Entry {
+            uint64_t id;
+            Ring *ring;
+        };
+        Entry last{ 0, nullptr };
+        std::vector<Entry> entries;
+
+        ~ThreadRings() {
+            for (auto &e : entries) {
+                abandon(e.id, e.ring);
+            }
+        }
+    };
+
+  public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr size_t default_ring_size = 4096;
+
+  private:
+    uint64_t id_;
+    size_t ring_mask_;
+    clock::time_point start_;
+    std::mutex mutex_; // guards `rings_`, `writer_` and draining.
+    std::vector<std::unique_ptr<Ring>> rings_;
+    RecordWriter<TraceEvent> writer_;
+    std::atomic<size_t> lost_;
+
+  public:
+    // record into `writer`, a file from `RecordWriter::create` or a buffer
+    // in memory. `ring_size` is rounded up to a power of two.
+    explicit Tracer(RecordWriter<TraceEvent> writer = {},
+                    size_t ring_size = default_ring_size)
+        : id_(register_tracer())
+        , ring_mask_(std::bit_ceil(std::max<size_t>(ring_size, 2)) - 1)
+        , start_(clock::now())
+        , writer_(std::move(writer))
+        , lost_(0) {}
+
+    Tracer(const Tracer &) = delete;
+    Tracer &operator=(const Tracer &) = delete;
+
+    ~Tracer() {
+        unregister_tracer(id_);
+        flush();
+    }
+
+    // events that could not be written, the writer failed to grow.
+    size_t lost() const noexcept {
+        return lost_.load(std::memory_order_relaxed);
+    }
+
+    // events written so far, not counting the ones still in the rings.
+    size_t size() noexcept {
+        std::lock_guard lock(mutex_);
+        return writer_.size();
+    }
+
+    // the record file written so far, when tracing to memory. Call
+    // `flush()` first to include every event recorded.
+    std::span<const std::byte> bytes() noexcept {
+        std::lock_guard lock(mutex_);
+        return writer_.bytes();
+    }
+
+    void record(TraceOp op, const void *ptr, Layout layout) noexcept {
+        Ring *r = local_ring();
+        if (r == nullptr) {
+            lost_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock::now() - start_);
+        size_t tail = r->tail.load(std::memory_order_relaxed);
+        if (tail - r->head.load(std::memory_order_acquire) > ring_mask_) {
+            flush();
+        }
+        r->events[tail & ring_mask_] = {
+            static_cast<uint64_t>(time.count()),
+            reinterpret_cast<uintptr_t>(ptr),
+            layout.size(),
+            static_cast<uint32_t>(layout.align()),
+            r->thread,
+            static_cast<uint8_t>(op),
+            0
+        };
+        r->tail.store(tail + 1, std::memory_order_release);
+    }
+
+    // drain every ring into the file.
+    void flush() noexcept {
+        std::lock_guard lock(mutex_);
+        for (auto &r : rings_) {
+            size_t head = r->head.load(std::memory_order_relaxed);
+            size_t tail = r->tail.load(std::memory_order_acquire);
+            while (head != tail) {
+                size_t first = head & ring_mask_;
+                size_t n = std::min(tail - head, ring_mask_ + 1 - first);
+                if (!writer_.append({ r->events.get() + first, n })) {
+                    lost_.fetch_add(n, std::memory_order_relaxed);
+                }
+                head += n;
+            }
+            r->head.store(head, std::memory_order_release);
+        }
+    }
+
+    // flush, then trim and sync the file.
+    bool finish() noexcept {
+        flush();
+        std::lock_guard lock(mutex_);
+        return writer_.finish();
+    }
+
+  private:
+    //
+    // Thread to ring mapping.
+    //
+
+    static inline ThreadRings &thread_rings() noexcept {
+        static thread_local ThreadRings rings;
+        return rings;
+    }
+
+    // ids of live tracers. A thread exiting after its tracer is gone must
+    // not touch the ring.
+    struct Registry {
+        std::mutex mutex;
+        std::unordered_set<uint64_t> live;
+        uint64_t next_id = 1;
+    };
+
+    static inline Registry &registry() noexcept {
+        static Registry registry;
+        return registry;
+    }
+
+    static inline uint64_t register_tracer() {
+        auto &r = registry();
+        std::lock_guard lock(r.mutex);
+        r.live.insert(r.next_id);
+        return r.next_id++;
+    }
+
+    static inline void unregister_tracer(uint64_t id) noexcept {
+        auto &r = registry();
+        std::lock_guard lock(r.mutex);
+        r.live.erase(id);
+    }
+
+    static inline void abandon(uint64_t id, Ring *ring) noexcept {
+        auto &r = registry();
+        std::lock_guard lock(r.mutex);
+        if (r.live.count(id)) {
+            ring->active.store(false, std::memory_order_release);
+        }
+    }
+
+    inline Ring *local_ring() noexcept {
+        auto &tls = thread_rings();
+        if (tls.last.id == id_) {
+            return tls.last.ring;
+        }
+        for (auto &e : tls.entries) {
+            if (e.id == id_) {
+                tls.last = e;
+                return e.ring;
+            }
+        }
+        return attach_ring();
+    }
+
+    // adopt an abandoned ring, or create one. nullptr when out of memory.
+    Ring *attach_ring() noexcept {
+        std::lock_guard lock(mutex_);
+        Ring *ring = nullptr;
+        for (auto &r : rings_) {
+            bool expected = false;
+            if (r->active.compare_exchange_strong(
+                    expected, true, std::memory_order_acquire)) {
+                ring = r.get();
+                break;
+            }
+        }
+        try {
+            if (ring == nullptr) {
+                auto fresh = std::make_unique<Ring>();
+                fresh->events = std::make_unique<TraceEvent[]>(ring_mask_ + 1);
+                fresh->thread = static_cast<uint16_t>(rings_.size());
+                fresh->active.store(true, std::memory_order_relaxed);
+                rings_.push_back(std::move(fresh));
+                ring = rings_.back().get();
+            }
+
+            auto &tls = thread_rings();
+            {
+                // forget rings of tracers that are gone.
+                auto &r = registry();
+                std::lock_guard registry_lock(r.mutex);
+                std::erase_if(tls.entries, [&](auto &e) {
+                    return r.live.count(e.id) == 0;
+                });
+            }
+            tls.entries.push_back({ id_, ring });
+            tls.last = tls.entries.back();
+        } catch (...) {
+            if (ring) {
+                ring->active.store(false, std::memory_order_release);
+            }
+            return nullptr;
+        }
+        return ring;
+    }
+};
+
+//
+// `A` with every call recorded into a tracer, which must outlive it.
+//
+
+template <LayoutAllocator A> class Traced {
+    A alloc_;
+    Tracer *tracer_;
+
+  public:
+    using allocator_type = A;
+
+    static constexpr bool thread_safe = details::thread_safe_allocator<A>;
+
+    // `args` construct the traced allocator.
+    template <typename... Args>
+    explicit Traced(Tracer &tracer, Args &&...args)
+        : alloc_(std::forward<Args>(args)...)
+        , tracer_(&tracer) {}
+
+    A &allocator() noexcept { return alloc_; }
+    Tracer &tracer() noexcept { return *tracer_; }
+
+    inline void *allocate(Layout layout) noexcept {
+        void *p = alloc_.allocate(layout);
+        tracer_->record(TraceOp::allocate, p, layout);
+        return p;
+    }
+
+    inline void deallocate(void *ptr, Layout layout) noexcept {
+        if (ptr == nullptr) {
+            return;
+        }
+        tracer_->record(TraceOp::deallocate, ptr, layout);
+        alloc_.deallocate(ptr, layout);
+    }
+
+    inline bool owns(const void *ptr) noexcept { return alloc_.owns(ptr); }
+
+    inline void reset() noexcept {
+        tracer_->record(TraceOp::reset, nullptr, Layout());
+        alloc_.reset();
+    }
+};
+
+//
+// Replay.
+//
+
+struct ReplayOptions {
+    // ops between two samples of the resident set, 0 to not sample it.
+    size_t rss_interval = 4096;
+    // write a byte to every page of each block, as the traced program did
+    // (presumably), so that the resident set reflects the blocks.
+    bool touch = true;
+};
+
+struct ReplayReport {
+    size_t allocations = 0;
+    size_t frees = 0;
+    size_t resets = 0;
+    size_t failures = 0; // allocations the replayed allocator refused.
+    size_t skipped = 0;  // events not replayed: failed in the trace, frees
+                         // of blocks allocated before the trace started,
+                         // invalid layouts.
+    size_t threads = 0;  // recording threads seen in the trace.
+    double seconds = 0;  // time in the replay loop, sampling excluded.
+    size_t peak_live_bytes = 0; // requested bytes live at once, at most.
+    size_t peak_rss_bytes = 0;  // growth of the resident set, sampled.
+
+    size_t ops() const noexcept { return allocations + frees + resets; }
+
+    double ops_per_second() const noexcept {
+        return seconds > 0 ? ops() / seconds : 0;
+    }
+
+    // share of the resident growth that did not hold live blocks, 0 when
+    // the resident set wasn't sampled.
+    double fragmentation() const noexcept {
+        if (peak_rss_bytes == 0 || peak_live_bytes >= peak_rss_bytes) {
+            return 0;
+        }
+        return 1 - double(peak_live_bytes) / double(peak_rss_bytes);
+    }
+
+    friend inline std::string to_string(const ReplayReport &self) noexcept {
+        return "<ReplayReport| ops: " + std::to_string(self.ops()) +
+               ", allocations: " + std::to_string(self.allocations) +
+               ", frees: " + std::to_string(self.frees) +
+               ", resets: " + std::to_string(self.resets) +
+               ", failures: " + std::to_string(self.failures) +
+               ", skipped: " + std::to_string(self.skipped) +
+               ", threads: " + std::to_string(self.threads) +
+               ", ops/s: " +
+               std::to_string(static_cast<size_t>(self.ops_per_second())) +
+               ", peak live: " + std::to_string(self.peak_live_bytes) +
+               ", peak rss: " + std::to_string(self.peak_rss_bytes) +
+               ", fragmentation: " +
+               std::to_string(self.fragmentation()) + ">";
+    }
+};
+
+namespace details {
+
+// resident set of the process in bytes, 0 when unknown.
+inline size_t resident_bytes() noexcept {
+#if defined(__linux__)
+    if (std::FILE *f = std::fopen("/proc/self/statm", "r")) {
+        unsigned long size = 0, resident = 0;
+        int n = std::fscanf(f, "%lu %lu", &size, &resident);
+        std::fclose(f);
+        if (n == 2) {
+            return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        }
+    }
+#endif
+    return 0;
+}
+
+// a trace resolved into operations on numbered slots, so the replay loop
+// does no lookup.
+struct ReplayOp {
+    TraceOp op;
+    uint32_t slot;
+    Layout layout;
+};
+
+struct ReplayProgram {
+    std::vector<ReplayOp> ops;
+    size_t slots = 0;
+    size_t skipped = 0;
+    size_t threads = 0;
+};
+
+inline ReplayProgram compile_trace(std::span<const TraceEvent> events) {
+    std::vector<const TraceEvent *> order;
+    order.reserve(events.size());
+    for (const TraceEvent &e : events) {
+        order.push_back(&e);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](auto *a, auto *b) { return a->time < b->time; });
+
+    ReplayProgram program;
+    program.ops.reserve(order.size());
+    std::unordered_map<uint64_t, uint32_t> live; // traced ptr to slot.
+    std::unordered_set<uint16_t> threads;
+    std::vector<uint32_t> free_slots;
+    for (const TraceEvent *e : order) {
+        threads.insert(e->thread);
+        auto op = static_cast<TraceOp>(e->op);
+        if (op == TraceOp::reset) {
+            program.ops.push_back({ op, 0, Layout() });
+            free_slots.clear();
+            for (uint32_t i = 0; i < program.slots; ++i) {
+                free_slots.push_back(i);
+            }
+            live.clear();
+            continue;
+        }
+        auto layout = Layout::from_size_align(e->size, e->align);
+        if (!layout || e->ptr == 0 || op > TraceOp::reset) {
+            ++program.skipped;
+            continue;
+        }
+        if (op == TraceOp::allocate) {
+            uint32_t slot;
+            if (free_slots.empty()) {
+                slot = static_cast<uint32_t>(program.slots++);
+            } else {
+                slot = free_slots.back();
+                free_slots.pop_back();
+            }
+            live[e->ptr] = slot;
+            program.ops.push_back({ op, slot, layout.value() });
+        } else if (auto it = live.find(e->ptr); it != live.end()) {
+            program.ops.push_back({ op, it->second, layout.value() });
+            free_slots.push_back(it->second);
+            live.erase(it);
+        } else {
+            ++program.skipped;
+        }
+    }
+    program.threads = threads.size();
+    return program;
+}
+
+} // namespace details
+
+// run the events of a trace, in time order, on `allocator` from the calling
+// thread. Blocks still live at the end are given back.
+template <LayoutAllocator A>
+ReplayReport replay(std::span<const TraceEvent> events, A &allocator,
+                    ReplayOptions options = {}) {
+    using clock = std::chrono::steady_clock;
+
+    details::ReplayProgram program = details::compile_trace(events);
+    std::vector<void *> slots(program.slots, nullptr);
+    std::vector<Layout> layouts(program.slots);
+
+    ReplayReport report;
+    report.skipped = program.skipped;
+    report.threads = program.threads;
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t base_rss = options.rss_interval ? details::resident_bytes() : 0;
+    size_t live = 0;
+    clock::duration sampling{};
+
+    auto sample = [&] {
+        auto t = clock::now();
+        size_t rss = details::resident_bytes();
+        if (rss > base_rss) {
+            report.peak_rss_bytes =
+                std::max(report.peak_rss_bytes, rss - base_rss);
+        }
+        sampling += clock::now() - t;
+    };
+
+    auto start = clock::now();
+    for (size_t i = 0; i < program.ops.size(); ++i) {
+        const details::ReplayOp &op = program.ops[i];
+        switch (op.op) {
+        case TraceOp::allocate: {
+            void *p = allocator.allocate(op.layout);
+            if (p == nullptr) {
+                ++report.failures;
+                break;
+            }
+            if (options.touch) {
+                auto bytes = static_cast<volatile char *>(p);
+                for (size_t at = 0; at < op.layout.size(); at += page) {
+                    bytes[at] = 1;
+                }
+            }
+            slots[op.slot] = p;
+            layouts[op.slot] = op.layout;
+            live += op.layout.size();
+            report.peak_live_bytes = std::max(report.peak_live_bytes, live);
+            ++report.allocations;
+            break;
+        }
+        case TraceOp::deallocate:
+            if (void *p = std::exchange(slots[op.slot], nullptr)) {
+                allocator.deallocate(p, layouts[op.slot]);
+                live -= layouts[op.slot].size();
+            }
+            ++report.frees;
+            break;
+        case TraceOp::reset:
+            allocator.reset();
+            std::fill(slots.begin(), slots.end(), nullptr);
+            live = 0;
+            ++report.resets;
+            break;
+        }
+        if (options.rss_interval && i % options.rss_interval == 0) {
+            sample();
+        }
+    }
+    if (options.rss_interval) {
+        sample();
+    }
+    report.seconds =
+        std::chrono::duration<double>(clock::now() - start - sampling)
+            .count();
+
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (slots[i]) {
+            allocator.deallocate(slots[i], layouts[i]);
+        }
+    }
+    return report;
+}
+
+} // namespace alloy
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef _ALLOY_ALLOCATOR_HPP
+#define _ALLOY_ALLOCATOR_HPP
+#pragma once
+
+#include "memlayout.hpp"
+#include <concepts>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+
+namespace alloy {
+
+//
+// Common interface of the alloy allocators.
+// Memory is requested and given back by layout. `allocate` returns nullptr
+// on failure instead of throwing; `deallocate` receives the layout the block
+// was allocated with. `owns` tells whether a pointer came from the allocator
+// and `reset` drops every allocation at once.
+//
+
+template <typename A>
+concept LayoutAllocator = requires(A &a, Layout layout, void *ptr) {
+    { a.allocate(layout) } -> std::same_as<void *>;
+    { a.deallocate(ptr, layout) } -> std::same_as<void>;
+    { a.owns(ptr) } -> std::same_as<bool>;
+    { a.reset() } -> std::same_as<void>;
+};
+
+namespace details {
+
+// allocators that can be called from several threads at once declare
+// `thread_safe = true`.
+template <typename A>
+concept thread_safe_allocator = requires {
+    requires A::thread_safe;
+};
+
+} // namespace details
+
+//
+// Expose an alloy allocator as a std::pmr::memory_resource. The resource
+// only refers to the allocator, which must outlive it.
+//
+
+template <LayoutAllocator A>
+class MemoryResource : public std::pmr::memory_resource {
+    A *alloc_;
+
+  public:
+    explicit MemoryResource(A &alloc) noexcept
+        : alloc_(&alloc) {}
+
+    A &allocator() const noexcept { return *alloc_; }
+
+  protected:
+    void *do_allocate(size_t bytes, size_t align) override {
+        if (auto layout = Layout::from_size_align(bytes, align)) {
+            if (void *p = alloc_->allocate(layout.value())) {
+                return p;
+            }
+        }
+        throw std::bad_alloc();
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t align) override {
+        alloc_->deallocate(p, Layout::from_size_align(bytes, align).value());
+    }
+
+    bool do_is_equal(
+        const std::pmr::memory_resource &other) const noexcept override {
+        auto o = dynamic_cast<const MemoryResource<A> *>(&other);
+        return o && o->alloc_ == alloc_;
+    }
+};
+
+//
+// STL compatible allocator backed by an alloy allocator, for containers that
+// take an allocator template argument. Copies refer to the same allocator.
+//
+
+template <typename T, LayoutAllocator A> class StlAllocator {
+    template <typename U, LayoutAllocator B> friend class StlAllocator;
+
+    A *alloc_;
+
+  public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    template <typename U> struct rebind {
+        using other = StlAllocator<U, A>;
+    };
+
+    explicit StlAllocator(A &alloc) noexcept
+        : alloc_(&alloc) {}
+
+    template <typename U>
+    StlAllocator(const StlAllocator<U, A> &other) noexcept
+        : alloc_(other.alloc_) {}
+
+    A &allocator() const noexcept { return *alloc_; }
+
+    T *allocate(size_t n) {
+        if (auto layout = array_layout(n)) {
+            if (void *p = alloc_->allocate(layout.value())) {
+                return static_cast<T *>(p);
+            }
+        }
+        throw std::bad_alloc();
+    }
+
+    void deallocate(T *p, size_t n) noexcept {
+        alloc_->deallocate(p, array_layout(n).value());
+    }
+
+    template <typename U>
+    bool operator==(const StlAllocator<U, A> &other) const noexcept {
+        return alloc_ == other.alloc_;
+    }
+
+  private:
+    static M_CEXPR std::optional<Layout> array_layout(size_t n) noexcept {
+        if (auto p = Layout::of<T>().repeat(n)) {
+            return p.value().first;
+        }
+        return {};
+    }
+};
+
+} // namespace alloy
+
+#endif
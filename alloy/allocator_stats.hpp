@@ -0,0 +1,228 @@
+#ifndef _ALLOY_ALLOCATOR_STATS_HPP
+#define _ALLOY_ALLOCATOR_STATS_HPP
+#pragma once
+
+#include "memlayout.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <string>
+
+namespace alloy {
+
+//
+// Allocation statistics.
+//
+// Every allocator takes a statistics policy as its last template parameter
+// and reports to it:
+//   on_allocate(layout, reserved): a block for `layout` was handed out,
+//                                  taking `reserved` bytes of the allocator
+//                                  (alignment padding, rounding up to a size
+//                                  class and headers included).
+//   on_deallocate(reserved):       a block was given back, freeing
+//                                  `reserved` bytes (0 when the allocator
+//                                  can't reuse it on its own).
+//   on_failure(layout):            a request could not be served.
+//   on_release(bytes):             `bytes` of live blocks were dropped at
+//                                  once, by a rewind.
+//   on_reset():                    every live block was dropped.
+//
+// `NoStats`, the default, is empty and its hooks do nothing, so allocators
+// built with it pay nothing. `BasicStats` counts with plain integers for
+// single threaded allocators, `ConcurrentStats` with relaxed atomics for the
+// thread safe ones. `snapshot()` returns the counters as `AllocatorStats`.
+//
+
+struct AllocatorStats {
+    // bucket `i` of the histogram counts requests of `2^(i-1)` to `2^i - 1`
+    // bytes, the last bucket everything larger.
+    static constexpr size_t histogram_buckets = 32;
+
+    size_t allocations = 0;
+    size_t frees = 0;
+    size_t failures = 0;
+    size_t bytes_in_use = 0; // reserved by live blocks.
+    size_t peak_bytes = 0;   // high-water mark of `bytes_in_use`.
+    size_t padding_bytes = 0; // reserved beyond the requested sizes, summed
+                              // over all allocations.
+    std::array<size_t, histogram_buckets> histogram{};
+
+    static M_CEXPR size_t bucket_of(size_t size) noexcept {
+        return std::min<size_t>(std::bit_width(size), histogram_buckets - 1);
+    }
+
+    M_CEXPR size_t live() const noexcept { return allocations - frees; }
+
+    friend inline std::string to_string(const AllocatorStats &self) noexcept {
+        std::string s = "<AllocatorStats| allocations: " +
+                        std::to_string(self.allocations) +
+                        ", frees: " + std::to_string(self.frees) +
+                        ", failures: " + std::to_string(self.failures) +
+                        ", in use: " + std::to_string(self.bytes_in_use) +
+                        ", peak: " + std::to_string(self.peak_bytes) +
+                        ", padding: " + std::to_string(self.padding_bytes) +
+                        ", sizes: [";
+        bool first = true;
+        for (size_t i = 0; i < histogram_buckets; ++i) {
+            if (self.histogram[i] == 0) {
+                continue;
+            }
+            s += first ? "" : ", ";
+            s += i + 1 == histogram_buckets
+                     ? ">=" + std::to_string(size_t(1) << (i - 1))
+                     : "<" + std::to_string(size_t(1) << i);
+            s += ": " + std::to_string(self.histogram[i]);
+            first = false;
+        }
+        return s + "]>";
+    }
+};
+
+template <typename S>
+concept StatsPolicy = requires(S &s, const S &cs, Layout layout, size_t n) {
+    { S::enabled } -> std::convertible_to<bool>;
+    { S::thread_safe } -> std::convertible_to<bool>;
+    s.on_allocate(layout, n);
+    s.on_deallocate(n);
+    s.on_failure(layout);
+    s.on_release(n);
+    s.on_reset();
+    { cs.snapshot() } -> std::same_as<AllocatorStats>;
+};
+
+struct NoStats {
+    static constexpr bool enabled = false;
+    static constexpr bool thread_safe = true;
+
+    M_CEXPR void on_allocate(Layout, size_t) noexcept {}
+    M_CEXPR void on_deallocate(size_t) noexcept {}
+    M_CEXPR void on_failure(Layout) noexcept {}
+    M_CEXPR void on_release(size_t) noexcept {}
+    M_CEXPR void on_reset() noexcept {}
+    M_CEXPR AllocatorStats snapshot() const noexcept { return {}; }
+};
+
+struct BasicStats {
+    static constexpr bool enabled = true;
+    static constexpr bool thread_safe = false;
+
+  private:
+    AllocatorStats stats_;
+
+  public:
+    inline void on_allocate(Layout layout, size_t reserved) noexcept {
+        ++stats_.allocations;
+        ++stats_.histogram[AllocatorStats::bucket_of(layout.size())];
+        stats_.padding_bytes += reserved - std::min(reserved, layout.size());
+        stats_.bytes_in_use += reserved;
+        stats_.peak_bytes = std::max(stats_.peak_bytes, stats_.bytes_in_use);
+    }
+
+    inline void on_deallocate(size_t reserved) noexcept {
+        ++stats_.frees;
+        stats_.bytes_in_use -= std::min(reserved, stats_.bytes_in_use);
+    }
+
+    inline void on_failure(Layout) noexcept { ++stats_.failures; }
+
+    inline void on_release(size_t bytes) noexcept {
+        stats_.bytes_in_use -= std::min(bytes, stats_.bytes_in_use);
+    }
+
+    inline void on_reset() noexcept { stats_.bytes_in_use = 0; }
+
+    inline AllocatorStats snapshot() const noexcept { return stats_; }
+};
+
+struct ConcurrentStats {
+    static constexpr bool enabled = true;
+    static constexpr bool thread_safe = true;
+
+  private:
+    static constexpr auto relaxed = std::memory_order_relaxed;
+
+    std::atomic<size_t> allocations_{ 0 };
+    std::atomic<size_t> frees_{ 0 };
+    std::atomic<size_t> failures_{ 0 };
+    std::atomic<size_t> bytes_in_use_{ 0 };
+    std::atomic<size_t> peak_bytes_{ 0 };
+    std::atomic<size_t> padding_bytes_{ 0 };
+    std::array<std::atomic<size_t>, AllocatorStats::histogram_buckets>
+        histogram_{};
+
+    // take the counters of `other`, leaving it at zero. Not atomic as a
+    // whole: neither side may be in use by another thread.
+    inline void take(ConcurrentStats &other) noexcept {
+        auto move = [](std::atomic<size_t> &to, std::atomic<size_t> &from) {
+            to.store(from.exchange(0, relaxed), relaxed);
+        };
+        move(allocations_, other.allocations_);
+        move(frees_, other.frees_);
+        move(failures_, other.failures_);
+        move(bytes_in_use_, other.bytes_in_use_);
+        move(peak_bytes_, other.peak_bytes_);
+        move(padding_bytes_, other.padding_bytes_);
+        for (size_t i = 0; i < histogram_.size(); ++i) {
+            move(histogram_[i], other.histogram_[i]);
+        }
+    }
+
+  public:
+    ConcurrentStats() noexcept = default;
+
+    // allocators move their statistics along with their memory.
+    ConcurrentStats(ConcurrentStats &&other) noexcept { take(other); }
+
+    ConcurrentStats &operator=(ConcurrentStats &&other) noexcept {
+        if (this != &other) {
+            take(other);
+        }
+        return *this;
+    }
+
+    inline void on_allocate(Layout layout, size_t reserved) noexcept {
+        allocations_.fetch_add(1, relaxed);
+        histogram_[AllocatorStats::bucket_of(layout.size())].fetch_add(
+            1, relaxed);
+        padding_bytes_.fetch_add(reserved - std::min(reserved, layout.size()),
+                                 relaxed);
+        size_t in_use = bytes_in_use_.fetch_add(reserved, relaxed) + reserved;
+        size_t peak = peak_bytes_.load(relaxed);
+        while (in_use > peak &&
+               !peak_bytes_.compare_exchange_weak(peak, in_use, relaxed))
+            ;
+    }
+
+    inline void on_deallocate(size_t reserved) noexcept {
+        frees_.fetch_add(1, relaxed);
+        bytes_in_use_.fetch_sub(reserved, relaxed);
+    }
+
+    inline void on_failure(Layout) noexcept { failures_.fetch_add(1, relaxed); }
+
+    inline void on_release(size_t bytes) noexcept {
+        bytes_in_use_.fetch_sub(bytes, relaxed);
+    }
+
+    inline void on_reset() noexcept { bytes_in_use_.store(0, relaxed); }
+
+    inline AllocatorStats snapshot() const noexcept {
+        AllocatorStats s;
+        s.allocations = allocations_.load(relaxed);
+        s.frees = frees_.load(relaxed);
+        s.failures = failures_.load(relaxed);
+        s.bytes_in_use = bytes_in_use_.load(relaxed);
+        s.peak_bytes = peak_bytes_.load(relaxed);
+        s.padding_bytes = padding_bytes_.load(relaxed);
+        for (size_t i = 0; i < s.histogram.size(); ++i) {
+            s.histogram[i] = histogram_[i].load(relaxed);
+        }
+        return s;
+    }
+};
+
+} // namespace alloy
+
+#endif
@@ -4,4 +4,19 @@
 
 #include "memlayout.hpp"
 
+#include "allocator.hpp"
+#include "allocator_stats.hpp"
+#include "page_provider.hpp"
+#include "bump_allocator.hpp"
+#include "composite_allocator.hpp"
+#include "concurrent_bump_allocator.hpp"
+#include "epoch_domain.hpp"
+#include "fixed_size_allocator.hpp"
+#include "guarded_allocator.hpp"
+#include "inline_arena.hpp"
+#include "linked_list_allocator.hpp"
+#include "slab_allocator.hpp"
+#include "static_layout.hpp"
+#include "thread_cache.hpp"
+
 #endif
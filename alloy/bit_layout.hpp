@@ -0,0 +1,312 @@
+#ifndef _ALLOY_BIT_LAYOUT_HPP
+#define _ALLOY_BIT_LAYOUT_HPP
+#pragma once
+
+#include "memlayout.hpp"
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace alloy {
+
+//
+// Bit granular layouts.
+//
+// `bit_record<Word, bit_field<T, Bits>...>` packs fields of a few bits each
+// into a single unsigned word, the first field in the lowest bits. Field
+// offsets and masks are computed at compile time; `get` and `set` are a
+// shift and a mask, without branches. Fields can be unsigned or signed
+// integers (sign extended on `get`), bool or enums.
+//
+//     enum class Color : uint8_t { red, green, blue };
+//     using Flags = bit_record<uint16_t, bit_field<bool, 1>,
+//                              bit_field<Color, 2>, bit_field<uint8_t, 5>>;
+//     Flags f(true, Color::blue, 17);
+//     f.set<2>(3);
+//     Color c = f.get<1>();
+//
+// `extract<I>` and `insert<I>` move one field of a whole array of records
+// to or from a plain array. The loops are straight line shifts and masks
+// the compiler vectorizes (GCC at -O3).
+//
+// `bit_array<Bits>` stores unsigned values of `Bits` bits densely in 64 bit
+// words, for flags and enums too small for a byte each.
+//
+
+template <typename T, size_t Bits> struct bit_field {
+    static_assert(std::is_integral_v<T> || std::is_enum_v<T>,
+                  "bit fields hold integers, bools or enums");
+    static_assert(Bits > 0, "bit fields are at least one bit wide");
+    static_assert(Bits <= sizeof(T) * 8, "bit field wider than its type");
+
+    using type = T;
+    static constexpr size_t width = Bits;
+};
+
+namespace details {
+
+template <typename T> struct bit_value {
+    using type = T;
+};
+template <typename T>
+    requires std::is_enum_v<T>
+struct bit_value<T> {
+    using type = std::underlying_type_t<T>;
+};
+
+// integer type a field of type `T` is converted through.
+template <typename T> using bit_value_t = typename bit_value<T>::type;
+
+template <size_t N>
+M_CEXPR std::array<size_t, N>
+bit_offsets(const std::array<size_t, N> &widths) noexcept {
+    std::array<size_t, N> offsets{};
+    size_t offset = 0;
+    for (size_t i = 0; i < N; ++i) {
+        offsets[i] = offset;
+        offset += widths[i];
+    }
+    return offsets;
+}
+
+} // namespace details
+
+template <std::unsigned_integral Word, typename... Fields> class bit_record {
+  public:
+    using word_type = Word;
+
+    static constexpr size_t field_count = sizeof...(Fields);
+    static constexpr std::array<size_t, field_count> widths{
+        Fields::width...
+    };
+    static constexpr std::array<size_t, field_count> offsets =
+        details::bit_offsets(widths);
+    static constexpr size_t bit_size = (size_t(0) + ... + Fields::width);
+
+    static_assert(bit_size <= std::numeric_limits<Word>::digits,
+                  "the fields don't fit in the word");
+
+    template <size_t I>
+    using field_type =
+        typename std::tuple_element_t<I, std::tuple<Fields...>>::type;
+
+    // bits of field `I` in the word.
+    template <size_t I>
+    static constexpr Word mask =
+        static_cast<Word>(bit_mask<Word>(widths[I]) << offsets[I]);
+
+  private:
+    Word bits_;
+
+  public:
+    M_CEXPR bit_record() noexcept
+        : bits_(0) {}
+
+    M_CEXPR explicit bit_record(typename Fields::type... values) noexcept
+        requires(field_count > 0)
+        : bits_(0) {
+        set_all(std::index_sequence_for<Fields...>(), values...);
+    }
+
+    M_CEXPR static bit_record from_bits(Word bits) noexcept {
+        bit_record r;
+        r.bits_ = bits;
+        return r;
+    }
+
+    M_CEXPR Word bits() const noexcept { return bits_; }
+
+    M_CEXPR static Layout layout() noexcept {
+        return Layout::create<Word>().value();
+    }
+
+    // field `I` of the packed word `word`.
+    template <size_t I>
+    M_CEXPR static field_type<I> get(Word word) noexcept {
+        using T = field_type<I>;
+        using V = details::bit_value_t<T>;
+        Word raw = bit_get_range(word, offsets[I], widths[I]);
+        if constexpr (std::is_same_v<V, bool>) {
+            return static_cast<T>(raw != 0);
+        } else if constexpr (std::is_signed_v<V>) {
+            // sign extend from the top bit of the field.
+            using S = std::make_signed_t<Word>;
+            const Word sign = Word(1) << (widths[I] - 1);
+            return static_cast<T>(
+                static_cast<V>(static_cast<S>((raw ^ sign) - sign)));
+        } else {
+            return static_cast<T>(static_cast<V>(raw));
+        }
+    }
+
+    // `word` with field `I` replaced by `value`, truncated to its width.
+    template <size_t I>
+    M_CEXPR static Word set(Word word, field_type<I> value) noexcept {
+        using V = details::bit_value_t<field_type<I>>;
+        auto bits = static_cast<Word>(static_cast<V>(value));
+        return bit_insert_range(word, offsets[I], widths[I], bits);
+    }
+
+    template <size_t I> M_CEXPR field_type<I> get() const noexcept {
+        return get<I>(bits_);
+    }
+
+    template <size_t I> M_CEXPR void set(field_type<I> value) noexcept {
+        bits_ = set<I>(bits_, value);
+    }
+
+    // field `I` of every record in `records`, to `out`.
+    template <size_t I>
+    static void extract(std::span<const bit_record> records,
+                        std::span<field_type<I>> out) noexcept {
+        const size_t n = std::min(records.size(), out.size());
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = get<I>(records[i].bits_);
+        }
+    }
+
+    // field `I` of every record in `records`, from `in`.
+    template <size_t I>
+    static void insert(std::span<bit_record> records,
+                       std::span<const field_type<I>> in) noexcept {
+        const size_t n = std::min(records.size(), in.size());
+        for (size_t i = 0; i < n; ++i) {
+            records[i].bits_ = set<I>(records[i].bits_, in[i]);
+        }
+    }
+
+    friend M_CEXPR bool operator==(const bit_record &,
+                                   const bit_record &) noexcept = default;
+
+  private:
+    template <size_t... Is>
+    M_CEXPR void set_all(std::index_sequence<Is...>,
+                         typename Fields::type... values) noexcept {
+        ((bits_ = set<Is>(bits_, values)), ...);
+    }
+};
+
+//
+// Dense array of `Bits` bit unsigned values. Values never straddle two
+// words: a word holds `per_word` of them and the unused high bits stay 0.
+//
+
+template <size_t Bits, std::unsigned_integral Word = uint64_t>
+class bit_array {
+  public:
+    static constexpr size_t word_bits = std::numeric_limits<Word>::digits;
+    static constexpr size_t per_word = word_bits / Bits;
+    static constexpr Word value_mask = bit_mask<Word>(Bits);
+
+    static_assert(Bits > 0 && Bits <= word_bits,
+                  "values must fit in a word");
+
+    using value_type = Word;
+
+  private:
+    std::vector<Word> words_;
+    size_t size_ = 0;
+
+    static M_CEXPR size_t words_for(size_t n) noexcept {
+        return (n + per_word - 1) / per_word;
+    }
+
+  public:
+    bit_array() noexcept = default;
+
+    // `n` zero values.
+    explicit bit_array(size_t n)
+        : words_(words_for(n))
+        , size_(n) {}
+
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    // bytes of storage in use.
+    size_t bytes() const noexcept { return words_.size() * sizeof(Word); }
+
+    const Word *data() const noexcept { return words_.data(); }
+
+    void resize(size_t n) {
+        words_.resize(words_for(n));
+        if (n < size_ && n % per_word) {
+            // clear the dropped values sharing the last word.
+            Word &last = words_.back();
+            last = bit_clear_range(last, (n % per_word) * Bits,
+                                   (per_word - n % per_word) * Bits);
+        }
+        size_ = n;
+    }
+
+    void push_back(Word value) {
+        resize(size_ + 1);
+        set(size_ - 1, value);
+    }
+
+    Word get(size_t i) const noexcept {
+        return bit_get_range(words_[i / per_word], (i % per_word) * Bits,
+                             Bits);
+    }
+
+    // store the low `Bits` bits of `value` at `i`.
+    void set(size_t i, Word value) noexcept {
+        Word &w = words_[i / per_word];
+        w = bit_insert_range(w, (i % per_word) * Bits, Bits, value);
+    }
+
+    Word operator[](size_t i) const noexcept { return get(i); }
+
+    // values [first, first + out.size()) to `out`. Whole words are unpacked
+    // with a fixed inner loop the compiler unrolls and vectorizes.
+    template <std::integral T>
+    void extract(size_t first, std::span<T> out) const noexcept {
+        size_t i = 0;
+        const size_t n = out.size();
+        for (; i < n && (first + i) % per_word; ++i) {
+            out[i] = static_cast<T>(get(first + i));
+        }
+        const Word *w = words_.data() + (first + i) / per_word;
+        for (; i + per_word <= n; i += per_word, ++w) {
+            const Word word = *w;
+            for (size_t k = 0; k < per_word; ++k) {
+                out[i + k] = static_cast<T>((word >> (k * Bits)) & value_mask);
+            }
+        }
+        for (; i < n; ++i) {
+            out[i] = static_cast<T>(get(first + i));
+        }
+    }
+
+    // store `in` at [first, first + in.size()). Whole words are packed and
+    // written without reading them first.
+    template <std::integral T>
+    void insert(size_t first, std::span<const T> in) noexcept {
+        size_t i = 0;
+        const size_t n = in.size();
+        for (; i < n && (first + i) % per_word; ++i) {
+            set(first + i, static_cast<Word>(in[i]));
+        }
+        Word *w = words_.data() + (first + i) / per_word;
+        for (; i + per_word <= n; i += per_word, ++w) {
+            Word word = 0;
+            for (size_t k = 0; k < per_word; ++k) {
+                word |= (static_cast<Word>(in[i + k]) & value_mask)
+                        << (k * Bits);
+            }
+            *w = word;
+        }
+        for (; i < n; ++i) {
+            set(first + i, static_cast<Word>(in[i]));
+        }
+    }
+};
+
+} // namespace alloy
+
+#endif
@@ -2,13 +2,294 @@
 #define _ALLOY_BUMP_ALLOCATOR_HPP
 #pragma once
 
+#include "allocator_stats.hpp"
 #include "memlayout.hpp"
+#include "page_provider.hpp"
+#include <algorithm>
 #include <memory>
+#include <new>
+#include <utility>
 
-class BumpAllocator {
-    using allocator_type = BumpAllocator;
+namespace alloy {
 
+//
+// Bump allocator (arena).
+// Memory is handed out by advancing a cursor through the current chunk. When
+// the chunk is exhausted a new one is chained in front of it. Individual
+// deallocation is a no-op except for the most recent block; memory is given
+// back in bulk with `reset()` or by rewinding to a `Marker`.
+//
+// Chunks that are dropped by `reset()` or `rewind()` are kept on a spare list
+// and reused, so a reset arena on a steady workload never touches the heap.
+// `release()` returns every chunk to the provider.
+//
+
+template <MemoryProvider Provider = HeapProvider, StatsPolicy Stats = NoStats>
+class BasicBumpAllocator {
+    // header placed at the start of every chunk. `used` describes the bytes
+    // consumed so far, counted from the chunk base (header included), so
+    // bumping is just `used.extend(layout)`.
+    struct Chunk {
+        Chunk *prev;
+        size_t size;  // total bytes of the chunk, header included.
+        size_t align; // alignment of the chunk base.
+        Layout used;
+    };
+
+    Chunk *current_;
+    Chunk *spare_;
+    size_t next_chunk_size_;
+    [[no_unique_address]] Provider provider_;
+    [[no_unique_address]] Stats stats_;
+
+  public:
+    using allocator_type = BasicBumpAllocator<Provider, Stats>;
+    using provider_type = Provider;
+    using stats_type = Stats;
+
+    static constexpr size_t default_chunk_size = 64 * 1024;
+    static constexpr size_t max_chunk_size = 64 * 1024 * 1024;
+
+    // chunk bases are page aligned, offsets inside a chunk can then be
+    // aligned with `Layout::required_padding` for any align up to a page.
+    static constexpr size_t chunk_align = 4096;
+
+    // position in the arena, obtained by `mark()` and consumed by
+    // `rewind()`.
+    struct Marker {
+        Chunk *chunk;
+        Layout used;
+    };
+
+    // rewind the arena to where it was when the scope was entered.
+    class Scope {
+        BasicBumpAllocator &arena_;
+        Marker marker_;
+
+      public:
+        explicit Scope(BasicBumpAllocator &arena) noexcept
+            : arena_(arena)
+            , marker_(arena.mark()) {}
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        ~Scope() { arena_.rewind(marker_); }
+    };
+
+    explicit BasicBumpAllocator(size_t chunk_size = default_chunk_size,
+                                Provider provider = Provider()) noexcept
+        : current_(nullptr)
+        , spare_(nullptr)
+        , next_chunk_size_(std::max(chunk_size, sizeof(Chunk)))
+        , provider_(std::move(provider)) {}
+
+    BasicBumpAllocator(const BasicBumpAllocator &) = delete;
+    BasicBumpAllocator &operator=(const BasicBumpAllocator &) = delete;
+
+    BasicBumpAllocator(BasicBumpAllocator &&other) noexcept
+        : current_(std::exchange(other.current_, nullptr))
+        , spare_(std::exchange(other.spare_, nullptr))
+        , next_chunk_size_(other.next_chunk_size_)
+        , provider_(std::move(other.provider_))
+        , stats_(std::exchange(other.stats_, Stats())) {}
+
+    BasicBumpAllocator &operator=(BasicBumpAllocator &&other) noexcept {
+        if (this != &other) {
+            release();
+            current_ = std::exchange(other.current_, nullptr);
+            spare_ = std::exchange(other.spare_, nullptr);
+            next_chunk_size_ = other.next_chunk_size_;
+            provider_ = std::move(other.provider_);
+            stats_ = std::exchange(other.stats_, Stats());
+        }
+        return *this;
+    }
+
+    ~BasicBumpAllocator() { release(); }
+
+    Provider &provider() noexcept { return provider_; }
+
+    AllocatorStats statistics() const noexcept { return stats_.snapshot(); }
+
+    // allocate a block described by `layout`. Returns nullptr when the
+    // layout is invalid or the system is out of memory.
+    inline void *allocate(Layout layout) noexcept {
+        if (current_ && layout.align() <= current_->align) {
+            if (auto p = bump(current_, layout)) {
+                return p;
+            }
+        }
+        void *p = allocate_slow(layout);
+        if (p == nullptr) {
+            stats_.on_failure(layout);
+        }
+        return p;
+    }
+
+    // allocate storage for `n` objects of type T.
+    template <typename T> inline T *allocate(size_t n = 1) noexcept {
+        if (auto p = Layout::of<T>().repeat(n)) {
+            return static_cast<T *>(allocate(p.value().first));
+        }
+        return nullptr;
+    }
+
+    // only the most recent allocation can be given back, everything else is
+    // reclaimed by `reset()` or `rewind()`.
+    inline void deallocate(void *ptr, Layout layout) noexcept {
+        if (ptr == nullptr || current_ == nullptr) {
+            return;
+        }
+        char *base = reinterpret_cast<char *>(current_);
+        char *p = static_cast<char *>(ptr);
+        size_t freed = 0;
+        if (p + layout.size() == base + current_->used.size()) {
+            freed = current_->used.size() - (p - base);
+            current_->used = Layout::from_size_align(p - base,
+                                                     current_->used.align())
+                                 .value();
+        }
+        stats_.on_deallocate(freed);
+    }
+
+    // whether `ptr` points into one of the live chunks.
+    inline bool owns(const void *ptr) const noexcept {
+        auto p = static_cast<const char *>(ptr);
+        for (Chunk *c = current_; c; c = c->prev) {
+            auto base = reinterpret_cast<const char *>(c);
+            if (p >= base + sizeof(Chunk) && p < base + c->used.size()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline Marker mark() const noexcept {
+        if (current_ == nullptr) {
+            return { nullptr, Layout() };
+        }
+        return { current_, current_->used };
+    }
+
+    // drop everything allocated after `marker` was taken.
+    inline void rewind(Marker marker) noexcept {
+        size_t before = Stats::enabled ? used() : 0;
+        while (current_ != marker.chunk) {
+            retire(current_);
+        }
+        if (current_) {
+            current_->used = marker.used;
+        }
+        if constexpr (Stats::enabled) {
+            stats_.on_release(before - used());
+        }
+    }
+
+    // drop every allocation. Chunks are kept for reuse.
+    inline void reset() noexcept {
+        rewind({ nullptr, Layout() });
+        stats_.on_reset();
+    }
+
+    // drop every allocation and return all chunks to the provider.
+    inline void release() noexcept {
+        reset();
+        while (spare_) {
+            Chunk *c = std::exchange(spare_, spare_->prev);
+            provider_.deallocate_chunk(
+                c, Layout::from_size_align(c->size, c->align).value());
+        }
+    }
+
+    // bytes handed out from live chunks, padding included.
+    inline size_t used() const noexcept {
+        size_t n = 0;
+        for (Chunk *c = current_; c; c = c->prev) {
+            n += c->used.size() - sizeof(Chunk);
+        }
+        return n;
+    }
+
+    // bytes held from the provider, spare chunks included.
+    inline size_t capacity() const noexcept {
+        size_t n = 0;
+        for (Chunk *c = current_; c; c = c->prev) {
+            n += c->size;
+        }
+        for (Chunk *c = spare_; c; c = c->prev) {
+            n += c->size;
+        }
+        return n;
+    }
+
+  private:
+    inline void *bump(Chunk *chunk, Layout layout) noexcept {
+        if (auto p = chunk->used.extend(layout)) {
+            auto [used, offset] = p.value();
+            if (used.size() <= chunk->size) {
+                stats_.on_allocate(layout, used.size() - chunk->used.size());
+                chunk->used = used;
+                return reinterpret_cast<char *>(chunk) + offset;
+            }
+        }
+        return nullptr;
+    }
+
+    // move the current chunk onto the spare list.
+    inline void retire(Chunk *chunk) noexcept {
+        current_ = chunk->prev;
+        chunk->prev = spare_;
+        spare_ = chunk;
+    }
+
+    // first spare chunk that can hold `size` bytes at `align`.
+    inline Chunk *take_spare(size_t size, size_t align) noexcept {
+        for (Chunk **link = &spare_; *link; link = &(*link)->prev) {
+            Chunk *c = *link;
+            if (c->size >= size && c->align >= align) {
+                *link = c->prev;
+                return c;
+            }
+        }
+        return nullptr;
+    }
+
+    void *allocate_slow(Layout layout) noexcept {
+        if (layout.align() == 0) {
+            return nullptr;
+        }
+        auto header = Layout::create<Chunk>().value();
+        auto need = header.extend(layout);
+        if (!need) {
+            return nullptr;
+        }
+        size_t align = std::max(chunk_align, layout.align());
+        size_t need_size = need.value().first.size();
+
+        Chunk *chunk = take_spare(need_size, align);
+        if (chunk == nullptr) {
+            size_t size = std::max(next_chunk_size_, need_size);
+            auto chunk_layout = Layout::from_size_align(size, align);
+            if (!chunk_layout) {
+                return nullptr;
+            }
+            void *mem = provider_.allocate_chunk(chunk_layout.value());
+            if (mem == nullptr) {
+                return nullptr;
+            }
+            chunk = static_cast<Chunk *>(mem);
+            chunk->size = size;
+            chunk->align = align;
+            next_chunk_size_ = std::min(next_chunk_size_ * 2, max_chunk_size);
+        }
+        chunk->used = header;
+        chunk->prev = current_;
+        current_ = chunk;
+        return bump(chunk, layout);
+    }
 };
 
-#endif
+using BumpAllocator = BasicBumpAllocator<>;
 
+} // namespace alloy
+
+#endif
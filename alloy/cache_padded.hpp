@@ -0,0 +1,53 @@
+#ifndef _ALLOY_CACHE_PADDED_HPP
+#define _ALLOY_CACHE_PADDED_HPP
+#pragma once
+
+#include "memlayout.hpp"
+#include <type_traits>
+#include <utility>
+
+namespace alloy {
+
+//
+// Value on cache lines of its own.
+// `cache_padded<T>` has the layout `Layout::create<T>()->align_to_cacheline()`,
+// so neighbouring objects (other counters, a queue's head and tail) can't
+// falsely share a line with it.
+//
+
+template <typename T> class cache_padded {
+    static constexpr Layout padded =
+        Layout::create<T>().value().align_to_cacheline().value();
+
+    alignas(padded.align()) T value_;
+
+  public:
+    using value_type = T;
+
+    static M_CEXPR Layout layout() noexcept { return padded; }
+
+    cache_padded() = default;
+
+    template <typename... Args>
+        requires std::is_constructible_v<T, Args &&...>
+    explicit cache_padded(std::in_place_t, Args &&...args)
+        : value_(std::forward<Args>(args)...) {}
+
+    template <typename U>
+        requires(!std::is_same_v<std::remove_cvref_t<U>, cache_padded> &&
+                 std::is_constructible_v<T, U &&>)
+    cache_padded(U &&value)
+        : value_(std::forward<U>(value)) {}
+
+    T &get() noexcept { return value_; }
+    const T &get() const noexcept { return value_; }
+
+    T &operator*() noexcept { return value_; }
+    const T &operator*() const noexcept { return value_; }
+    T *operator->() noexcept { return &value_; }
+    const T *operator->() const noexcept { return &value_; }
+};
+
+} // namespace alloy
+
+#endif
@@ -0,0 +1,392 @@
+#ifndef _ALLOY_COMPOSITE_ALLOCATOR_HPP
+#define _ALLOY_COMPOSITE_ALLOCATOR_HPP
+#pragma once
+
+#include "allocator.hpp"
+#include "memlayout.hpp"
+#include "page_provider.hpp"
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+namespace alloy {
+
+//
+// Allocator building blocks.
+// Each template here is itself a `LayoutAllocator` made of others, so a
+// workload tuned allocator is a type:
+//
+//     template <size_t S> using Pool = FixedSizeAllocator<S>;
+//     using ServiceAllocator =
+//         Segregator<256, Bucketizer<32, 256, Pool>,
+//                    Segregator<(1 << 20), LinkedListAllocator<>,
+//                               ProviderAllocator<PageProvider>>>;
+//
+// `allocate(layout)` routes a run time size with one compare per level.
+// `allocate<Size, Align>()` routes with `if constexpr` through every level
+// that supports it, so a request of a size known at compile time costs
+// exactly the call into the allocator that serves it.
+//
+// Blocks are given back with the layout they were allocated with, which is
+// what routes `deallocate`.
+//
+
+namespace details {
+
+// `a.allocate<Size, Align>()` when `A` routes at compile time, otherwise
+// `a.allocate(layout)`.
+template <size_t Size, size_t Align, typename A>
+inline void *allocate_static(A &a) noexcept {
+    if constexpr (requires { a.template allocate<Size, Align>(); }) {
+        return a.template allocate<Size, Align>();
+    } else {
+        return a.allocate(Layout::fixed<Size, Align>());
+    }
+}
+
+template <size_t Size, size_t Align, typename A>
+inline void deallocate_static(A &a, void *ptr) noexcept {
+    if constexpr (requires { a.template deallocate<Size, Align>(ptr); }) {
+        a.template deallocate<Size, Align>(ptr);
+    } else {
+        a.deallocate(ptr, Layout::fixed<Size, Align>());
+    }
+}
+
+} // namespace details
+
+//
+// Requests of at most `Threshold` bytes go to `Small`, larger ones to
+// `Large`.
+//
+
+template <size_t Threshold, LayoutAllocator Small, LayoutAllocator Large>
+class Segregator {
+    [[no_unique_address]] Small small_;
+    [[no_unique_address]] Large large_;
+
+  public:
+    static constexpr size_t threshold = Threshold;
+
+    Segregator() = default;
+
+    Segregator(Small small, Large large) noexcept
+        : small_(std::move(small))
+        , large_(std::move(large)) {}
+
+    Small &small() noexcept { return small_; }
+    Large &large() noexcept { return large_; }
+
+    inline void *allocate(Layout layout) noexcept {
+        return layout.size() <= Threshold ? small_.allocate(layout)
+                                          : large_.allocate(layout);
+    }
+
+    inline void deallocate(void *ptr, Layout layout) noexcept {
+        if (layout.size() <= Threshold) {
+            small_.deallocate(ptr, layout);
+        } else {
+            large_.deallocate(ptr, layout);
+        }
+    }
+
+    template <size_t Size, size_t Align = alignof(std::max_align_t)>
+    inline void *allocate() noexcept {
+        if constexpr (Size <= Threshold) {
+            return details::allocate_static<Size, Align>(small_);
+        } else {
+            return details::allocate_static<Size, Align>(large_);
+        }
+    }
+
+    template <size_t Size, size_t Align = alignof(std::max_align_t)>
+    inline void deallocate(void *ptr) noexcept {
+        if constexpr (Size <= Threshold) {
+            details::deallocate_static<Size, Align>(small_, ptr);
+        } else {
+            details::deallocate_static<Size, Align>(large_, ptr);
+        }
+    }
+
+    inline bool owns(const void *ptr) const noexcept {
+        return small_.owns(ptr) || large_.owns(ptr);
+    }
+
+    inline void reset() noexcept {
+        small_.reset();
+        large_.reset();
+    }
+};
+
+//
+// Requests go to `Primary` and, when it fails, to `Fallback`. Blocks are
+// given back to whichever owns them.
+//
+
+template <LayoutAllocator Primary, LayoutAllocator Fallback>
+class FallbackAllocator {
+    [[no_unique_address]] Primary primary_;
+    [[no_unique_address]] Fallback fallback_;
+
+  public:
+    FallbackAllocator() = default;
+
+    FallbackAllocator(Primary primary, Fallback fallback) noexcept
+        : primary_(std::move(primary))
+        , fallback_(std::move(fallback)) {}
+
+    Primary &primary() noexcept { return primary_; }
+    Fallback &fallback() noexcept { return fallback_; }
+
+    inline void *allocate(Layout layout) noexcept {
+        if (void *p = primary_.allocate(layout)) {
+            return p;
+        }
+        return fallback_.allocate(layout);
+    }
+
+    inline void deallocate(void *ptr, Layout layout) noexcept {
+        if (primary_.owns(ptr)) {
+            primary_.deallocate(ptr, layout);
+        } else {
+            fallback_.deallocate(ptr, layout);
+        }
+    }
+
+    template <size_t Size, size_t Align = alignof(std::max_align_t)>
+    inline void *allocate() noexcept {
+        if (void *p = details::allocate_static<Size, Align>(primary_)) {
+            return p;
+        }
+        return details::allocate_static<Size, Align>(fallback_);
+    }
+
+    inline bool owns(const void *ptr) const noexcept {
+        return primary_.owns(ptr) || fallback_.owns(ptr);
+    }
+
+    inline void reset() noexcept {
+        primary_.reset();
+        fallback_.reset();
+    }
+};
+
+//
+// `Max / Step` allocators, bucket `i` built as `Bucket<(i + 1) * Step>` and
+// serving sizes in (i * Step, (i + 1) * Step]. Run time requests find their
+// bucket through a table, compile time ones directly. Requests larger than
+// `Max` fail.
+//
+
+template <size_t Step, size_t Max, template <size_t> class Bucket>
+class Bucketizer {
+    static_assert(Step > 0 && Max % Step == 0 && Max >= Step,
+                  "Max must be a non zero multiple of Step");
+
+  public:
+    static constexpr size_t step = Step;
+    static constexpr size_t max_size = Max;
+    static constexpr size_t bucket_count = Max / Step;
+
+  private:
+    template <size_t... Is>
+    static auto buckets_of(std::index_sequence<Is...>)
+        -> std::tuple<Bucket<(Is + 1) * Step>...>;
+
+    using Buckets =
+        decltype(buckets_of(std::make_index_sequence<bucket_count>()));
+
+    Buckets buckets_;
+
+    using Allocate = void *(*)(Buckets &, Layout) noexcept;
+    using Deallocate = void (*)(Buckets &, void *, Layout) noexcept;
+
+    template <size_t... Is>
+    static M_CEXPR std::array<Allocate, bucket_count>
+    allocate_table(std::index_sequence<Is...>) noexcept {
+        return { +[](Buckets &b, Layout l) noexcept -> void * {
+            return std::get<Is>(b).allocate(l);
+        }... };
+    }
+
+    template <size_t... Is>
+    static M_CEXPR std::array<Deallocate, bucket_count>
+    deallocate_table(std::index_sequence<Is...>) noexcept {
+        return { +[](Buckets &b, void *p, Layout l) noexcept {
+            std::get<Is>(b).deallocate(p, l);
+        }... };
+    }
+
+    static constexpr auto allocators =
+        allocate_table(std::make_index_sequence<bucket_count>());
+    static constexpr auto deallocators =
+        deallocate_table(std::make_index_sequence<bucket_count>());
+
+    static M_CEXPR size_t bucket_of(size_t size) noexcept {
+        return size == 0 ? 0 : (size - 1) / Step;
+    }
+
+  public:
+    Bucketizer() = default;
+
+    template <size_t I> auto &bucket() noexcept {
+        return std::get<I>(buckets_);
+    }
+
+    inline void *allocate(Layout layout) noexcept {
+        if (layout.size() > Max) {
+            return nullptr;
+        }
+        return allocators[bucket_of(layout.size())](buckets_, layout);
+    }
+
+    inline void deallocate(void *ptr, Layout layout) noexcept {
+        if (ptr && layout.size() <= Max) {
+            deallocators[bucket_of(layout.size())](buckets_, ptr, layout);
+        }
+    }
+
+    template <size_t Size, size_t Align = alignof(std::max_align_t)>
+    inline void *allocate() noexcept {
+        static_assert(Size <= Max, "no bucket for this size");
+        return details::allocate_static<Size, Align>(
+            std::get<bucket_of(Size)>(buckets_));
+    }
+
+    template <size_t Size, size_t Align = alignof(std::max_align_t)>
+    inline void deallocate(void *ptr) noexcept {
+        static_assert(Size <= Max, "no bucket for this size");
+        details::deallocate_static<Size, Align>(
+            std::get<bucket_of(Size)>(buckets_), ptr);
+    }
+
+    inline bool owns(const void *ptr) const noexcept {
+        return std::apply(
+            [ptr](const auto &...b) { return (b.owns(ptr) || ...); },
+            buckets_);
+    }
+
+    inline void reset() noexcept {
+        std::apply([](auto &...b) { (b.reset(), ...); }, buckets_);
+    }
+};
+
+//
+// Every request straight from a `MemoryProvider`, for the rare huge block.
+// Each block is preceded by a small header linking the live blocks, so the
+// allocator can tell its blocks and `reset` gives all of them back.
+//
+
+template <MemoryProvider Provider = PageProvider> class ProviderAllocator {
+    struct Header {
+        Header *prev;
+        Header *next;
+        size_t prefix; // bytes from the chunk base to the block.
+        Layout chunk;
+    };
+
+    Header *live_;
+    [[no_unique_address]] Provider provider_;
+
+    static inline Header *header_of(const void *ptr) noexcept {
+        return reinterpret_cast<Header *>(
+                   const_cast<char *>(static_cast<const char *>(ptr))) -
+               1;
+    }
+
+  public:
+    ProviderAllocator() noexcept
+        : live_(nullptr) {}
+
+    explicit ProviderAllocator(Provider provider) noexcept
+        : live_(nullptr)
+        , provider_(std::move(provider)) {}
+
+    ProviderAllocator(const ProviderAllocator &) = delete;
+    ProviderAllocator &operator=(const ProviderAllocator &) = delete;
+
+    ProviderAllocator(ProviderAllocator &&other) noexcept
+        : live_(std::exchange(other.live_, nullptr))
+        , provider_(std::move(other.provider_)) {}
+
+    ProviderAllocator &operator=(ProviderAllocator &&other) noexcept {
+        if (this != &other) {
+            reset();
+            live_ = std::exchange(other.live_, nullptr);
+            provider_ = std::move(other.provider_);
+        }
+        return *this;
+    }
+
+    ~ProviderAllocator() { reset(); }
+
+    Provider &provider() noexcept { return provider_; }
+
+    void *allocate(Layout layout) noexcept {
+        if (layout.align() == 0) {
+            return nullptr;
+        }
+        size_t align = std::max(layout.align(), alignof(Header));
+        size_t prefix = align_up(sizeof(Header), align);
+        auto size = checked_add(prefix, layout.size());
+        if (!size) {
+            return nullptr;
+        }
+        auto chunk = Layout::from_size_align(size.value(), align);
+        if (!chunk) {
+            return nullptr;
+        }
+        auto base =
+            static_cast<char *>(provider_.allocate_chunk(chunk.value()));
+        if (base == nullptr) {
+            return nullptr;
+        }
+        Header *h = header_of(base + prefix);
+        h->prev = nullptr;
+        h->next = live_;
+        h->prefix = prefix;
+        h->chunk = chunk.value();
+        if (live_) {
+            live_->prev = h;
+        }
+        live_ = h;
+        return base + prefix;
+    }
+
+    void deallocate(void *ptr, Layout = Layout()) noexcept {
+        if (ptr == nullptr) {
+            return;
+        }
+        Header *h = header_of(ptr);
+        (h->prev ? h->prev->next : live_) = h->next;
+        if (h->next) {
+            h->next->prev = h->prev;
+        }
+        provider_.deallocate_chunk(static_cast<char *>(ptr) - h->prefix,
+                                   h->chunk);
+    }
+
+    // walks the live blocks, there are meant to be few.
+    bool owns(const void *ptr) const noexcept {
+        for (Header *h = live_; h; h = h->next) {
+            auto p = static_cast<const char *>(ptr);
+            auto block = reinterpret_cast<const char *>(h + 1);
+            if (p >= block && p < block + h->chunk.size() - h->prefix) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // give every block back to the provider.
+    void reset() noexcept {
+        while (live_) {
+            deallocate(live_ + 1);
+        }
+    }
+};
+
+} // namespace alloy
+
+#endif
@@ -0,0 +1,372 @@
+#ifndef _ALLOY_CONCURRENT_BUMP_ALLOCATOR_HPP
+#define _ALLOY_CONCURRENT_BUMP_ALLOCATOR_HPP
+#pragma once
+
+#include "allocator_stats.hpp"
+#include "cache_padded.hpp"
+#include "memlayout.hpp"
+#include "page_provider.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace alloy {
+
+//
+// Thread safe bump allocator (arena).
+//
+// Any number of threads allocate at once; a block is reserved with a single
+// `fetch_add` on the cursor of the current chunk. The cursor only moves by
+// multiples of `granule` (`alignof(std::max_align_t)`), so a layout aligned
+// to at most the granule costs exactly its size rounded up to it, and a
+// larger alignment reserves `align - granule` more bytes to align the block
+// in.
+//
+// Threads on different cores don't share a cursor: the arena keeps one shard
+// per core, each on a cache line of its own with a current chunk, and a
+// thread bumps the shard of the CPU it runs on. When the chunk of a shard is
+// exhausted the first thread to notice chains a fresh chunk in front of it
+// under the arena's lock, the others retry on the new one.
+//
+// Individual deallocation is a no-op, except for the most recent block of a
+// chunk when no thread has bumped past it. The memory of a phase is given
+// back at once with `reset()`, which is the boundary between two phases: it
+// must not race with any other call, it must happen after every allocation
+// of the phase (join the workers or pass a barrier) and every block is
+// dead once it returns. Chunks are kept for the next phase; `release()`
+// returns them to the provider.
+//
+//     alloy::ConcurrentBumpAllocator arena;
+//     for (auto &batch : batches) {
+//         run_parallel(batch, [&](Item &item) {
+//             auto *partial = arena.allocate<Partial>(item.n);
+//             ...
+//         });
+//         arena.reset(); // after the workers are done
+//     }
+//
+
+template <MemoryProvider Provider = HeapProvider, StatsPolicy Stats = NoStats>
+class BasicConcurrentBumpAllocator {
+    static_assert(Stats::thread_safe,
+                  "the concurrent bump allocator is shared between threads");
+
+    // header placed at the start of every chunk. `cursor` is the offset of
+    // the first free byte, counted from the chunk base; it runs past `size`
+    // once the chunk is exhausted.
+    struct Chunk {
+        Chunk *prev;
+        size_t size;  // total bytes of the chunk, header included.
+        size_t align; // alignment of the chunk base.
+        std::atomic<size_t> cursor;
+    };
+
+    struct Shard {
+        std::atomic<Chunk *> current{ nullptr };
+    };
+
+  public:
+    using allocator_type = BasicConcurrentBumpAllocator<Provider, Stats>;
+    using provider_type = Provider;
+    using stats_type = Stats;
+
+    // may be called from several threads at once.
+    static constexpr bool thread_safe = true;
+
+    static constexpr size_t default_chunk_size = 64 * 1024;
+    static constexpr size_t max_chunk_size = 64 * 1024 * 1024;
+    static constexpr size_t chunk_align = 4096;
+    static constexpr size_t granule = alignof(std::max_align_t);
+    static constexpr size_t max_shards = 64;
+
+  private:
+    static constexpr size_t header_size = align_up(sizeof(Chunk), granule);
+
+    std::unique_ptr<cache_padded<Shard>[]> shards_;
+    size_t shard_mask_;
+    mutable std::mutex mutex_; // guards refills, `spare_` and the provider.
+    Chunk *spare_;
+    size_t next_chunk_size_;
+    [[no_unique_address]] Provider provider_;
+    [[no_unique_address]] Stats stats_;
+
+  public:
+    // `shards` is rounded up to a power of two, at most `max_shards`; 0
+    // takes one per hardware thread.
+    explicit BasicConcurrentBumpAllocator(
+        size_t chunk_size = default_chunk_size, size_t shards = 0,
+        Provider provider = Provider())
+        : shard_mask_(shard_count(shards) - 1)
+        , spare_(nullptr)
+        , next_chunk_size_(std::max(chunk_size, header_size))
+        , provider_(std::move(provider)) {
+        shards_ = std::make_unique<cache_padded<Shard>[]>(shard_mask_ + 1);
+    }
+
+    BasicConcurrentBumpAllocator(const BasicConcurrentBumpAllocator &) =
+        delete;
+    BasicConcurrentBumpAllocator &
+    operator=(const BasicConcurrentBumpAllocator &) = delete;
+
+    ~BasicConcurrentBumpAllocator() { release(); }
+
+    Provider &provider() noexcept { return provider_; }
+
+    AllocatorStats statistics() const noexcept { return stats_.snapshot(); }
+
+    size_t shards() const noexcept { return shard_mask_ + 1; }
+
+    // allocate a block described by `layout`. Returns nullptr when the
+    // layout is invalid or the system is out of memory.
+    inline void *allocate(Layout layout) noexcept {
+        if (layout.align() == 0) {
+            stats_.on_failure(layout);
+            return nullptr;
+        }
+        Shard &shard = local_shard();
+        Chunk *chunk = shard.current.load(std::memory_order_acquire);
+        if (chunk && layout.align() <= chunk->align) {
+            if (void *p = bump(chunk, layout)) {
+                return p;
+            }
+        }
+        void *p = allocate_slow(shard, chunk, layout);
+        if (p == nullptr) {
+            stats_.on_failure(layout);
+        }
+        return p;
+    }
+
+    // allocate storage for `n` objects of type T.
+    template <typename T> inline T *allocate(size_t n = 1) noexcept {
+        if (auto p = Layout::of<T>().repeat(n)) {
+            return static_cast<T *>(allocate(p.value().first));
+        }
+        return nullptr;
+    }
+
+    // gives the block back when it is the last one of the calling thread's
+    // chunk, everything else is reclaimed by `reset()`.
+    inline void deallocate(void *ptr, Layout layout) noexcept {
+        if (ptr == nullptr) {
+            return;
+        }
+        size_t freed = 0;
+        Chunk *chunk = local_shard().current.load(std::memory_order_acquire);
+        char *base = reinterpret_cast<char *>(chunk);
+        char *p = static_cast<char *>(ptr);
+        if (chunk && layout.align() <= granule && p >= base + header_size &&
+            p < base + chunk->size) {
+            size_t offset = p - base;
+            size_t end = offset + reserve_of(layout);
+            if (chunk->cursor.compare_exchange_strong(
+                    end, offset, std::memory_order_relaxed)) {
+                freed = end - offset;
+            }
+        }
+        stats_.on_deallocate(freed);
+    }
+
+    // whether `ptr` points into a block handed out since the last reset.
+    inline bool owns(const void *ptr) const noexcept {
+        auto p = static_cast<const char *>(ptr);
+        for (size_t i = 0; i <= shard_mask_; ++i) {
+            for (Chunk *c = shards_[i]->current.load(
+                     std::memory_order_acquire);
+                 c; c = c->prev) {
+                auto base = reinterpret_cast<const char *>(c);
+                if (p >= base + header_size && p < base + used_of(c)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // drop every allocation and start a new phase. Chunks are kept for
+    // reuse. Must not race with any other call.
+    inline void reset() noexcept {
+        std::lock_guard lock(mutex_);
+        for (size_t i = 0; i <= shard_mask_; ++i) {
+            Chunk *c = shards_[i]->current.exchange(
+                nullptr, std::memory_order_relaxed);
+            while (c) {
+                Chunk *prev = std::exchange(c->prev, spare_);
+                spare_ = c;
+                c = prev;
+            }
+        }
+        stats_.on_reset();
+    }
+
+    // drop every allocation and return all chunks to the provider.
+    inline void release() noexcept {
+        reset();
+        std::lock_guard lock(mutex_);
+        while (spare_) {
+            Chunk *c = std::exchange(spare_, spare_->prev);
+            provider_.deallocate_chunk(
+                c, Layout::from_size_align(c->size, c->align).value());
+        }
+    }
+
+    // bytes handed out from live chunks, padding included. Exact once the
+    // threads allocating have stopped.
+    inline size_t used() const noexcept {
+        size_t n = 0;
+        for (size_t i = 0; i <= shard_mask_; ++i) {
+            for (Chunk *c = shards_[i]->current.load(
+                     std::memory_order_acquire);
+                 c; c = c->prev) {
+                n += used_of(c) - header_size;
+            }
+        }
+        return n;
+    }
+
+    // bytes held from the provider, spare chunks included.
+    inline size_t capacity() const noexcept {
+        size_t n = 0;
+        for (size_t i = 0; i <= shard_mask_; ++i) {
+            for (Chunk *c = shards_[i]->current.load(
+                     std::memory_order_acquire);
+                 c; c = c->prev) {
+                n += c->size;
+            }
+        }
+        std::lock_guard lock(mutex_);
+        for (Chunk *c = spare_; c; c = c->prev) {
+            n += c->size;
+        }
+        return n;
+    }
+
+  private:
+    static inline size_t shard_count(size_t shards) noexcept {
+        if (shards == 0) {
+            shards = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+        return std::min(std::bit_ceil(shards), max_shards);
+    }
+
+    // the shard of the CPU the calling thread runs on, or one picked per
+    // thread when the CPU is unknown.
+    inline Shard &local_shard() noexcept {
+#if defined(__linux__)
+        int cpu = sched_getcpu();
+        if (cpu >= 0) {
+            return *shards_[static_cast<size_t>(cpu) & shard_mask_];
+        }
+#endif
+        static std::atomic<size_t> next{ 0 };
+        static thread_local size_t index =
+            next.fetch_add(1, std::memory_order_relaxed);
+        return *shards_[index & shard_mask_];
+    }
+
+    static inline size_t used_of(const Chunk *c) noexcept {
+        return std::min(c->cursor.load(std::memory_order_relaxed), c->size);
+    }
+
+    // bytes a block of `layout` takes from a cursor, or 0 when that
+    // overflows.
+    static inline size_t reserve_of(Layout layout) noexcept {
+        auto size = checked_add(layout.size(), granule - 1);
+        if (!size) {
+            return 0;
+        }
+        size_t rounded = size.value() & ~(granule - 1);
+        if (layout.align() <= granule) {
+            return std::max(rounded, granule);
+        }
+        return checked_add(rounded, layout.align() - granule).value_or(0);
+    }
+
+    inline void *bump(Chunk *chunk, Layout layout) noexcept {
+        size_t reserve = reserve_of(layout);
+        // a request that can't fit leaves the cursor alone, so it stays far
+        // from overflowing however many threads fail on the chunk.
+        if (reserve == 0 || reserve > chunk->size ||
+            chunk->cursor.load(std::memory_order_relaxed) >
+                chunk->size - reserve) {
+            return nullptr;
+        }
+        size_t offset =
+            chunk->cursor.fetch_add(reserve, std::memory_order_relaxed);
+        if (offset > chunk->size - reserve) {
+            return nullptr;
+        }
+        stats_.on_allocate(layout, reserve);
+        return reinterpret_cast<char *>(chunk) +
+               align_up(offset, layout.align());
+    }
+
+    // first spare chunk that can hold `size` bytes at `align`.
+    inline Chunk *take_spare(size_t size, size_t align) noexcept {
+        for (Chunk **link = &spare_; *link; link = &(*link)->prev) {
+            Chunk *c = *link;
+            if (c->size >= size && c->align >= align) {
+                *link = c->prev;
+                return c;
+            }
+        }
+        return nullptr;
+    }
+
+    // chain a fresh chunk in front of `seen`, unless another thread already
+    // replaced it.
+    void *allocate_slow(Shard &shard, Chunk *seen, Layout layout) noexcept {
+        size_t reserve = reserve_of(layout);
+        auto need = checked_add(header_size, reserve);
+        if (reserve == 0 || !need) {
+            return nullptr;
+        }
+        size_t align = std::max(chunk_align, layout.align());
+
+        std::lock_guard lock(mutex_);
+        Chunk *current = shard.current.load(std::memory_order_acquire);
+        if (current && current != seen &&
+            layout.align() <= current->align) {
+            if (void *p = bump(current, layout)) {
+                return p;
+            }
+        }
+        Chunk *chunk = take_spare(need.value(), align);
+        if (chunk == nullptr) {
+            size_t size = std::max(next_chunk_size_, need.value());
+            auto chunk_layout = Layout::from_size_align(size, align);
+            if (!chunk_layout) {
+                return nullptr;
+            }
+            void *mem = provider_.allocate_chunk(chunk_layout.value());
+            if (mem == nullptr) {
+                return nullptr;
+            }
+            chunk = new (mem) Chunk{ nullptr, size, align, { 0 } };
+            next_chunk_size_ = std::min(next_chunk_size_ * 2, max_chunk_size);
+        }
+        chunk->cursor.store(header_size, std::memory_order_relaxed);
+        chunk->prev = current;
+        // the block is taken before the chunk is published, so it can't
+        // fail.
+        void *p = bump(chunk, layout);
+        shard.current.store(chunk, std::memory_order_release);
+        return p;
+    }
+};
+
+using ConcurrentBumpAllocator = BasicConcurrentBumpAllocator<>;
+
+} // namespace alloy
+
+#endif
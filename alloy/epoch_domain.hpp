@@ -0,0 +1,401 @@
+#ifndef _ALLOY_EPOCH_DOMAIN_HPP
+#define _ALLOY_EPOCH_DOMAIN_HPP
+#pragma once
+
+#include "allocator.hpp"
+#include "memlayout.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace alloy {
+
+//
+// Epoch based deferred reclamation.
+//
+// Lock-free structures can't give a removed node back to the allocator
+// while another thread may still be reading it. `EpochDomain<A>` defers the
+// free instead: readers pin the domain for the duration of an operation,
+// writers unlink a node and `retire` it, and retired blocks go back to the
+// allocator once every thread pinned at the time has unpinned.
+//
+//     alloy::SlabAllocator slab;
+//     alloy::EpochDomain domain(slab);
+//
+//     { // reader
+//         auto guard = domain.pin();
+//         Node *n = head.load(std::memory_order_acquire);
+//         ...                           // n stays valid until the guard goes
+//     }
+//     { // writer
+//         auto guard = domain.pin();
+//         Node *old = head.exchange(fresh, std::memory_order_acq_rel);
+//         domain.retire(old);
+//     }
+//
+// Pinning is a store and a fence on a thread local record, with no shared
+// write, so read mostly paths pay no more than that. The domain keeps a
+// global epoch; it moves forward once every pinned thread has seen the
+// current one, and a block retired in epoch `e` is freed when the global
+// epoch reaches `e + 2`. Each thread keeps its retired blocks in three
+// lists, one per epoch modulo 3, and tries to move the epoch every
+// `batch_size` retirements, so blocks go back to the allocator a list, not
+// one, at a time.
+//
+// The allocator is referenced, not owned. An allocator that declares
+// `thread_safe` (`SlabAllocator`, `ThreadCache`) is called directly; any
+// other is called under the domain's lock, once per batch, and should then
+// be used through `allocate` and `retire` only.
+//
+// Blocks of an exiting thread stay with its record until another thread
+// adopts it; the destructor frees whatever is left.
+//
+
+template <LayoutAllocator Allocator> class EpochDomain {
+    struct Retired {
+        void *ptr;
+        Layout layout;
+    };
+
+    struct Limbo {
+        uint64_t epoch = 0;
+        std::vector<Retired> blocks;
+    };
+
+    // one per thread using the domain.
+    struct alignas(64) Record {
+        // `(epoch << 1) | 1` while pinned, 0 otherwise.
+        std::atomic<uint64_t> state{ 0 };
+        std::atomic<bool> active{ false };
+        std::atomic<size_t> pending{ 0 };
+        Record *next = nullptr;
+        size_t depth = 0; // nested pins.
+        size_t since_collect = 0;
+        std::array<Limbo, 3> limbo;
+    };
+
+    // per thread list of the records it holds, one per live domain.
+    struct ThreadRecords {
+        struct Entry {
+            uint64_t id;
+            Record *record;
+        };
+        Entry last{ 0, nullptr };
+        std::vector<Entry> entries;
+
+        ~ThreadRecords() {
+            for (auto &e : entries) {
+                abandon(e.id, e.record);
+            }
+        }
+    };
+
+  public:
+    using allocator_type = Allocator;
+
+    static constexpr bool allocator_thread_safe =
+        details::thread_safe_allocator<Allocator>;
+    static constexpr size_t default_batch_size = 64;
+
+    // unpins the domain when it goes out of scope.
+    class Guard {
+        Record *record_;
+
+        friend class EpochDomain;
+
+        explicit Guard(Record *record) noexcept
+            : record_(record) {}
+
+      public:
+        Guard(Guard &&other) noexcept
+            : record_(std::exchange(other.record_, nullptr)) {}
+
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+        Guard &operator=(Guard &&) = delete;
+
+        ~Guard() {
+            if (record_ && --record_->depth == 0) {
+                record_->state.store(0, std::memory_order_release);
+            }
+        }
+    };
+
+  private:
+    Allocator &allocator_;
+    size_t batch_size_;
+    uint64_t id_;
+    std::atomic<uint64_t> epoch_;
+    std::atomic<Record *> records_; // every record, never unlinked.
+    std::mutex mutex_; // guards `owned_` and a non thread safe allocator.
+    std::vector<std::unique_ptr<Record>> owned_;
+
+  public:
+    explicit EpochDomain(Allocator &allocator,
+                         size_t batch_size = default_batch_size)
+        : allocator_(allocator)
+        , batch_size_(batch_size ? batch_size : 1)
+        , id_(register_domain())
+        , epoch_(1)
+        , records_(nullptr) {}
+
+    EpochDomain(const EpochDomain &) = delete;
+    EpochDomain &operator=(const EpochDomain &) = delete;
+
+    // no thread may be pinned.
+    ~EpochDomain() {
+        unregister_domain(id_);
+        reclaim_all();
+    }
+
+    Allocator &allocator() noexcept { return allocator_; }
+
+    uint64_t epoch() const noexcept {
+        return epoch_.load(std::memory_order_relaxed);
+    }
+
+    // retired blocks not freed yet, over all threads.
+    size_t pending() const noexcept {
+        size_t n = 0;
+        for (Record *r = records_.load(std::memory_order_acquire); r;
+             r = r->next) {
+            n += r->pending.load(std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    // enter a critical section: no block reachable from here is freed
+    // before the guard is destroyed. Pins nest.
+    Guard pin() {
+        Record *r = local_record();
+        if (r->depth++ == 0) {
+            uint64_t e = epoch_.load(std::memory_order_relaxed);
+            r->state.store((e << 1) | 1, std::memory_order_relaxed);
+            // the announcement must be visible before any load of the
+            // structure.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        return Guard(r);
+    }
+
+    // a block from the allocator, under the domain's lock unless the
+    // allocator is thread safe.
+    void *allocate(Layout layout) noexcept {
+        if constexpr (allocator_thread_safe) {
+            return allocator_.allocate(layout);
+        } else {
+            std::lock_guard lock(mutex_);
+            return allocator_.allocate(layout);
+        }
+    }
+
+    // free `ptr` once no thread can still be reading it. `ptr` must already
+    // be unreachable from the structure. May throw `std::bad_alloc` when
+    // the retired list can't grow.
+    void retire(void *ptr, Layout layout) {
+        if (ptr == nullptr) {
+            return;
+        }
+        Record *r = local_record();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t e = epoch_.load(std::memory_order_relaxed);
+        Limbo &limbo = r->limbo[e % 3];
+        if (limbo.epoch != e) {
+            // holds blocks of epoch `e - 3` or older, all safe.
+            free_blocks(*r, limbo);
+            limbo.epoch = e;
+        }
+        limbo.blocks.push_back({ ptr, layout });
+        r->pending.fetch_add(1, std::memory_order_relaxed);
+        if (++r->since_collect >= batch_size_) {
+            r->since_collect = 0;
+            try_advance();
+            collect(*r);
+        }
+    }
+
+    // trivially destructible objects only, the domain never runs
+    // destructors.
+    template <typename T> void retire(T *ptr) {
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "retired objects are freed without being destroyed");
+        retire(ptr, Layout::of<T>());
+    }
+
+    // move the global epoch forward if every pinned thread has seen the
+    // current one.
+    bool try_advance() noexcept {
+        uint64_t e = epoch_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (Record *r = records_.load(std::memory_order_acquire); r;
+             r = r->next) {
+            // acquire: pairs with the unpin of a thread that was reading.
+            uint64_t s = r->state.load(std::memory_order_acquire);
+            if ((s & 1) && (s >> 1) != e) {
+                return false;
+            }
+        }
+        return epoch_.compare_exchange_strong(e, e + 1,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_relaxed);
+    }
+
+    // try to move the epoch and free the calling thread's blocks that are
+    // safe.
+    void collect() {
+        try_advance();
+        collect(*local_record());
+    }
+
+    // free every retired block of every thread. No thread may be pinned or
+    // use the domain concurrently.
+    void reclaim_all() noexcept {
+        std::lock_guard lock(mutex_);
+        for (auto &r : owned_) {
+            for (Limbo &limbo : r->limbo) {
+                free_unlocked(*r, limbo);
+            }
+        }
+    }
+
+  private:
+    // free the lists of `r` that no pinned thread can reach.
+    void collect(Record &r) noexcept {
+        uint64_t e = epoch_.load(std::memory_order_acquire);
+        for (Limbo &limbo : r.limbo) {
+            if (limbo.epoch + 2 <= e) {
+                free_blocks(r, limbo);
+            }
+        }
+    }
+
+    void free_blocks(Record &r, Limbo &limbo) noexcept {
+        if (limbo.blocks.empty()) {
+            return;
+        }
+        if constexpr (allocator_thread_safe) {
+            free_unlocked(r, limbo);
+        } else {
+            std::lock_guard lock(mutex_);
+            free_unlocked(r, limbo);
+        }
+    }
+
+    void free_unlocked(Record &r, Limbo &limbo) noexcept {
+        for (const Retired &b : limbo.blocks) {
+            allocator_.deallocate(b.ptr, b.layout);
+        }
+        r.pending.fetch_sub(limbo.blocks.size(), std::memory_order_relaxed);
+        limbo.blocks.clear();
+    }
+
+    //
+    // Thread to record mapping.
+    //
+
+    static inline ThreadRecords &thread_records() noexcept {
+        static thread_local ThreadRecords records;
+        return records;
+    }
+
+    // ids of live domains. A thread exiting after its domain is gone must
+    // not touch the record.
+    struct Registry {
+        std::mutex mutex;
+        std::unordered_set<uint64_t> live;
+        uint64_t next_id = 1;
+    };
+
+    static inline Registry &registry() noexcept {
+        static Registry registry;
+        return registry;
+    }
+
+    static inline uint64_t register_domain() {
+        auto &r = registry();
+        std::lock_guard lock(r.mutex);
+        r.live.insert(r.next_id);
+        return r.next_id++;
+    }
+
+    static inline void unregister_domain(uint64_t id) noexcept {
+        auto &r = registry();
+        std::lock_guard lock(r.mutex);
+        r.live.erase(id);
+    }
+
+    // the retired blocks of an exiting thread stay in its record until
+    // another thread adopts it.
+    static inline void abandon(uint64_t id, Record *record) noexcept {
+        auto &r = registry();
+        std::lock_guard lock(r.mutex);
+        if (r.live.count(id)) {
+            record->active.store(false, std::memory_order_release);
+        }
+    }
+
+    inline Record *local_record() {
+        auto &tls = thread_records();
+        if (tls.last.id == id_) {
+            return tls.last.record;
+        }
+        for (auto &e : tls.entries) {
+            if (e.id == id_) {
+                tls.last = e;
+                return e.record;
+            }
+        }
+        return attach_record();
+    }
+
+    // adopt an abandoned record, or create one.
+    Record *attach_record() {
+        std::lock_guard lock(mutex_);
+        Record *record = nullptr;
+        for (auto &r : owned_) {
+            bool expected = false;
+            if (r->active.compare_exchange_strong(
+                    expected, true, std::memory_order_acquire)) {
+                record = r.get();
+                break;
+            }
+        }
+        try {
+            if (record == nullptr) {
+                owned_.push_back(std::make_unique<Record>());
+                record = owned_.back().get();
+                record->active.store(true, std::memory_order_relaxed);
+                record->next = records_.load(std::memory_order_relaxed);
+                records_.store(record, std::memory_order_release);
+            }
+
+            auto &tls = thread_records();
+            {
+                // forget records of domains that are gone.
+                auto &r = registry();
+                std::lock_guard registry_lock(r.mutex);
+                std::erase_if(tls.entries, [&](auto &e) {
+                    return r.live.count(e.id) == 0;
+                });
+            }
+            tls.entries.push_back({ id_, record });
+            tls.last = tls.entries.back();
+        } catch (...) {
+            if (record) {
+                record->active.store(false, std::memory_order_release);
+            }
+            throw;
+        }
+        return record;
+    }
+};
+
+} // namespace alloy
+
+#endif
@@ -2,12 +2,274 @@
 #define _ALLOY_FIXED_SIZE_ALLOCATOR_HPP
 #pragma once
 
+#include "allocator_stats.hpp"
 #include "memlayout.hpp"
+#include "page_provider.hpp"
+#include <algorithm>
 #include <memory>
+#include <new>
+#include <utility>
 
+namespace alloy {
+
+//
+// Fixed size block pool.
+// Every block has the same layout, fixed at compile time. Freed blocks are
+// threaded into an intrusive free list that lives inside the blocks
+// themselves, so allocation and deallocation are a pointer pop/push.
+//
+// Blocks are carved out of chunks laid out with `Layout::repeat`, which gives
+// the stride between blocks. A fresh chunk is carved lazily, so growing the
+// pool costs one system allocation and no initialization pass.
+//
+
+template <size_t Size, size_t Align = alignof(std::max_align_t),
+          MemoryProvider Provider = HeapProvider, StatsPolicy Stats = NoStats>
 class FixedSizeAllocator {
-    using allocator_type = FixedSizeAllocator;
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    struct Chunk {
+        Chunk *next;
+        size_t blocks;
+    };
+
+  public:
+    using allocator_type = FixedSizeAllocator<Size, Align, Provider, Stats>;
+    using provider_type = Provider;
+    using stats_type = Stats;
+
+    // layout of a single block. A block is at least large enough to hold the
+    // free list link.
+    static constexpr Layout layout =
+        Layout::from_size_align(std::max(Size, sizeof(FreeBlock)),
+                                std::max(Align, alignof(FreeBlock)))
+            .value()
+            .pad_to_align();
+
+    static constexpr size_t default_chunk_bytes = 64 * 1024;
+    static constexpr size_t default_blocks_per_chunk =
+        std::max<size_t>(16, default_chunk_bytes / layout.size());
+
+  private:
+    FreeBlock *free_;
+    Chunk *head_;  // oldest chunk
+    Chunk *tail_;  // newest chunk
+    Chunk *carve_; // chunk the next untouched block comes from
+    char *cursor_; // next untouched block in `carve_`
+    char *end_;
+    size_t blocks_per_chunk_;
+    [[no_unique_address]] Provider provider_;
+    [[no_unique_address]] Stats stats_;
+
+  public:
+    explicit FixedSizeAllocator(
+        size_t blocks_per_chunk = default_blocks_per_chunk,
+        Provider provider = Provider()) noexcept
+        : free_(nullptr)
+        , head_(nullptr)
+        , tail_(nullptr)
+        , carve_(nullptr)
+        , cursor_(nullptr)
+        , end_(nullptr)
+        , blocks_per_chunk_(std::max<size_t>(1, blocks_per_chunk))
+        , provider_(std::move(provider)) {}
+
+    FixedSizeAllocator(const FixedSizeAllocator &) = delete;
+    FixedSizeAllocator &operator=(const FixedSizeAllocator &) = delete;
+
+    FixedSizeAllocator(FixedSizeAllocator &&other) noexcept
+        : free_(std::exchange(other.free_, nullptr))
+        , head_(std::exchange(other.head_, nullptr))
+        , tail_(std::exchange(other.tail_, nullptr))
+        , carve_(std::exchange(other.carve_, nullptr))
+        , cursor_(std::exchange(other.cursor_, nullptr))
+        , end_(std::exchange(other.end_, nullptr))
+        , blocks_per_chunk_(other.blocks_per_chunk_)
+        , provider_(std::move(other.provider_))
+        , stats_(std::exchange(other.stats_, Stats())) {}
+
+    FixedSizeAllocator &operator=(FixedSizeAllocator &&other) noexcept {
+        if (this != &other) {
+            release();
+            free_ = std::exchange(other.free_, nullptr);
+            head_ = std::exchange(other.head_, nullptr);
+            tail_ = std::exchange(other.tail_, nullptr);
+            carve_ = std::exchange(other.carve_, nullptr);
+            cursor_ = std::exchange(other.cursor_, nullptr);
+            end_ = std::exchange(other.end_, nullptr);
+            blocks_per_chunk_ = other.blocks_per_chunk_;
+            provider_ = std::move(other.provider_);
+            stats_ = std::exchange(other.stats_, Stats());
+        }
+        return *this;
+    }
+
+    ~FixedSizeAllocator() { release(); }
+
+    Provider &provider() noexcept { return provider_; }
+
+    AllocatorStats statistics() const noexcept { return stats_.snapshot(); }
+
+    // allocate one block.
+    inline void *allocate() noexcept { return allocate(layout); }
 
+    // allocate a block for `l`. Fails if `l` doesn't fit in a block.
+    inline void *allocate(Layout l) noexcept {
+        void *p = l.size() <= layout.size() && l.align() <= layout.align()
+                      ? take()
+                      : nullptr;
+        if (p) {
+            stats_.on_allocate(l, layout.size());
+        } else {
+            stats_.on_failure(l);
+        }
+        return p;
+    }
+
+    // allocate a block for a layout known at compile time. It fits, so
+    // nothing is left to check.
+    template <size_t S, size_t A = alignof(std::max_align_t)>
+        requires(S <= layout.size() && A <= layout.align())
+    inline void *allocate() noexcept {
+        void *p = take();
+        if (p) {
+            stats_.on_allocate(Layout::fixed<S, A>(), layout.size());
+        } else {
+            stats_.on_failure(Layout::fixed<S, A>());
+        }
+        return p;
+    }
+
+    template <size_t S, size_t A = alignof(std::max_align_t)>
+        requires(S <= layout.size() && A <= layout.align())
+    inline void deallocate(void *ptr) noexcept {
+        deallocate(ptr);
+    }
+
+    inline void deallocate(void *ptr) noexcept {
+        if (ptr == nullptr) {
+            return;
+        }
+        auto block = static_cast<FreeBlock *>(ptr);
+        block->next = free_;
+        free_ = block;
+        stats_.on_deallocate(layout.size());
+    }
+
+    inline void deallocate(void *ptr, Layout) noexcept { deallocate(ptr); }
+
+    // whether `ptr` is the start of a block of this pool.
+    inline bool owns(const void *ptr) const noexcept {
+        auto p = static_cast<const char *>(ptr);
+        for (Chunk *c = head_; c; c = c->next) {
+            const char *first = blocks_of(c);
+            const char *last = first + c->blocks * layout.size();
+            if (p >= first && p < last) {
+                return (p - first) % layout.size() == 0;
+            }
+        }
+        return false;
+    }
+
+    // drop every block. Chunks are kept and carved again from the start.
+    inline void reset() noexcept {
+        stats_.on_reset();
+        free_ = nullptr;
+        carve_ = head_;
+        if (carve_) {
+            cursor_ = blocks_of(carve_);
+            end_ = cursor_ + carve_->blocks * layout.size();
+        } else {
+            cursor_ = end_ = nullptr;
+        }
+    }
+
+    // drop every block and return all chunks to the provider.
+    inline void release() noexcept {
+        stats_.on_reset();
+        while (head_) {
+            Chunk *c = std::exchange(head_, head_->next);
+            provider_.deallocate_chunk(c,
+                                       chunk_layout(c->blocks).value().first);
+        }
+        tail_ = carve_ = nullptr;
+        free_ = nullptr;
+        cursor_ = end_ = nullptr;
+    }
+
+    // number of blocks held from the provider.
+    inline size_t capacity() const noexcept {
+        size_t n = 0;
+        for (Chunk *c = head_; c; c = c->next) {
+            n += c->blocks;
+        }
+        return n;
+    }
+
+  private:
+    // layout of a chunk holding `n` blocks and the offset of the first block.
+    static M_CEXPR std::optional<std::pair<Layout, size_t>>
+    chunk_layout(size_t n) noexcept {
+        if (auto blocks = layout.repeat(n)) {
+            return Layout::create<Chunk>().value().extend(
+                blocks.value().first);
+        }
+        return {};
+    }
+
+    inline void *take() noexcept {
+        if (free_) {
+            return std::exchange(free_, free_->next);
+        }
+        if (cursor_ != end_) {
+            return std::exchange(cursor_, cursor_ + layout.size());
+        }
+        return allocate_slow();
+    }
+
+    static inline char *blocks_of(Chunk *c) noexcept {
+        return reinterpret_cast<char *>(c) +
+               chunk_layout(c->blocks).value().second;
+    }
+
+    // move on to the next chunk, allocating one if all are carved.
+    void *allocate_slow() noexcept {
+        if (carve_ && carve_->next) {
+            carve_ = carve_->next;
+        } else {
+            auto chunk = chunk_layout(blocks_per_chunk_);
+            if (!chunk) {
+                return nullptr;
+            }
+            void *mem = provider_.allocate_chunk(chunk.value().first);
+            if (mem == nullptr) {
+                return nullptr;
+            }
+            auto c = static_cast<Chunk *>(mem);
+            c->next = nullptr;
+            c->blocks = blocks_per_chunk_;
+            if (tail_) {
+                tail_->next = c;
+            } else {
+                head_ = c;
+            }
+            tail_ = carve_ = c;
+        }
+        cursor_ = blocks_of(carve_);
+        end_ = cursor_ + carve_->blocks * layout.size();
+        return std::exchange(cursor_, cursor_ + layout.size());
+    }
 };
 
+// pool of blocks laid out as `Layout::of<T>()`.
+template <typename T, MemoryProvider Provider = HeapProvider,
+          StatsPolicy Stats = NoStats>
+using FixedSizeAllocatorFor =
+    FixedSizeAllocator<Layout::of<T>().size(), Layout::of<T>().align(),
+                       Provider, Stats>;
+
+} // namespace alloy
+
 #endif
@@ -0,0 +1,423 @@
+#ifndef _ALLOY_GUARDED_ALLOCATOR_HPP
+#define _ALLOY_GUARDED_ALLOCATOR_HPP
+#pragma once
+
+#include "allocator.hpp"
+#include "allocator_stats.hpp"
+#include "memlayout.hpp"
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+// guarded allocators check their blocks unless NDEBUG is defined; define
+// ALLOY_GUARDED to 0 or 1 to choose regardless of it.
+#ifndef ALLOY_GUARDED
+#if defined(NDEBUG)
+#define ALLOY_GUARDED 0
+#else
+#define ALLOY_GUARDED 1
+#endif
+#endif
+
+namespace alloy {
+
+//
+// Guarded allocators (debug mode).
+//
+// `GuardedAllocator<A, Guards>` wraps any `LayoutAllocator` and catches the
+// usual heap bugs on the allocator stack that ships, without a sanitizer
+// build:
+//   - each block sits between two red zones filled with a canary. The front
+//     zone is `Guards::red_zone` rounded up to the block's alignment, the
+//     back zone the layout's own tail padding (`Layout::pad_to_align`) plus
+//     `red_zone`. Broken canaries are reported when the block is freed.
+//   - new blocks are filled with `alloc_fill`, freed ones with `free_fill`
+//     and held in a quarantine of `Guards::quarantine` blocks; a write to a
+//     block in quarantine is reported when it leaves it.
+//   - double frees, frees of pointers it never handed out and frees with
+//     another layout than the allocation's are reported, and not forwarded.
+//   - blocks of at least `Guards::guard_pages_from` bytes (0: none) are
+//     mapped on their own pages, ending against an inaccessible page, and
+//     made inaccessible while in quarantine, so an overrun or a use after
+//     free faults on the spot.
+//
+// Block bookkeeping is kept out of band, so a stray write can't corrupt it.
+// Errors go to `Guards::on_error`, which prints and aborts by default.
+//
+// `Guarded<A>` is the wrapper when `ALLOY_GUARDED` is set, the default
+// without NDEBUG, and `A` itself otherwise: a release build compiles the
+// guards away entirely.
+//
+//     using Allocator = alloy::Guarded<alloy::SlabAllocator>;
+//
+//     // guard pages for blocks of 64 KiB and more.
+//     struct PagedGuards : alloy::DebugGuards {
+//         static constexpr size_t guard_pages_from = 64 * 1024;
+//     };
+//     alloy::GuardedAllocator<alloy::BumpAllocator, PagedGuards> arena;
+//
+
+enum class GuardError {
+    overflow,        // the back red zone was written.
+    underflow,       // the front red zone was written.
+    use_after_free,  // a block was written while in quarantine.
+    double_free,     // a block in quarantine was freed again.
+    invalid_free,    // the pointer was never handed out.
+    layout_mismatch, // freed with another layout than it was allocated.
+};
+
+M_CEXPR const char *to_string(GuardError e) noexcept {
+    switch (e) {
+    case GuardError::overflow:
+        return "heap buffer overflow";
+    case GuardError::underflow:
+        return "heap buffer underflow";
+    case GuardError::use_after_free:
+        return "write after free";
+    case GuardError::double_free:
+        return "double free";
+    case GuardError::invalid_free:
+        return "free of a pointer never allocated";
+    case GuardError::layout_mismatch:
+        return "free with a different layout";
+    }
+    return "unknown";
+}
+
+template <typename G>
+concept GuardPolicy = requires(GuardError e, const void *ptr, Layout layout) {
+    { G::enabled } -> std::convertible_to<bool>;
+    { G::red_zone } -> std::convertible_to<size_t>;
+    { G::quarantine } -> std::convertible_to<size_t>;
+    { G::guard_pages_from } -> std::convertible_to<size_t>;
+    { G::alloc_fill } -> std::convertible_to<uint8_t>;
+    { G::free_fill } -> std::convertible_to<uint8_t>;
+    { G::canary } -> std::convertible_to<uint8_t>;
+    G::on_error(e, ptr, layout);
+};
+
+// the default checks. Derive from it to change some of them.
+struct DebugGuards {
+    static constexpr bool enabled = true;
+    static constexpr size_t red_zone = 16;
+    static constexpr size_t quarantine = 256;
+    static constexpr size_t guard_pages_from = 0;
+    static constexpr uint8_t alloc_fill = 0xcd;
+    static constexpr uint8_t free_fill = 0xdf;
+    static constexpr uint8_t canary = 0xab;
+
+    static inline void on_error(GuardError e, const void *ptr,
+                                Layout layout) noexcept {
+        std::fprintf(stderr, "alloy: %s at %p (size %zu, align %zu)\n",
+                     to_string(e), ptr, layout.size(), layout.align());
+        std::abort();
+    }
+};
+
+// no checks, `Guarded<A, NoGuards>` is `A`.
+struct NoGuards : DebugGuards {
+    static constexpr bool enabled = false;
+};
+
+using DefaultGuards =
+    std::conditional_t<bool(ALLOY_GUARDED), DebugGuards, NoGuards>;
+
+namespace details {
+
+// first byte in [first, last) that isn't `value`, or `last`.
+inline const uint8_t *find_not(const uint8_t *first, const uint8_t *last,
+                               uint8_t value) noexcept {
+    return std::find_if(first, last,
+                        [value](uint8_t b) { return b != value; });
+}
+
+} // namespace details
+
+template <LayoutAllocator A, GuardPolicy Guards = DebugGuards>
+class GuardedAllocator {
+    // where a block handed out lives.
+    struct Block {
+        uint8_t *base;  // start of the front red zone.
+        Layout outer;   // red zones and block; the mapping when `paged`.
+        Layout layout;  // as requested.
+        bool paged;     // mapped on its own pages, not from `A`.
+    };
+
+    struct Quarantined {
+        uint8_t *ptr;
+        Block block;
+    };
+
+    A alloc_;
+    mutable std::mutex mutex_;
+    std::unordered_map<const void *, Block> live_;
+    std::deque<Quarantined> quarantine_;
+
+  public:
+    using allocator_type = A;
+    using guards_type = Guards;
+
+    static constexpr bool thread_safe = details::thread_safe_allocator<A>;
+
+    // `args` construct the guarded allocator.
+    template <typename... Args>
+    explicit GuardedAllocator(Args &&...args)
+        : alloc_(std::forward<Args>(args)...) {}
+
+    GuardedAllocator(const GuardedAllocator &) = delete;
+    GuardedAllocator &operator=(const GuardedAllocator &) = delete;
+
+    // blocks still live are given back, unchecked.
+    ~GuardedAllocator() {
+        std::lock_guard lock(mutex_);
+        while (!quarantine_.empty()) {
+            evict();
+        }
+        for (auto &[ptr, block] : live_) {
+            give_back(block);
+        }
+    }
+
+    A &allocator() noexcept { return alloc_; }
+
+    // blocks handed out and not freed yet.
+    size_t live() const noexcept {
+        std::lock_guard lock(mutex_);
+        return live_.size();
+    }
+
+    inline void *allocate(Layout layout) noexcept {
+        if (layout.align() == 0) {
+            return nullptr;
+        }
+        std::lock_guard lock(mutex_);
+        Block block;
+        uint8_t *p = nullptr;
+        if (Guards::guard_pages_from &&
+            layout.size() >= Guards::guard_pages_from &&
+            layout.align() <= page_size()) {
+            p = map_paged(layout, block);
+        } else {
+            p = take(layout, block);
+        }
+        if (p == nullptr) {
+            return nullptr;
+        }
+        try {
+            live_.emplace(p, block);
+        } catch (...) {
+            give_back(block);
+            return nullptr;
+        }
+        std::memset(p, Guards::alloc_fill, layout.size());
+        return p;
+    }
+
+    inline void deallocate(void *ptr, Layout layout) noexcept {
+        if (ptr == nullptr) {
+            return;
+        }
+        std::lock_guard lock(mutex_);
+        auto it = live_.find(ptr);
+        if (it == live_.end()) {
+            bool quarantined = std::any_of(
+                quarantine_.begin(), quarantine_.end(),
+                [ptr](const Quarantined &q) { return q.ptr == ptr; });
+            Guards::on_error(quarantined ? GuardError::double_free
+                                         : GuardError::invalid_free,
+                             ptr, layout);
+            return;
+        }
+        Block block = it->second;
+        live_.erase(it);
+        auto p = static_cast<uint8_t *>(ptr);
+        if (layout.size() != block.layout.size() ||
+            layout.align() != block.layout.align()) {
+            Guards::on_error(GuardError::layout_mismatch, ptr, layout);
+        }
+        check(p, block);
+
+        std::memset(p, Guards::free_fill, block.layout.size());
+        if (block.paged) {
+            mprotect(block.base, block.outer.size(), PROT_NONE);
+        }
+        if constexpr (Guards::quarantine == 0) {
+            give_back(block);
+        } else {
+            try {
+                quarantine_.push_back({ p, block });
+            } catch (...) {
+                give_back(block);
+                return;
+            }
+            if (quarantine_.size() > Guards::quarantine) {
+                evict();
+            }
+        }
+    }
+
+    inline bool owns(const void *ptr) const noexcept {
+        std::lock_guard lock(mutex_);
+        return live_.count(ptr) != 0;
+    }
+
+    // check the red zones of every live block, report and count the broken
+    // ones.
+    size_t check() const noexcept {
+        std::lock_guard lock(mutex_);
+        size_t broken = 0;
+        for (auto &[ptr, block] : live_) {
+            broken += !check(static_cast<uint8_t *>(const_cast<void *>(ptr)),
+                             block);
+        }
+        return broken;
+    }
+
+    // drop every allocation. Live blocks are checked first.
+    inline void reset() noexcept {
+        std::lock_guard lock(mutex_);
+        for (auto &[ptr, block] : live_) {
+            check(static_cast<uint8_t *>(const_cast<void *>(ptr)), block);
+            if (block.paged) {
+                munmap(block.base, block.outer.size());
+            }
+        }
+        for (auto &q : quarantine_) {
+            if (q.block.paged) {
+                munmap(q.block.base, q.block.outer.size());
+            }
+        }
+        live_.clear();
+        quarantine_.clear();
+        alloc_.reset();
+    }
+
+    AllocatorStats statistics() const noexcept
+        requires requires(const A &a) { a.statistics(); }
+    {
+        return alloc_.statistics();
+    }
+
+  private:
+    static inline size_t page_size() noexcept {
+        static const size_t size = sysconf(_SC_PAGESIZE);
+        return size;
+    }
+
+    // a block for `layout` from `A`, between red zones.
+    uint8_t *take(Layout layout, Block &block) noexcept {
+        auto zone = Layout::from_size_align(Guards::red_zone, 1).value();
+        auto front = zone.extend(layout.pad_to_align());
+        if (!front) {
+            return nullptr;
+        }
+        auto outer = front.value().first.extend(zone);
+        if (!outer) {
+            return nullptr;
+        }
+        auto base = static_cast<uint8_t *>(
+            alloc_.allocate(outer.value().first));
+        if (base == nullptr) {
+            return nullptr;
+        }
+        block = { base, outer.value().first, layout, false };
+        uint8_t *p = base + front.value().second;
+        fill_zones(p, block);
+        return p;
+    }
+
+    // a block for `layout` on pages of its own, its end as close to a
+    // trailing inaccessible page as its alignment allows.
+    uint8_t *map_paged(Layout layout, Block &block) noexcept {
+        size_t page = page_size();
+        auto body = checked_add(layout.size(), Guards::red_zone + page - 1);
+        if (!body) {
+            return nullptr;
+        }
+        size_t size = (body.value() & ~(page - 1)) + page;
+        void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            return nullptr;
+        }
+        auto base = static_cast<uint8_t *>(mem);
+        uint8_t *guard = base + size - page;
+        mprotect(guard, page, PROT_NONE);
+        auto end = reinterpret_cast<uintptr_t>(guard) - layout.size();
+        auto p = reinterpret_cast<uint8_t *>(end & ~(layout.align() - 1));
+        block = { base, Layout::from_size_align(size, page).value(), layout,
+                  true };
+        fill_zones(p, block);
+        return p;
+    }
+
+    uint8_t *zones_end(const Block &block) const noexcept {
+        return block.base + block.outer.size() -
+               (block.paged ? page_size() : 0);
+    }
+
+    void fill_zones(uint8_t *p, const Block &block) noexcept {
+        std::memset(block.base, Guards::canary, p - block.base);
+        uint8_t *tail = p + block.layout.size();
+        std::memset(tail, Guards::canary, zones_end(block) - tail);
+    }
+
+    // whether both red zones are intact, reporting the broken ones.
+    bool check(uint8_t *p, const Block &block) const noexcept {
+        bool ok = true;
+        if (details::find_not(block.base, p, Guards::canary) != p) {
+            Guards::on_error(GuardError::underflow, p, block.layout);
+            ok = false;
+        }
+        uint8_t *tail = p + block.layout.size();
+        uint8_t *end = zones_end(block);
+        if (details::find_not(tail, end, Guards::canary) != end) {
+            Guards::on_error(GuardError::overflow, p, block.layout);
+            ok = false;
+        }
+        return ok;
+    }
+
+    // the oldest block of the quarantine goes back, once checked for
+    // writes since it was freed.
+    void evict() noexcept {
+        Quarantined q = quarantine_.front();
+        quarantine_.pop_front();
+        if (!q.block.paged) {
+            uint8_t *end = q.ptr + q.block.layout.size();
+            if (details::find_not(q.ptr, end, Guards::free_fill) != end) {
+                Guards::on_error(GuardError::use_after_free, q.ptr,
+                                 q.block.layout);
+            }
+        }
+        give_back(q.block);
+    }
+
+    void give_back(const Block &block) noexcept {
+        if (block.paged) {
+            munmap(block.base, block.outer.size());
+        } else {
+            alloc_.deallocate(block.base, block.outer);
+        }
+    }
+};
+
+// `A` guarded with `Guards` when they are enabled, `A` itself otherwise.
+template <LayoutAllocator A, GuardPolicy Guards = DefaultGuards>
+using Guarded =
+    std::conditional_t<Guards::enabled, GuardedAllocator<A, Guards>, A>;
+
+} // namespace alloy
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef _ALLOY_INLINE_ARENA_HPP
+#define _ALLOY_INLINE_ARENA_HPP
+#pragma once
+
+#include "allocator.hpp"
+#include "allocator_stats.hpp"
+#include "bump_allocator.hpp"
+#include "memlayout.hpp"
+#include <cstddef>
+#include <utility>
+
+namespace alloy {
+
+//
+// Small buffer arena.
+// `inline_arena<N, Fallback>` bumps through an N byte buffer held in the
+// object itself, so an arena on the stack serves small workloads without
+// touching the heap. Requests that don't fit in what is left of the buffer,
+// or that need more alignment than the buffer has, go to the fallback
+// allocator, any `LayoutAllocator`.
+//
+//     void handle(Request &r) {
+//         alloy::inline_arena<4096> scratch; // falls back to a BumpAllocator
+//         alloy::MemoryResource resource(scratch);
+//         std::pmr::vector<Token> tokens(&resource);
+//         ...
+//     }
+//
+// As in the bump allocator, only the most recent inline block can be given
+// back; `reset()` drops everything, fallback included. The arena can't be
+// moved: its blocks point into the object.
+//
+
+template <size_t N, LayoutAllocator Fallback = BumpAllocator,
+          size_t Align = alignof(std::max_align_t),
+          StatsPolicy Stats = NoStats>
+class inline_arena {
+    static_assert(is_power_of_two(Align), "alignment must be a power of two");
+
+    Layout used_; // bytes of the buffer handed out.
+    [[no_unique_address]] Fallback fallback_;
+    [[no_unique_address]] Stats stats_;
+    alignas(Align) std::byte buffer_[N];
+
+  public:
+    using allocator_type = inline_arena<N, Fallback, Align, Stats>;
+    using fallback_type = Fallback;
+    using stats_type = Stats;
+
+    static constexpr size_t inline_capacity = N;
+    static constexpr size_t buffer_align = Align;
+
+    inline_arena() noexcept(noexcept(Fallback()))
+        : used_(Layout::from_size_align(0, 1).value()) {}
+
+    explicit inline_arena(Fallback fallback) noexcept
+        : used_(Layout::from_size_align(0, 1).value())
+        , fallback_(std::move(fallback)) {}
+
+    inline_arena(const inline_arena &) = delete;
+    inline_arena &operator=(const inline_arena &) = delete;
+
+    Fallback &fallback() noexcept { return fallback_; }
+
+    AllocatorStats statistics() const noexcept { return stats_.snapshot(); }
+
+    inline void *allocate(Layout layout) noexcept {
+        if (layout.align() != 0 && layout.align() <= Align) {
+            if (auto p = used_.extend(layout)) {
+                auto [used, offset] = p.value();
+                // `offset < N` keeps a zero size block at the very end of
+                // the buffer, which `owns_inline` wouldn't accept.
+                if (used.size() <= N && offset < N) {
+                    stats_.on_allocate(layout, used.size() - used_.size());
+                    used_ = used;
+                    return buffer_ + offset;
+                }
+            }
+        }
+        void *p = fallback_.allocate(layout);
+        if (p) {
+            stats_.on_allocate(layout, layout.size());
+        } else {
+            stats_.on_failure(layout);
+        }
+        return p;
+    }
+
+    inline void deallocate(void *ptr, Layout layout) noexcept {
+        if (ptr == nullptr) {
+            return;
+        }
+        if (owns_inline(ptr)) {
+            auto p = static_cast<std::byte *>(ptr);
+            size_t freed = 0;
+            if (p + layout.size() == buffer_ + used_.size()) {
+                freed = used_.size() - (p - buffer_);
+                used_ = Layout::from_size_align(p - buffer_, used_.align())
+                            .value();
+            }
+            stats_.on_deallocate(freed);
+            return;
+        }
+        stats_.on_deallocate(layout.size());
+        fallback_.deallocate(ptr, layout);
+    }
+
+    inline bool owns(const void *ptr) const noexcept {
+        return owns_inline(ptr) || fallback_.owns(ptr);
+    }
+
+    // whether `ptr` is in the inline buffer.
+    inline bool owns_inline(const void *ptr) const noexcept {
+        auto p = static_cast<const std::byte *>(ptr);
+        return p >= buffer_ && p < buffer_ + N;
+    }
+
+    // drop every allocation, inline and from the fallback.
+    inline void reset() noexcept {
+        used_ = Layout::from_size_align(0, 1).value();
+        fallback_.reset();
+        stats_.on_reset();
+    }
+
+    // bytes of the inline buffer handed out, padding included.
+    inline size_t inline_used() const noexcept { return used_.size(); }
+};
+
+} // namespace alloy
+
+#endif
@@ -0,0 +1,268 @@
+#ifndef _ALLOY_INTRUSIVE_LIST_HPP
+#define _ALLOY_INTRUSIVE_LIST_HPP
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace alloy {
+
+//
+// Intrusive doubly linked list.
+//
+// Elements derive from `list_hook<Tag>`, which holds the links, and the list
+// only writes those: it never allocates, and an element is unlinked in O(1)
+// from wherever it is, e.g. an order cancelled out of its price level. The
+// elements are owned by the caller, typically blocks of a
+// `FixedSizeAllocatorFor<T>`. Being a base, the hook sits at offset 0, so a
+// walk over the list reads the links and the first fields of each element
+// from the same cache line.
+//
+// An element can be in one list per tag at a time:
+//
+//     struct Order : list_hook<> { uint64_t id; int64_t qty; };
+//     FixedSizeAllocatorFor<Order> orders;
+//     intrusive_list<Order> level;
+//     Order *o = ::new (orders.allocate()) Order{ {}, 42, 100 };
+//     level.push_back(*o);
+//     ...
+//     level.erase(*o);
+//     orders.deallocate(o);
+//
+// A list must be empty, or cleared, before its elements go away. Copying an
+// element doesn't copy its links.
+//
+
+template <typename Tag = void> class list_hook {
+    template <typename T, typename U> friend class intrusive_list;
+
+    list_hook *prev_ = nullptr;
+    list_hook *next_ = nullptr;
+
+  public:
+    list_hook() noexcept = default;
+    list_hook(const list_hook &) noexcept {}
+    list_hook &operator=(const list_hook &) noexcept { return *this; }
+
+    // whether the element is in a list.
+    bool is_linked() const noexcept { return next_ != nullptr; }
+};
+
+template <typename T, typename Tag = void> class intrusive_list {
+    static_assert(std::derived_from<T, list_hook<Tag>>,
+                  "elements derive from list_hook<Tag>");
+
+    using hook = list_hook<Tag>;
+
+    hook head_; // sentinel of the circular list.
+    size_t size_;
+
+    static T *element(hook *h) noexcept { return static_cast<T *>(h); }
+    static hook *hook_of(T &value) noexcept {
+        return static_cast<hook *>(&value);
+    }
+
+    // link `h` right before `pos`.
+    void link(hook *pos, hook *h) noexcept {
+        h->next_ = pos;
+        h->prev_ = pos->prev_;
+        pos->prev_->next_ = h;
+        pos->prev_ = h;
+        ++size_;
+    }
+
+    void unlink(hook *h) noexcept {
+        h->prev_->next_ = h->next_;
+        h->next_->prev_ = h->prev_;
+        h->prev_ = h->next_ = nullptr;
+        --size_;
+    }
+
+    // take over the elements of `other`, this list being empty.
+    void adopt(intrusive_list &other) noexcept {
+        if (other.empty()) {
+            return;
+        }
+        head_.next_ = other.head_.next_;
+        head_.prev_ = other.head_.prev_;
+        head_.next_->prev_ = &head_;
+        head_.prev_->next_ = &head_;
+        size_ = std::exchange(other.size_, 0);
+        other.head_.next_ = other.head_.prev_ = &other.head_;
+    }
+
+  public:
+    template <bool Const> class basic_iterator {
+        friend class intrusive_list;
+        template <bool> friend class basic_iterator;
+        using node = std::conditional_t<Const, const hook, hook>;
+
+        node *at_;
+
+        explicit basic_iterator(node *at) noexcept
+            : at_(at) {}
+
+      public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T *, T *>;
+        using reference = std::conditional_t<Const, const T &, T &>;
+
+        basic_iterator() noexcept
+            : at_(nullptr) {}
+
+        // a mutable iterator converts to a const one.
+        template <bool C>
+            requires(Const && !C)
+        basic_iterator(const basic_iterator<C> &other) noexcept
+            : at_(other.at_) {}
+
+        reference operator*() const noexcept {
+            return *static_cast<pointer>(at_);
+        }
+        pointer operator->() const noexcept {
+            return static_cast<pointer>(at_);
+        }
+
+        basic_iterator &operator++() noexcept {
+            at_ = at_->next_;
+            return *this;
+        }
+        basic_iterator operator++(int) noexcept {
+            basic_iterator old = *this;
+            at_ = at_->next_;
+            return old;
+        }
+        basic_iterator &operator--() noexcept {
+            at_ = at_->prev_;
+            return *this;
+        }
+        basic_iterator operator--(int) noexcept {
+            basic_iterator old = *this;
+            at_ = at_->prev_;
+            return old;
+        }
+
+        friend bool operator==(const basic_iterator &,
+                               const basic_iterator &) noexcept = default;
+    };
+
+    using value_type = T;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    intrusive_list() noexcept
+        : size_(0) {
+        head_.next_ = head_.prev_ = &head_;
+    }
+
+    intrusive_list(const intrusive_list &) = delete;
+    intrusive_list &operator=(const intrusive_list &) = delete;
+
+    intrusive_list(intrusive_list &&other) noexcept
+        : intrusive_list() {
+        adopt(other);
+    }
+
+    intrusive_list &operator=(intrusive_list &&other) noexcept {
+        if (this != &other) {
+            clear();
+            adopt(other);
+        }
+        return *this;
+    }
+
+    ~intrusive_list() { clear(); }
+
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    // first and last element, nullptr if the list is empty.
+    T *front() noexcept { return empty() ? nullptr : element(head_.next_); }
+    T *back() noexcept { return empty() ? nullptr : element(head_.prev_); }
+
+    // `value` must not be linked by this tag.
+    void push_back(T &value) noexcept { link(&head_, hook_of(value)); }
+    void push_front(T &value) noexcept { link(head_.next_, hook_of(value)); }
+
+    // link `value` right before `pos`.
+    iterator insert(const_iterator pos, T &value) noexcept {
+        link(const_cast<hook *>(pos.at_), hook_of(value));
+        return iterator(hook_of(value));
+    }
+
+    T *pop_front() noexcept {
+        T *value = front();
+        if (value) {
+            unlink(hook_of(*value));
+        }
+        return value;
+    }
+
+    T *pop_back() noexcept {
+        T *value = back();
+        if (value) {
+            unlink(hook_of(*value));
+        }
+        return value;
+    }
+
+    // unlink `value`, which must be in this list. Returns the element that
+    // followed it.
+    iterator erase(T &value) noexcept {
+        hook *next = hook_of(value)->next_;
+        unlink(hook_of(value));
+        return iterator(next);
+    }
+
+    iterator erase(const_iterator pos) noexcept {
+        return erase(*element(const_cast<hook *>(pos.at_)));
+    }
+
+    // iterator to `value`, which must be in this list.
+    iterator iterator_to(T &value) noexcept {
+        return iterator(hook_of(value));
+    }
+
+    // move every element of `other` to the end of this list.
+    void splice(intrusive_list &other) noexcept {
+        if (&other == this || other.empty()) {
+            return;
+        }
+        hook *first = other.head_.next_;
+        hook *last = other.head_.prev_;
+        first->prev_ = head_.prev_;
+        head_.prev_->next_ = first;
+        last->next_ = &head_;
+        head_.prev_ = last;
+        size_ += std::exchange(other.size_, 0);
+        other.head_.next_ = other.head_.prev_ = &other.head_;
+    }
+
+    // unlink every element; the elements themselves are left alone.
+    void clear() noexcept {
+        hook *h = head_.next_;
+        while (h != &head_) {
+            hook *next = h->next_;
+            h->prev_ = h->next_ = nullptr;
+            h = next;
+        }
+        head_.next_ = head_.prev_ = &head_;
+        size_ = 0;
+    }
+
+    iterator begin() noexcept { return iterator(head_.next_); }
+    iterator end() noexcept { return iterator(&head_); }
+    const_iterator begin() const noexcept {
+        return const_iterator(head_.next_);
+    }
+    const_iterator end() const noexcept { return const_iterator(&head_); }
+};
+
+} // namespace alloy
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef _ALLOY_LAYOUT_BUILDER_HPP
+#define _ALLOY_LAYOUT_BUILDER_HPP
+#pragma once
+
+#include "memlayout.hpp"
+#include "struct_layout.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace alloy {
+
+//
+// Record layouts for schemas known only at run time.
+//
+// `LayoutBuilder` collects (size, align) fields, e.g. the columns of a SQL
+// schema, and `build()` lays them out with the same rules as
+// `layout_of_fields`, in one pass over the fields and without any template
+// instantiation per schema. The result is a `RecordLayout`: the record
+// layout and one flat `FieldInfo` per field, indexed by field number.
+//
+//     LayoutBuilder b;
+//     for (auto &column : schema) {
+//         b.add(column.size, column.align);
+//     }
+//     RecordLayout row = b.build().value();
+//     auto *price = static_cast<double *>(row.field(record, 3));
+//
+// `Order::min_padding` stores fields by decreasing alignment instead of in
+// declaration order, like `reordered_layout`; fields keep their numbers.
+//
+
+class RecordLayout {
+    std::vector<FieldInfo> fields_; // by field number.
+    Layout layout_;                 // padded to its alignment.
+    size_t tail_padding_;
+
+    friend class LayoutBuilder;
+
+    RecordLayout(std::vector<FieldInfo> fields, Layout layout,
+                 size_t tail_padding) noexcept
+        : fields_(std::move(fields))
+        , layout_(layout)
+        , tail_padding_(tail_padding) {}
+
+  public:
+    Layout layout() const noexcept { return layout_; }
+    size_t size() const noexcept { return fields_.size(); }
+    bool empty() const noexcept { return fields_.empty(); }
+
+    const FieldInfo &operator[](size_t i) const noexcept { return fields_[i]; }
+    std::span<const FieldInfo> fields() const noexcept { return fields_; }
+
+    size_t offset(size_t i) const noexcept { return fields_[i].offset; }
+
+    // address of field `i` in `record`.
+    void *field(void *record, size_t i) const noexcept {
+        return static_cast<char *>(record) + fields_[i].offset;
+    }
+    const void *field(const void *record, size_t i) const noexcept {
+        return static_cast<const char *>(record) + fields_[i].offset;
+    }
+
+    size_t tail_padding() const noexcept { return tail_padding_; }
+
+    size_t padding() const noexcept {
+        size_t n = tail_padding_;
+        for (auto &f : fields_) {
+            n += f.padding;
+        }
+        return n;
+    }
+
+    bool shares_cache_line(size_t i, size_t j,
+                           size_t line = cache_line_size) const noexcept {
+        return i != j && fields_share_line(fields_[i], fields_[j], line);
+    }
+
+    friend inline std::string to_string(const RecordLayout &self) noexcept {
+        std::string s = "<RecordLayout| size: " +
+                        std::to_string(self.layout_.size()) +
+                        ", align: " + std::to_string(self.layout_.align()) +
+                        ", padding: " + std::to_string(self.padding());
+        for (size_t i = 0; i < self.size(); ++i) {
+            auto &f = self.fields_[i];
+            s += "\n  field " + std::to_string(i) +
+                 ": offset: " + std::to_string(f.offset) +
+                 ", size: " + std::to_string(f.size) +
+                 ", align: " + std::to_string(f.align);
+            if (f.padding) {
+                s += ", padding before: " + std::to_string(f.padding);
+            }
+        }
+        if (self.tail_padding_) {
+            s += "\n  [padding " + std::to_string(self.tail_padding_) + "]";
+        }
+        return s + ">";
+    }
+};
+
+class LayoutBuilder {
+  public:
+    enum class Order { declared, min_padding };
+
+  private:
+    std::vector<Layout> fields_;
+    bool valid_ = true; // false once an invalid field was added.
+
+  public:
+    LayoutBuilder() noexcept = default;
+
+    explicit LayoutBuilder(size_t fields) { fields_.reserve(fields); }
+
+    LayoutBuilder &add(Layout field) {
+        valid_ = valid_ && field.align() != 0;
+        fields_.push_back(field);
+        return *this;
+    }
+
+    // a field of `size` bytes aligned to `align`. An invalid pair makes
+    // `build()` fail.
+    LayoutBuilder &add(size_t size, size_t align) {
+        if (auto field = Layout::from_size_align(size, align)) {
+            return add(field.value());
+        }
+        valid_ = false;
+        fields_.push_back(Layout());
+        return *this;
+    }
+
+    template <typename T> LayoutBuilder &add() {
+        return add(Layout::create<T>().value());
+    }
+
+    size_t size() const noexcept { return fields_.size(); }
+
+    void clear() noexcept {
+        fields_.clear();
+        valid_ = true;
+    }
+
+    // lay the fields out. Nothing if a field was invalid or the record
+    // size overflows.
+    std::optional<RecordLayout> build(Order order = Order::declared) const {
+        if (!valid_) {
+            return {};
+        }
+        const size_t n = fields_.size();
+        std::vector<size_t> storage; // field numbers in storage order.
+        std::span<const Layout> placed = fields_;
+        std::vector<Layout> sorted;
+        if (order == Order::min_padding) {
+            storage.resize(n);
+            std::iota(storage.begin(), storage.end(), size_t(0));
+            auto before = [&](size_t a, size_t b) {
+                const Layout &x = fields_[a], &y = fields_[b];
+                if (x.align() != y.align()) {
+                    return x.align() > y.align();
+                }
+                return x.size() > y.size();
+            };
+            std::stable_sort(storage.begin(), storage.end(), before);
+            sorted.reserve(n);
+            for (size_t i : storage) {
+                sorted.push_back(fields_[i]);
+            }
+            placed = sorted;
+        }
+
+        std::vector<size_t> offsets(n);
+        auto record =
+            Layout::from_size_align(0, 1)->extend_all(placed, offsets);
+        if (!record) {
+            return {};
+        }
+        Layout padded = record->pad_to_align();
+
+        std::vector<FieldInfo> fields(n);
+        size_t end = 0;
+        for (size_t k = 0; k < n; ++k) {
+            size_t i = storage.empty() ? k : storage[k];
+            fields[i] = { offsets[k], placed[k].size(), placed[k].align(),
+                          offsets[k] - end };
+            end = offsets[k] + placed[k].size();
+        }
+        return RecordLayout(std::move(fields), padded,
+                            padded.size() - record->size());
+    }
+};
+
+} // namespace alloy
+
+#endif
@@ -0,0 +1,747 @@
+#ifndef _ALLOY_LAYOUT_REPORT_HPP
+#define _ALLOY_LAYOUT_REPORT_HPP
+#pragma once
+
+#include "layout_builder.hpp"
+#include "memlayout.hpp"
+#include "struct_layout.hpp"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace alloy {
+
+//
+// Structured layout dumps.
+//
+// A `LayoutReport` is a named record layout with named fields, built from a
+// `StructLayout`, a `RecordLayout` or an aggregate type. It prints as JSON
+// (`to_json`, read back with `layout_report_from_json`) or as an ASCII map
+// of the cache lines the record covers, one character per byte:
+//
+//     Order: size 32, align 8, padding 9, 1 line (64 bytes), up to 2 unaligned
+//     line 0 |aaaaaaaab...ccccddddddddee......|
+//       a id     offset 0    size 8
+//       b side   offset 8    size 1
+//       ...
+//
+// `diff_layouts` compares two reports of the same record, field by name,
+// and flags the changes that cost cache lines: more lines per record, more
+// lines in the worst placement an array gives, fields that now straddle a
+// line. `tools/layout_diff.cpp` runs it on two JSON dumps, for review.
+//
+// `ObjectReport` describes a live object through a `SomeHasLayout`: where
+// it is, how its address is aligned and which lines it spans. A collection
+// of them dumps the same two ways.
+//
+
+struct FieldReport {
+    std::string name;
+    FieldInfo info;
+
+    // index of the first and last line of the field, for a record at a
+    // `line` aligned address.
+    M_CEXPR size_t first_line(size_t line = cache_line_size) const noexcept {
+        return info.offset / line;
+    }
+    M_CEXPR size_t last_line(size_t line = cache_line_size) const noexcept {
+        return info.size ? (info.offset + info.size - 1) / line
+                         : first_line(line);
+    }
+
+    M_CEXPR bool straddles(size_t line = cache_line_size) const noexcept {
+        return first_line(line) != last_line(line);
+    }
+};
+
+struct LayoutReport {
+    std::string name;
+    Layout layout; // padded to its alignment.
+    std::vector<FieldReport> fields;
+    size_t tail_padding = 0;
+
+    size_t padding() const noexcept {
+        size_t n = tail_padding;
+        for (auto &f : fields) {
+            n += f.info.padding;
+        }
+        return n;
+    }
+
+    // cache lines of a record placed at a `line` aligned address.
+    size_t lines(size_t line = cache_line_size) const noexcept {
+        return (layout.size() + line - 1) / line;
+    }
+
+    // cache lines of a record in the worst placement its alignment allows,
+    // e.g. in an array.
+    size_t worst_lines(size_t line = cache_line_size) const noexcept {
+        if (layout.size() == 0) {
+            return 0;
+        }
+        size_t worst = 0;
+        size_t step = std::min(std::max<size_t>(layout.align(), 1), line);
+        for (size_t start = 0; start < line; start += step) {
+            worst = std::max(worst, (start + layout.size() - 1) / line + 1);
+        }
+        return worst;
+    }
+
+    const FieldReport *field(std::string_view name) const noexcept {
+        for (auto &f : fields) {
+            if (f.name == name) {
+                return &f;
+            }
+        }
+        return nullptr;
+    }
+};
+
+namespace details {
+
+inline std::vector<FieldReport>
+field_reports(std::span<const FieldInfo> fields,
+              std::span<const std::string> names) {
+    std::vector<FieldReport> out;
+    out.reserve(fields.size());
+    for (size_t i = 0; i < fields.size(); ++i) {
+        out.push_back({ i < names.size() ? names[i]
+                                         : "field " + std::to_string(i),
+                        fields[i] });
+    }
+    return out;
+}
+
+} // namespace details
+
+// report of a compile time field layout. Fields without a name are called
+// "field i".
+template <size_t N>
+LayoutReport report_of(const StructLayout<N> &layout, std::string name,
+                       std::span<const std::string> field_names = {}) {
+    return { std::move(name), layout.layout,
+             details::field_reports(layout.fields, field_names),
+             layout.tail_padding };
+}
+
+inline LayoutReport report_of(const RecordLayout &layout, std::string name,
+                              std::span<const std::string> field_names = {}) {
+    return { std::move(name), layout.layout(),
+             details::field_reports(layout.fields(), field_names),
+             layout.tail_padding() };
+}
+
+// report of the fields of aggregate `T`, see `layout_of_struct`.
+template <typename T>
+LayoutReport report_of(std::string name,
+                       std::span<const std::string> field_names = {}) {
+    return report_of(layout_of_struct<T>().value(), std::move(name),
+                     field_names);
+}
+
+//
+// Reports as text.
+//
+
+namespace details {
+
+inline void json_string(std::string &out, std::string_view s) {
+    out += '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x",
+                          static_cast<unsigned>(c));
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+inline void json_field(std::string &out, std::string_view key, size_t value) {
+    json_string(out, key);
+    out += ": " + std::to_string(value);
+}
+
+inline std::string hex(uintptr_t v) {
+    char buf[24];
+    std::snprintf(buf, sizeof(buf), "0x%llx",
+                  static_cast<unsigned long long>(v));
+    return buf;
+}
+
+// the character standing for field `i` in a cache line map.
+inline char field_symbol(size_t i) noexcept {
+    constexpr std::string_view symbols =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    return symbols[i % symbols.size()];
+}
+
+inline std::string pad_right(std::string s, size_t width) {
+    if (s.size() < width) {
+        s.append(width - s.size(), ' ');
+    }
+    return s;
+}
+
+} // namespace details
+
+inline std::string to_json(const LayoutReport &r,
+                           size_t line = cache_line_size) {
+    using namespace details;
+    std::string out = "{\n  ";
+    json_string(out, "name");
+    out += ": ";
+    json_string(out, r.name);
+    out += ",\n  ";
+    json_field(out, "size", r.layout.size());
+    out += ",\n  ";
+    json_field(out, "align", r.layout.align());
+    out += ",\n  ";
+    json_field(out, "padding", r.padding());
+    out += ",\n  ";
+    json_field(out, "tail_padding", r.tail_padding);
+    out += ",\n  ";
+    json_field(out, "cache_line", line);
+    out += ",\n  ";
+    json_field(out, "lines", r.lines(line));
+    out += ",\n  ";
+    json_field(out, "worst_lines", r.worst_lines(line));
+    out += ",\n  \"fields\": [";
+    for (size_t i = 0; i < r.fields.size(); ++i) {
+        auto &f = r.fields[i];
+        out += i ? ",\n    {" : "\n    {";
+        json_string(out, "name");
+        out += ": ";
+        json_string(out, f.name);
+        out += ", ";
+        json_field(out, "offset", f.info.offset);
+        out += ", ";
+        json_field(out, "size", f.info.size);
+        out += ", ";
+        json_field(out, "align", f.info.align);
+        out += ", ";
+        json_field(out, "padding", f.info.padding);
+        out += ", ";
+        json_field(out, "first_line", f.first_line(line));
+        out += ", ";
+        json_field(out, "last_line", f.last_line(line));
+        out += "}";
+    }
+    out += r.fields.empty() ? "]\n}" : "\n  ]\n}";
+    return out;
+}
+
+// one row of `line` characters per cache line, a letter per field byte and
+// '.' per padding byte, then the legend.
+inline std::string cache_line_map(const LayoutReport &r,
+                                  size_t line = cache_line_size) {
+    using namespace details;
+    const size_t size = r.layout.size();
+    std::string bytes(size, '.');
+    for (size_t i = 0; i < r.fields.size(); ++i) {
+        auto &f = r.fields[i].info;
+        for (size_t b = f.offset; b < f.offset + f.size && b < size; ++b) {
+            bytes[b] = field_symbol(i);
+        }
+    }
+
+    size_t lines = r.lines(line);
+    std::string out = r.name + ": size " + std::to_string(size) +
+                      ", align " + std::to_string(r.layout.align()) +
+                      ", padding " + std::to_string(r.padding()) + ", " +
+                      std::to_string(lines) +
+                      (lines == 1 ? " line (" : " lines (") +
+                      std::to_string(line) + " bytes)";
+    if (r.worst_lines(line) > lines) {
+        out += ", up to " + std::to_string(r.worst_lines(line)) +
+               " unaligned";
+    }
+    const size_t label = std::string("line ").size() +
+                         std::to_string(lines ? lines - 1 : 0).size();
+    for (size_t l = 0; l < lines; ++l) {
+        out += "\n" + pad_right("line " + std::to_string(l), label) + " |" +
+               bytes.substr(l * line, line) + "|";
+    }
+
+    size_t width = 0;
+    for (auto &f : r.fields) {
+        width = std::max(width, f.name.size());
+    }
+    for (size_t i = 0; i < r.fields.size(); ++i) {
+        auto &f = r.fields[i];
+        out += "\n  ";
+        out += field_symbol(i);
+        out += " " + pad_right(f.name, width) + "  offset " +
+               pad_right(std::to_string(f.info.offset), 4) + " size " +
+               std::to_string(f.info.size);
+        if (f.straddles(line)) {
+            out += "  straddles lines " + std::to_string(f.first_line(line)) +
+                   "-" + std::to_string(f.last_line(line));
+        }
+    }
+    return out;
+}
+
+//
+// Live objects.
+//
+
+struct ObjectReport {
+    uintptr_t address;
+    Layout layout;
+    size_t address_align; // largest power of two dividing the address.
+
+    static ObjectReport of(SomeHasLayout object) noexcept {
+        auto address = reinterpret_cast<uintptr_t>(object.ptr());
+        return { address, object.layout(),
+                 address ? size_t(1) << std::countr_zero(address)
+                         : size_t(0) };
+    }
+
+    // whether the address satisfies the layout's alignment.
+    bool aligned() const noexcept {
+        return address % std::max<size_t>(layout.align(), 1) == 0;
+    }
+
+    uintptr_t first_line(size_t line = cache_line_size) const noexcept {
+        return address / line * line;
+    }
+
+    size_t lines(size_t line = cache_line_size) const noexcept {
+        if (layout.size() == 0) {
+            return 0;
+        }
+        return (address % line + layout.size() - 1) / line + 1;
+    }
+};
+
+inline std::string to_json(std::span<SomeHasLayout> objects,
+                           size_t line = cache_line_size) {
+    using namespace details;
+    std::string out = "[";
+    for (size_t i = 0; i < objects.size(); ++i) {
+        auto o = ObjectReport::of(objects[i]);
+        out += i ? ",\n  {" : "\n  {";
+        json_string(out, "address");
+        out += ": ";
+        json_string(out, hex(o.address));
+        out += ", ";
+        json_field(out, "size", o.layout.size());
+        out += ", ";
+        json_field(out, "align", o.layout.align());
+        out += ", ";
+        json_field(out, "address_align", o.address_align);
+        out += ", \"aligned\": ";
+        out += o.aligned() ? "true" : "false";
+        out += ", ";
+        json_string(out, "first_line");
+        out += ": ";
+        json_string(out, hex(o.first_line(line)));
+        out += ", ";
+        json_field(out, "lines", o.lines(line));
+        out += "}";
+    }
+    out += objects.empty() ? "]" : "\n]";
+    return out;
+}
+
+// per object, its placement and a row per line it spans, '#' for its bytes.
+inline std::string cache_line_map(std::span<SomeHasLayout> objects,
+                                  size_t line = cache_line_size) {
+    using namespace details;
+    std::string out;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        auto o = ObjectReport::of(objects[i]);
+        if (i) {
+            out += "\n";
+        }
+        out += "object " + std::to_string(i) + " at " + hex(o.address) +
+               ": size " + std::to_string(o.layout.size()) + ", align " +
+               std::to_string(o.layout.align()) + ", address aligned to " +
+               std::to_string(o.address_align) +
+               (o.aligned() ? "" : " (MISALIGNED)") + ", " +
+               std::to_string(o.lines(line)) +
+               (o.lines(line) == 1 ? " line" : " lines");
+        size_t begin = o.address % line;
+        size_t end = begin + o.layout.size();
+        for (size_t l = 0; l < o.lines(line); ++l) {
+            std::string row(line, '.');
+            for (size_t b = 0; b < line; ++b) {
+                size_t at = l * line + b;
+                if (at >= begin && at < end) {
+                    row[b] = '#';
+                }
+            }
+            out += "\n  " + hex(o.first_line(line) + l * line) + " |" + row +
+                   "|";
+        }
+    }
+    return out;
+}
+
+//
+// Reading a report back.
+//
+
+namespace details {
+
+// the subset of JSON `to_json` writes: objects, arrays, strings, unsigned
+// integers and literals. Unknown keys are skipped.
+class JsonReader {
+    std::string_view s_;
+    size_t i_ = 0;
+
+  public:
+    explicit JsonReader(std::string_view s) noexcept
+        : s_(s) {}
+
+    void skip_ws() noexcept {
+        while (i_ < s_.size() &&
+               std::isspace(static_cast<unsigned char>(s_[i_]))) {
+            ++i_;
+        }
+    }
+
+    bool eat(char c) noexcept {
+        skip_ws();
+        if (i_ < s_.size() && s_[i_] == c) {
+            ++i_;
+            return true;
+        }
+        return false;
+    }
+
+    bool peek(char c) noexcept {
+        skip_ws();
+        return i_ < s_.size() && s_[i_] == c;
+    }
+
+    bool at_end() noexcept {
+        skip_ws();
+        return i_ == s_.size();
+    }
+
+    std::optional<std::string> string() {
+        if (!eat('"')) {
+            return {};
+        }
+        std::string out;
+        while (i_ < s_.size() && s_[i_] != '"') {
+            char c = s_[i_++];
+            if (c == '\\') {
+                if (i_ >= s_.size()) {
+                    return {};
+                }
+                c = s_[i_++];
+                if (c == 'u') {
+                    unsigned code = 0;
+                    for (int k = 0; k < 4; ++k, ++i_) {
+                        auto h = i_ < s_.size()
+                                     ? static_cast<unsigned char>(s_[i_])
+                                     : 0;
+                        if (!std::isxdigit(h)) {
+                            return {};
+                        }
+                        h = static_cast<unsigned char>(std::tolower(h));
+                        code = code * 16 +
+                               (h <= '9' ? h - '0' : h - 'a' + 10);
+                    }
+                    c = static_cast<char>(code);
+                } else if (c == 'n') {
+                    c = '\n';
+                } else if (c == 't') {
+                    c = '\t';
+                }
+            }
+            out += c;
+        }
+        if (i_ >= s_.size()) {
+            return {};
+        }
+        ++i_;
+        return out;
+    }
+
+    std::optional<size_t> number() noexcept {
+        skip_ws();
+        size_t start = i_;
+        size_t v = 0;
+        while (i_ < s_.size() && s_[i_] >= '0' && s_[i_] <= '9') {
+            auto next = checked_mul(v, size_t(10));
+            if (next) {
+                next = checked_add(next.value(), size_t(s_[i_++] - '0'));
+            }
+            if (!next) {
+                return {};
+            }
+            v = next.value();
+        }
+        if (i_ == start) {
+            return {};
+        }
+        return v;
+    }
+
+    // skip any value.
+    bool skip() {
+        skip_ws();
+        if (peek('"')) {
+            return string().has_value();
+        }
+        if (eat('{')) {
+            if (eat('}')) {
+                return true;
+            }
+            do {
+                if (!string() || !eat(':') || !skip()) {
+                    return false;
+                }
+            } while (eat(','));
+            return eat('}');
+        }
+        if (eat('[')) {
+            if (eat(']')) {
+                return true;
+            }
+            do {
+                if (!skip()) {
+                    return false;
+                }
+            } while (eat(','));
+            return eat(']');
+        }
+        for (std::string_view word : { "true", "false", "null" }) {
+            if (s_.substr(i_, word.size()) == word) {
+                i_ += word.size();
+                return true;
+            }
+        }
+        return number().has_value();
+    }
+
+    // call `member(key)` for each member of an object; it consumes the
+    // value and returns false on error.
+    template <typename F> bool object(F &&member) {
+        if (!eat('{')) {
+            return false;
+        }
+        if (eat('}')) {
+            return true;
+        }
+        do {
+            auto key = string();
+            if (!key || !eat(':') || !member(key.value())) {
+                return false;
+            }
+        } while (eat(','));
+        return eat('}');
+    }
+};
+
+} // namespace details
+
+// parse the output of `to_json(const LayoutReport &)`. Nothing if the text
+// is not such a report or describes an invalid layout.
+inline std::optional<LayoutReport> layout_report_from_json(std::string_view s) {
+    details::JsonReader in(s);
+    LayoutReport r;
+    size_t size = 0, align = 0;
+    bool has_size = false, has_align = false;
+    auto number = [&](size_t &out) {
+        auto v = in.number();
+        if (v) {
+            out = v.value();
+        }
+        return v.has_value();
+    };
+    auto field = [&](FieldReport &f, const std::string &key) {
+        if (key == "name") {
+            auto v = in.string();
+            f.name = v.value_or("");
+            return v.has_value();
+        }
+        if (key == "offset") {
+            return number(f.info.offset);
+        }
+        if (key == "size") {
+            return number(f.info.size);
+        }
+        if (key == "align") {
+            return number(f.info.align);
+        }
+        if (key == "padding") {
+            return number(f.info.padding);
+        }
+        return in.skip();
+    };
+    bool ok = in.object([&](const std::string &key) {
+        if (key == "name") {
+            auto v = in.string();
+            r.name = v.value_or("");
+            return v.has_value();
+        }
+        if (key == "size") {
+            has_size = true;
+            return number(size);
+        }
+        if (key == "align") {
+            has_align = true;
+            return number(align);
+        }
+        if (key == "tail_padding") {
+            return number(r.tail_padding);
+        }
+        if (key == "fields") {
+            if (!in.eat('[')) {
+                return false;
+            }
+            if (in.eat(']')) {
+                return true;
+            }
+            do {
+                FieldReport f{ "", { 0, 0, 1, 0 } };
+                if (!in.object([&](const std::string &k) {
+                        return field(f, k);
+                    })) {
+                    return false;
+                }
+                r.fields.push_back(std::move(f));
+            } while (in.eat(','));
+            return in.eat(']');
+        }
+        return in.skip();
+    });
+    if (!ok || !in.at_end() || !has_size || !has_align) {
+        return {};
+    }
+    auto layout = Layout::from_size_align(size, align);
+    if (!layout) {
+        return {};
+    }
+    r.layout = layout.value();
+    return r;
+}
+
+//
+// Comparing two layouts of a record.
+//
+
+struct LayoutDiff {
+    struct Change {
+        std::string text;
+        bool regression; // costs cache lines.
+    };
+    std::vector<Change> changes;
+
+    bool empty() const noexcept { return changes.empty(); }
+
+    bool regressed() const noexcept {
+        return std::any_of(changes.begin(), changes.end(),
+                           [](const Change &c) { return c.regression; });
+    }
+};
+
+inline LayoutDiff diff_layouts(const LayoutReport &before,
+                               const LayoutReport &after,
+                               size_t line = cache_line_size) {
+    LayoutDiff d;
+    auto change = [&](std::string s, bool regression) {
+        d.changes.push_back({ std::move(s), regression });
+    };
+    auto from_to = [](size_t a, size_t b) {
+        return std::to_string(a) + " -> " + std::to_string(b);
+    };
+
+    if (before.layout.size() != after.layout.size()) {
+        change("size " + from_to(before.layout.size(), after.layout.size()),
+               false);
+    }
+    if (before.layout.align() != after.layout.align()) {
+        change("align " +
+                   from_to(before.layout.align(), after.layout.align()),
+               false);
+    }
+    if (before.padding() != after.padding()) {
+        change("padding " + from_to(before.padding(), after.padding()),
+               false);
+    }
+    if (before.lines(line) != after.lines(line)) {
+        change("cache lines " + from_to(before.lines(line), after.lines(line)),
+               after.lines(line) > before.lines(line));
+    }
+    if (before.worst_lines(line) != after.worst_lines(line)) {
+        change("cache lines unaligned " + from_to(before.worst_lines(line),
+                                                  after.worst_lines(line)),
+               after.worst_lines(line) > before.worst_lines(line));
+    }
+
+    for (auto &f : before.fields) {
+        const FieldReport *g = after.field(f.name);
+        if (g == nullptr) {
+            change("field " + f.name + " removed", false);
+            continue;
+        }
+        if (f.info.size != g->info.size) {
+            change("field " + f.name + " size " +
+                       from_to(f.info.size, g->info.size),
+                   false);
+        }
+        if (f.info.offset != g->info.offset) {
+            std::string s = "field " + f.name + " offset " +
+                            from_to(f.info.offset, g->info.offset);
+            if (f.first_line(line) != g->first_line(line)) {
+                s += ", line " +
+                     from_to(f.first_line(line), g->first_line(line));
+            }
+            change(std::move(s), false);
+        }
+        if (!f.straddles(line) && g->straddles(line)) {
+            change("field " + f.name + " now straddles lines " +
+                       std::to_string(g->first_line(line)) + "-" +
+                       std::to_string(g->last_line(line)),
+                   true);
+        }
+    }
+    for (auto &g : after.fields) {
+        if (before.field(g.name) == nullptr) {
+            change("field " + g.name + " added at offset " +
+                       std::to_string(g.info.offset) +
+                       (g.straddles(line) ? ", straddling two lines" : ""),
+                   g.straddles(line));
+        }
+    }
+    return d;
+}
+
+inline std::string to_string(const LayoutDiff &d) {
+    if (d.empty()) {
+        return "no layout changes";
+    }
+    std::string out;
+    for (auto &c : d.changes) {
+        if (!out.empty()) {
+            out += "\n";
+        }
+        out += (c.regression ? "! " : "  ") + c.text;
+    }
+    return out;
+}
+
+} // namespace alloy
+
+#endif
@@ -2,11 +2,416 @@
 #define _ALLOY_LINKED_LIST_ALLOCATOR_HPP
 #pragma once
 
+#include "allocator_stats.hpp"
 #include "memlayout.hpp"
+#include "page_provider.hpp"
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <utility>
 
+namespace alloy {
+
+// how a free block is chosen for a request.
+//   first_fit: the first block large enough, searching from the list head.
+//   next_fit:  like first_fit, but the search resumes where the last one
+//              stopped.
+//   best_fit:  the smallest block large enough.
+enum class FitPolicy { first_fit, next_fit, best_fit };
+
+//
+// Free list heap over a caller provided region.
+//
+// The region is split into blocks, each preceded by a header recording its
+// size and the size of the block physically before it (boundary tags). Free
+// blocks are kept on a doubly linked list threaded through their payload.
+// Allocation splits the chosen block, deallocation coalesces a block with
+// its free neighbours, so the heap never holds two adjacent free blocks.
+//
+// A region passed in by the caller is not owned: it can be a static buffer,
+// an mmap'd file or a huge page mapping. Alternatively the heap takes a
+// single region from a provider and gives it back on destruction. The heap
+// never grows past its region.
+//
+
+template <FitPolicy Policy = FitPolicy::first_fit,
+          MemoryProvider Provider = HeapProvider, StatsPolicy Stats = NoStats>
 class LinkedListAllocator {
-    using allocator_type = LinkedListAllocator;
+    // `size` is the size of the whole block, header included. Sizes are
+    // multiples of `granule`, the low bit marks the block as used.
+    struct Header {
+        size_t size;
+        size_t prev_size;
+    };
+
+    struct FreeNode {
+        FreeNode *next;
+        FreeNode *prev;
+    };
+
+    static constexpr size_t used_bit = 1;
+
+  public:
+    using allocator_type = LinkedListAllocator<Policy, Provider, Stats>;
+    using provider_type = Provider;
+    using stats_type = Stats;
+
+    static constexpr FitPolicy policy = Policy;
+    static constexpr size_t granule = alignof(std::max_align_t);
+    static constexpr size_t header_size = align_up(sizeof(Header), granule);
+    static constexpr size_t min_block =
+        header_size + align_up(sizeof(FreeNode), granule);
+
+  private:
+    char *base_;
+    char *end_; // the sentinel header, a used block of size 0.
+    FreeNode *free_;
+    FreeNode *rover_; // where next_fit resumes.
+    void *region_;    // region taken from the provider, if any.
+    Layout region_layout_;
+    [[no_unique_address]] Provider provider_;
+    [[no_unique_address]] Stats stats_;
+
+  public:
+    LinkedListAllocator() noexcept
+        : base_(nullptr)
+        , end_(nullptr)
+        , free_(nullptr)
+        , rover_(nullptr)
+        , region_(nullptr) {}
+
+    // manage `size` bytes at `region`. The region is trimmed to `granule`
+    // boundaries.
+    LinkedListAllocator(void *region, size_t size) noexcept
+        : LinkedListAllocator() {
+        init(region, size);
+    }
+
+    // manage a region of `size` bytes taken from `provider`.
+    explicit LinkedListAllocator(size_t size,
+                                 Provider provider = Provider()) noexcept
+        : LinkedListAllocator() {
+        provider_ = std::move(provider);
+        if (auto layout = Layout::from_size_align(size, granule)) {
+            if (void *region = provider_.allocate_chunk(layout.value())) {
+                region_ = region;
+                region_layout_ = layout.value();
+                init(region, size);
+            }
+        }
+    }
+
+    LinkedListAllocator(const LinkedListAllocator &) = delete;
+    LinkedListAllocator &operator=(const LinkedListAllocator &) = delete;
+
+    LinkedListAllocator(LinkedListAllocator &&other) noexcept
+        : base_(std::exchange(other.base_, nullptr))
+        , end_(std::exchange(other.end_, nullptr))
+        , free_(std::exchange(other.free_, nullptr))
+        , rover_(std::exchange(other.rover_, nullptr))
+        , region_(std::exchange(other.region_, nullptr))
+        , region_layout_(other.region_layout_)
+        , provider_(std::move(other.provider_))
+        , stats_(std::exchange(other.stats_, Stats())) {}
+
+    LinkedListAllocator &operator=(LinkedListAllocator &&other) noexcept {
+        if (this != &other) {
+            release_region();
+            base_ = std::exchange(other.base_, nullptr);
+            end_ = std::exchange(other.end_, nullptr);
+            free_ = std::exchange(other.free_, nullptr);
+            rover_ = std::exchange(other.rover_, nullptr);
+            region_ = std::exchange(other.region_, nullptr);
+            region_layout_ = other.region_layout_;
+            provider_ = std::move(other.provider_);
+            stats_ = std::exchange(other.stats_, Stats());
+        }
+        return *this;
+    }
+
+    ~LinkedListAllocator() { release_region(); }
+
+    Provider &provider() noexcept { return provider_; }
+
+    AllocatorStats statistics() const noexcept { return stats_.snapshot(); }
+
+    void *allocate(Layout layout) noexcept {
+        if (layout.align() == 0 || free_ == nullptr ||
+            layout.size() > static_cast<size_t>(end_ - base_)) {
+            stats_.on_failure(layout);
+            return nullptr;
+        }
+        size_t align = std::max(layout.align(), granule);
+        size_t need = std::max(
+            min_block,
+            header_size + layout.size() + layout.required_padding(granule));
+
+        auto [block, gap] = find(need, align);
+        if (block == nullptr) {
+            stats_.on_failure(layout);
+            return nullptr;
+        }
+        unlink(block);
+
+        // the part before an aligned payload becomes a block of its own.
+        if (gap) {
+            Header *lead = block;
+            block = at(block, gap);
+            block->size = lead->size - gap;
+            block->prev_size = gap;
+            lead->size = gap;
+            next_of(block)->prev_size = block->size;
+            link(lead);
+        }
+
+        if (block->size - need >= min_block) {
+            Header *rest = at(block, need);
+            rest->size = block->size - need;
+            rest->prev_size = need;
+            next_of(rest)->prev_size = rest->size;
+            block->size = need;
+            link(rest);
+        }
+
+        stats_.on_allocate(layout, block->size);
+        block->size |= used_bit;
+        return payload_of(block);
+    }
+
+    void deallocate(void *ptr, Layout = Layout()) noexcept {
+        if (ptr == nullptr) {
+            return;
+        }
+        Header *block = header_of(ptr);
+        block->size &= ~used_bit;
+        stats_.on_deallocate(block->size);
+
+        Header *next = next_of(block);
+        if (is_free(next)) {
+            unlink(next);
+            block->size += next->size;
+        }
+        if (block->prev_size) {
+            Header *prev = at(block, -static_cast<ptrdiff_t>(block->prev_size));
+            if (is_free(prev)) {
+                unlink(prev);
+                prev->size += block->size;
+                block = prev;
+            }
+        }
+        next_of(block)->prev_size = block->size;
+        link(block);
+    }
+
+    inline bool owns(const void *ptr) const noexcept {
+        auto p = static_cast<const char *>(ptr);
+        return p >= base_ && p < end_;
+    }
+
+    // drop every block, the whole region becomes one free block.
+    inline void reset() noexcept {
+        stats_.on_reset();
+        free_ = rover_ = nullptr;
+        if (base_ == nullptr) {
+            return;
+        }
+        auto sentinel = reinterpret_cast<Header *>(end_);
+        sentinel->size = used_bit;
+        sentinel->prev_size = end_ - base_;
+        auto block = reinterpret_cast<Header *>(base_);
+        block->size = end_ - base_;
+        block->prev_size = 0;
+        link(block);
+    }
+
+    // take over `size` bytes at `region` that were formatted by a heap over
+    // the same bytes, possibly mapped at another address: blocks in use stay
+    // in use. Block headers only hold sizes, the free list is rebuilt from
+    // them. Returns false, leaving the heap empty, if the block chain does
+    // not add up to the region; needs the region at the same offset from a
+    // `granule` boundary as before.
+    bool attach(void *region, size_t size) noexcept {
+        release_region();
+        base_ = end_ = nullptr;
+        free_ = rover_ = nullptr;
+        auto first = align_up(reinterpret_cast<uintptr_t>(region), granule);
+        auto last = (reinterpret_cast<uintptr_t>(region) + size) &
+                    ~(uintptr_t)(granule - 1);
+        if (region == nullptr || last < first + min_block + header_size) {
+            return false;
+        }
+        auto base = reinterpret_cast<char *>(first);
+        auto end = reinterpret_cast<char *>(last - header_size);
+
+        size_t prev = 0;
+        for (auto h = reinterpret_cast<Header *>(base);
+             reinterpret_cast<char *>(h) != end; h = next_of(h)) {
+            size_t n = h->size & ~used_bit;
+            if (n < min_block || n % granule || h->prev_size != prev ||
+                n > static_cast<size_t>(end - reinterpret_cast<char *>(h))) {
+                free_ = nullptr;
+                return false;
+            }
+            if (is_free(h)) {
+                link(h);
+            }
+            prev = n;
+        }
+        auto sentinel = reinterpret_cast<Header *>(end);
+        if (sentinel->size != used_bit || sentinel->prev_size != prev) {
+            free_ = nullptr;
+            return false;
+        }
+        base_ = base;
+        end_ = end;
+        return true;
+    }
+
+    // bytes managed, headers included.
+    inline size_t capacity() const noexcept { return end_ - base_; }
+
+    // bytes in free blocks, headers included.
+    inline size_t available() const noexcept {
+        size_t n = 0;
+        for (FreeNode *f = free_; f; f = f->next) {
+            n += header_from(f)->size;
+        }
+        return n;
+    }
+
+    inline size_t largest_free_block() const noexcept {
+        size_t n = 0;
+        for (FreeNode *f = free_; f; f = f->next) {
+            n = std::max(n, header_from(f)->size);
+        }
+        return n;
+    }
+
+    inline size_t free_blocks() const noexcept {
+        size_t n = 0;
+        for (FreeNode *f = free_; f; f = f->next) {
+            ++n;
+        }
+        return n;
+    }
+
+  private:
+    inline void init(void *region, size_t size) noexcept {
+        auto first = align_up(reinterpret_cast<uintptr_t>(region), granule);
+        auto last = (reinterpret_cast<uintptr_t>(region) + size) &
+                    ~(uintptr_t)(granule - 1);
+        if (region == nullptr || last < first + min_block + header_size) {
+            return;
+        }
+        base_ = reinterpret_cast<char *>(first);
+        end_ = reinterpret_cast<char *>(last - header_size);
+        reset();
+    }
+
+    inline void release_region() noexcept {
+        if (region_) {
+            provider_.deallocate_chunk(region_, region_layout_);
+            region_ = nullptr;
+        }
+    }
+
+    static inline Header *at(Header *h, ptrdiff_t offset) noexcept {
+        return reinterpret_cast<Header *>(reinterpret_cast<char *>(h) +
+                                          offset);
+    }
+    static inline Header *next_of(Header *h) noexcept {
+        return at(h, h->size & ~used_bit);
+    }
+    static inline bool is_free(Header *h) noexcept {
+        return (h->size & used_bit) == 0;
+    }
+    static inline char *payload_of(Header *h) noexcept {
+        return reinterpret_cast<char *>(h) + header_size;
+    }
+    static inline Header *header_of(void *p) noexcept {
+        return reinterpret_cast<Header *>(static_cast<char *>(p) -
+                                          header_size);
+    }
+    static inline FreeNode *node_of(Header *h) noexcept {
+        return reinterpret_cast<FreeNode *>(payload_of(h));
+    }
+    static inline Header *header_from(FreeNode *f) noexcept {
+        return header_of(f);
+    }
+
+    inline void link(Header *h) noexcept {
+        FreeNode *f = node_of(h);
+        f->prev = nullptr;
+        f->next = free_;
+        if (free_) {
+            free_->prev = f;
+        }
+        free_ = f;
+    }
+
+    inline void unlink(Header *h) noexcept {
+        FreeNode *f = node_of(h);
+        if (rover_ == f) {
+            rover_ = f->next;
+        }
+        (f->prev ? f->prev->next : free_) = f->next;
+        if (f->next) {
+            f->next->prev = f->prev;
+        }
+    }
+
+    // leading gap needed for `block` to hold `need` bytes with a payload
+    // aligned to `align`, or -1 if it can't. A gap must be large enough to
+    // stand as a free block.
+    static inline ptrdiff_t fit(Header *block, size_t need,
+                                size_t align) noexcept {
+        auto payload = reinterpret_cast<uintptr_t>(payload_of(block));
+        size_t gap = 0;
+        if (payload % align) {
+            gap = align_up(payload + min_block, align) - payload;
+        }
+        return gap + need <= block->size ? static_cast<ptrdiff_t>(gap) : -1;
+    }
+
+    std::pair<Header *, size_t> find(size_t need, size_t align) noexcept {
+        if constexpr (Policy == FitPolicy::best_fit) {
+            Header *best = nullptr;
+            ptrdiff_t best_gap = 0;
+            for (FreeNode *f = free_; f; f = f->next) {
+                Header *h = header_from(f);
+                if (ptrdiff_t gap = fit(h, need, align);
+                    gap >= 0 && (best == nullptr || h->size < best->size)) {
+                    best = h;
+                    best_gap = gap;
+                    if (h->size == need) {
+                        break;
+                    }
+                }
+            }
+            return { best, best_gap };
+        } else {
+            FreeNode *start = Policy == FitPolicy::next_fit && rover_
+                                  ? rover_
+                                  : free_;
+            for (FreeNode *f = start; f; f = f->next) {
+                if (ptrdiff_t gap = fit(header_from(f), need, align);
+                    gap >= 0) {
+                    rover_ = f->next;
+                    return { header_from(f), gap };
+                }
+            }
+            for (FreeNode *f = free_; f != start; f = f->next) {
+                if (ptrdiff_t gap = fit(header_from(f), need, align);
+                    gap >= 0) {
+                    rover_ = f->next;
+                    return { header_from(f), gap };
+                }
+            }
+            return { nullptr, 0 };
+        }
+    }
 };
 
+} // namespace alloy
+
 #endif
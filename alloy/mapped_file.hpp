@@ -0,0 +1,179 @@
+#ifndef _ALLOY_MAPPED_FILE_HPP
+#define _ALLOY_MAPPED_FILE_HPP
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace alloy {
+
+//
+// A file mapped into memory with MAP_SHARED, so writes through the mapping
+// land in the file. Failures are reported with std::optional / false
+// instead of exceptions, like the rest of alloy.
+//
+// `resize` changes the file size and maps it again: the mapping may move,
+// pointers into it must be taken again afterwards, whether or not it
+// succeeded.
+//
+
+class MappedFile {
+  public:
+    enum class Mode { read_only, read_write };
+
+  private:
+    int fd_;
+    std::byte *data_;
+    size_t size_;
+    Mode mode_;
+
+    MappedFile(int fd, Mode mode) noexcept
+        : fd_(fd)
+        , data_(nullptr)
+        , size_(0)
+        , mode_(mode) {}
+
+  public:
+    MappedFile() noexcept
+        : MappedFile(-1, Mode::read_only) {}
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept
+        : fd_(std::exchange(other.fd_, -1))
+        , data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0))
+        , mode_(other.mode_) {}
+
+    MappedFile &operator=(MappedFile &&other) noexcept {
+        if (this != &other) {
+            close();
+            fd_ = std::exchange(other.fd_, -1);
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            mode_ = other.mode_;
+        }
+        return *this;
+    }
+
+    ~MappedFile() { close(); }
+
+    // map the whole of an existing file.
+    static std::optional<MappedFile>
+    open(const std::filesystem::path &path,
+         Mode mode = Mode::read_only) noexcept {
+        int fd = ::open(path.c_str(),
+                        mode == Mode::read_only ? O_RDONLY : O_RDWR);
+        if (fd < 0) {
+            return {};
+        }
+        MappedFile file(fd, mode);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !file.map(st.st_size)) {
+            return {};
+        }
+        return file;
+    }
+
+    // create `path`, or truncate it, and map `size` bytes of it.
+    static std::optional<MappedFile> create(const std::filesystem::path &path,
+                                            size_t size) noexcept {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return {};
+        }
+        MappedFile file(fd, Mode::read_write);
+        if (!file.resize(size)) {
+            return {};
+        }
+        return file;
+    }
+
+    std::byte *data() noexcept { return data_; }
+    const std::byte *data() const noexcept { return data_; }
+    size_t size() const noexcept { return size_; }
+    Mode mode() const noexcept { return mode_; }
+    bool is_open() const noexcept { return fd_ >= 0; }
+
+    // grow or shrink the file to `size` bytes. Only for writable files.
+    // The old mapping is kept until the new one is in place, so on failure
+    // `data()` and `size()` still describe a valid mapping.
+    bool resize(size_t size) noexcept {
+        if (fd_ < 0 || mode_ != Mode::read_write) {
+            return false;
+        }
+        size_t old_size = size_;
+        if (size > old_size && !truncate(size)) {
+            return false;
+        }
+        std::byte *data = nullptr;
+        if (size != 0 && (data = map_view(size)) == nullptr) {
+            if (size > old_size) {
+                truncate(old_size);
+            }
+            return false;
+        }
+        unmap();
+        data_ = data;
+        size_ = size;
+        return size >= old_size || truncate(size);
+    }
+
+    // flush written pages to the file.
+    bool sync() noexcept {
+        return data_ == nullptr || msync(data_, size_, MS_SYNC) == 0;
+    }
+
+    void close() noexcept {
+        unmap();
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+  private:
+    bool map(size_t size) noexcept {
+        if (size == 0) {
+            return true;
+        }
+        std::byte *data = map_view(size);
+        if (data == nullptr) {
+            return false;
+        }
+        data_ = data;
+        size_ = size;
+        return true;
+    }
+
+    std::byte *map_view(size_t size) noexcept {
+        int prot = mode_ == Mode::read_only ? PROT_READ
+                                            : PROT_READ | PROT_WRITE;
+        void *p = mmap(nullptr, size, prot, MAP_SHARED, fd_, 0);
+        return p == MAP_FAILED ? nullptr : static_cast<std::byte *>(p);
+    }
+
+    bool truncate(size_t size) noexcept {
+        return ftruncate(fd_, static_cast<off_t>(size)) == 0;
+    }
+
+    void unmap() noexcept {
+        if (data_) {
+            munmap(data_, size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+    }
+};
+
+} // namespace alloy
+
+#endif
@@ -12,8 +12,11 @@
 #include <limits>
 #include <memory>
 #include <optional>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <typeinfo>
 
 // Some general invariants:
@@ -23,14 +26,111 @@
 
 // namespace memlayout::detail
 
+// size of the unit of cache coherence. The value of
+// std::hardware_destructive_interference_size depends on -mtune, a fixed value
+// keeps layouts ABI stable. Override it for targets with larger lines (e.g.
+// 128 on Apple silicon).
+#ifndef ALLOY_CACHE_LINE_SIZE
+#define ALLOY_CACHE_LINE_SIZE 64
+#endif
+
 namespace alloy {
 using namespace details;
 class Layout;
 template <typename T> class HasLayout;
 
+inline constexpr size_t cache_line_size = ALLOY_CACHE_LINE_SIZE;
+static_assert(is_power_of_two(cache_line_size),
+              "cache line size must be a power of two");
+
+//
+// Why a layout computation failed.
+//
+
+enum class LayoutError : uint8_t {
+    bad_align, // the alignment is not a power of two.
+    overflow,  // the size overflows, once padded to the alignment.
+};
+
+M_CEXPR const char *to_string(LayoutError e) noexcept {
+    return e == LayoutError::bad_align ? "alignment is not a power of two"
+                                       : "layout size overflows";
+}
+
+//
+// The result of a layout computation, or why it failed. Shaped like
+// `std::expected<T, LayoutError>` (C++23), and convertible to the
+// `std::optional<T>` the rest of the API returns.
+//
+
+template <typename T> class LayoutResult {
+    T value_;
+    LayoutError error_;
+    bool ok_;
+
+  public:
+    using value_type = T;
+    using error_type = LayoutError;
+
+    M_CEXPR LayoutResult(T value) noexcept
+        : value_(value)
+        , error_()
+        , ok_(true) {}
+
+    M_CEXPR LayoutResult(LayoutError error) noexcept
+        : value_()
+        , error_(error)
+        , ok_(false) {}
+
+    M_CEXPR bool has_value() const noexcept { return ok_; }
+    M_CEXPR explicit operator bool() const noexcept { return ok_; }
+
+    // throws `std::invalid_argument` without a value; in a constant
+    // expression that is a compile error.
+    M_CEXPR const T &value() const {
+        if (!ok_) {
+            throw std::invalid_argument(to_string(error_));
+        }
+        return value_;
+    }
+
+    M_CEXPR const T &operator*() const noexcept { return value_; }
+    M_CEXPR const T *operator->() const noexcept { return &value_; }
+
+    // only meaningful without a value.
+    M_CEXPR LayoutError error() const noexcept { return error_; }
+
+    M_CEXPR T value_or(T fallback) const noexcept {
+        return ok_ ? value_ : fallback;
+    }
+
+    // `f(value)`, itself a `LayoutResult`, or the error.
+    template <typename F>
+    M_CEXPR auto and_then(F &&f) const
+        -> decltype(std::forward<F>(f)(value_)) {
+        if (!ok_) {
+            return error_;
+        }
+        return std::forward<F>(f)(value_);
+    }
+
+    M_CEXPR operator std::optional<T>() const noexcept {
+        if (!ok_) {
+            return {};
+        }
+        return value_;
+    }
+};
+
 //
 // Layout description for a given data type.
 //
+// Computations come in two flavours: the `try_` functions return a
+// `LayoutResult` carrying the error, the others an optional. Layouts known
+// at compile time are built with `Layout::of<T>()` and
+// `Layout::fixed<Size, Align>()`, checked when compiling, with nothing left
+// to check at run time.
+//
 
 class Layout {
     size_t size_;
@@ -40,20 +140,42 @@ class Layout {
         : size_(size)
         , align_(align) {}
 
-    M_CEXPR static std::optional<Layout>
-    from_size_align(size_t size, size_t align) noexcept {
-        if (align != 0 && is_power_of_two(align))
-            return {};
-        if (size > std::numeric_limits<size_t>::max() - (align - 1))
-            return {};
-        return { Layout(size, align) };
-    }
-
   public:
     M_CEXPR Layout() noexcept
         : size_(0)
         , align_(0) {}
 
+    // create a layout from a runtime size and alignment. Only layouts that
+    // satisfy the invariants above are accepted.
+    M_CEXPR static LayoutResult<Layout>
+    try_from_size_align(size_t size, size_t align) noexcept {
+        if (!is_power_of_two(align))
+            return LayoutError::bad_align;
+        if (size > std::numeric_limits<size_t>::max() - (align - 1))
+            return LayoutError::overflow;
+        return Layout(size, align);
+    }
+
+    M_CEXPR static std::optional<Layout>
+    from_size_align(size_t size, size_t align) noexcept {
+        return try_from_size_align(size, align);
+    }
+
+    // a layout checked at compile time.
+    template <size_t Size, size_t Align>
+    static consteval Layout fixed() noexcept {
+        static_assert(is_power_of_two(Align),
+                      "alignment must be a power of two");
+        static_assert(Size <= std::numeric_limits<size_t>::max() - (Align - 1),
+                      "layout size overflows");
+        return Layout(Size, Align);
+    }
+
+    // layout of `T`, checked at compile time.
+    template <typename T> static consteval Layout of() noexcept {
+        return fixed<sizeof(T), alignof(T)>();
+    }
+
     // create a new layout at compile time.
     template <typename T>
     M_CEXPR static std::optional<Layout> create() noexcept {
@@ -70,41 +192,77 @@ class Layout {
     }
 
     // align to `align` if  this.align is not already aligned.
+    M_CEXPR LayoutResult<Layout> try_align_to(size_t align) const noexcept {
+        return Layout::try_from_size_align(size(),
+                                           std::max(this->align(), align));
+    }
+
     M_CEXPR std::optional<Layout> align_to(size_t align) const noexcept {
-        return { Layout::from_size_align(size(),
-                                         std::max(this->align(), align)) };
+        return try_align_to(align);
     }
 
     // return required padding for this->size have this->align.
-    // rounded_up_size = (size + align - 1) & !(align - 1)
+    // rounded_up_size = (size + align - 1) & ~(align - 1)
     // where (align - 1) ensures when overflow rounded up size is 0.
     // required_padding = rounded_up_size - size.
     M_CEXPR size_t required_padding(size_t align) const noexcept {
         auto size = this->size();
         auto rounded_up_size = wrap_sub(wrap_add(size, align), (size_t)1) &
-                               !wrap_sub(align, (size_t)1);
+                               ~wrap_sub(align, (size_t)1);
         return wrap_sub(rounded_up_size, size);
     }
 
+    // round size up to a multiple of `n`, which must be a power of two. The
+    // alignment is left as is.
+    M_CEXPR LayoutResult<Layout> try_pad_to(size_t n) const noexcept {
+        if (!is_power_of_two(n)) {
+            return LayoutError::bad_align;
+        }
+        if (auto new_size = checked_add(size(), required_padding(n))) {
+            return Layout::try_from_size_align(new_size.value(), align());
+        }
+        return LayoutError::overflow;
+    }
+
+    M_CEXPR std::optional<Layout> pad_to(size_t n) const noexcept {
+        return try_pad_to(n);
+    }
+
+    // align to a cache line and pad to whole lines, objects with this layout
+    // never share a cache line with anything else.
+    M_CEXPR std::optional<Layout> align_to_cacheline() const noexcept {
+        if (auto layout = align_to(cache_line_size)) {
+            return layout.value().pad_to(cache_line_size);
+        }
+        return {};
+    }
+
     // return layout that has size added with padding for given alignment.
-    M_CEXPR Layout pad_to_align() noexcept {
+    M_CEXPR Layout pad_to_align() const noexcept {
         auto new_size = required_padding(align()) + size();
         return Layout::from_size_align(new_size, align()).value();
     }
 
     // repeat Layout n times with padding in between.
-    M_CEXPR std::optional<std::pair<Layout, size_t>> repeat(size_t n) noexcept {
+    M_CEXPR LayoutResult<std::pair<Layout, size_t>>
+    try_repeat(size_t n) const noexcept {
         size_t padded_size = size() + required_padding(align());
         if (auto allocate_size = checked_mul(padded_size, n)) {
-            return { { Layout::from_size_align(allocate_size.value(), align())
-                           .value(),
-                       padded_size } };
+            if (auto layout = Layout::try_from_size_align(
+                    allocate_size.value(), align())) {
+                return std::pair{ *layout, padded_size };
+            }
         }
-        return {};
+        return LayoutError::overflow;
+    }
+
+    M_CEXPR std::optional<std::pair<Layout, size_t>>
+    repeat(size_t n) const noexcept {
+        return try_repeat(n);
     }
 
     // repeat Layout n times without adding padding.
-    M_CEXPR std::optional<Layout> repeat_packed(size_t n) noexcept {
+    M_CEXPR std::optional<Layout> repeat_packed(size_t n) const noexcept {
         if (auto sz = checked_mul(size(), n)) {
             if (auto layout = Layout::from_size_align(sz.value(), align())) {
                 return layout;
@@ -114,43 +272,82 @@ class Layout {
     }
 
     // extend layout A with layout B, adding proper padding.
-    M_CEXPR std::optional<std::pair<Layout, size_t>>
-    extend(Layout after) noexcept {
+    M_CEXPR LayoutResult<std::pair<Layout, size_t>>
+    try_extend(Layout after) const noexcept {
         size_t new_align = std::max(align(), after.align());
-        size_t padding = required_padding(new_align);
+        size_t padding = required_padding(after.align());
 
         if (auto offset = checked_add(size(), padding)) {
             if (auto new_size = checked_add(offset.value(), after.size())) {
-                if (auto layout =
-                        Layout::from_size_align(new_size.value(), new_align)) {
-                    return { { layout.value(), offset.value() } };
+                if (auto layout = Layout::try_from_size_align(new_size.value(),
+                                                              new_align)) {
+                    return std::pair{ *layout, offset.value() };
+                } else {
+                    return layout.error();
                 }
             }
         }
 
-        return {};
+        return LayoutError::overflow;
+    }
+
+    M_CEXPR std::optional<std::pair<Layout, size_t>>
+    extend(Layout after) const noexcept {
+        return try_extend(after);
     }
 
     // extend with the same aligment.
-    M_CEXPR std::optional<Layout> extend_packed(Layout after) noexcept {
+    M_CEXPR std::optional<Layout> extend_packed(Layout after) const noexcept {
         if (auto new_size = checked_add(size(), after.size())) {
             return Layout::from_size_align(new_size.value(), align());
         }
         return {};
     }
 
+    // extend with every layout in `fields` in turn, writing the offset of
+    // field i to `offsets[i]`: the result of folding `extend`, in one pass.
+    // Overflow is accumulated instead of checked per field, so the loop has
+    // no early exits; on overflow nothing is returned and `offsets` holds
+    // garbage. The result is not padded to its alignment.
+    M_CEXPR std::optional<Layout>
+    extend_all(std::span<const Layout> fields,
+               std::span<size_t> offsets) const noexcept {
+        if (offsets.size() < fields.size()) {
+            return {};
+        }
+        size_t end = size();
+        size_t max_align = align();
+        bool overflow = false;
+        for (size_t i = 0; i < fields.size(); ++i) {
+            size_t a = fields[i].align();
+            size_t padding = wrap_sub(size_t(0), end) & wrap_sub(a, size_t(1));
+            size_t offset = wrap_add(end, padding);
+            size_t next = wrap_add(offset, fields[i].size());
+            overflow |= offset < end || next < offset;
+            offsets[i] = offset;
+            end = next;
+            max_align = std::max(max_align, a);
+        }
+        if (overflow) {
+            return {};
+        }
+        return Layout::from_size_align(end, max_align);
+    }
+
     // layout for std::array<n, T>
     template <typename T>
-    M_CEXPR std::optional<Layout> array(size_t n) noexcept {
+    M_CEXPR static std::optional<Layout> array(size_t n) noexcept {
         if (auto layout = Layout::create<T>()) {
             if (auto p = layout.value().repeat(n)) {
-                auto [layout, offset] = p;
-                return { layout.pad_to_align() };
+                return { p.value().first.pad_to_align() };
             }
         }
         return {};
     }
 
+    friend M_CEXPR bool operator==(const Layout &,
+                                   const Layout &) noexcept = default;
+
     friend inline std::string to_string(const Layout &self) noexcept {
         return "<Layout| size:" + std::to_string(self.size()) +
                ", align: " + std::to_string(self.align()) + ">";
@@ -205,18 +402,29 @@ class SomeHasLayout {
     void *value_;
     Layout layout_;
 
-    template <typename T>
-    inline SomeHasLayout(T *value)
+    inline SomeHasLayout(void *value, Layout layout)
         : value_(value)
-        , layout_(Layout::create<T>()) {}
+        , layout_(layout) {}
 
   public:
     template <typename T>
+        requires(!std::is_void_v<T>)
     static std::optional<SomeHasLayout> create(T *value) noexcept {
         if (value == nullptr) {
             return {};
         }
-        return { SomeHasLayout(std::forward<T *>(value)) };
+        return { SomeHasLayout(
+            const_cast<void *>(static_cast<const void *>(value)),
+            Layout::create<std::remove_cv_t<T>>().value()) };
+    }
+
+    // erase a pointer whose layout is only known at runtime.
+    static std::optional<SomeHasLayout> create(void *value,
+                                               Layout layout) noexcept {
+        if (value == nullptr) {
+            return {};
+        }
+        return { SomeHasLayout(value, layout) };
     }
 
     M_CEXPR void *ptr() { return value_; }
@@ -232,11 +440,7 @@ std::optional<HasLayout<T>> make_has_layout(T *value) noexcept {
 // smart constructor for HasSomeLayout.
 template <typename T>
 std::optional<SomeHasLayout> make_some_has_layout(T *value) noexcept {
-    if (auto v1 = HasLayout<std::remove_cvref_t<T>>::create(
-            std::forward<T *>(value))) {
-        return { SomeHasLayout(std::move(v1.value())) };
-    }
-    return {};
+    return SomeHasLayout::create(value);
 }
 
 //
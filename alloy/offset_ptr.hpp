@@ -0,0 +1,147 @@
+#ifndef _ALLOY_OFFSET_PTR_HPP
+#define _ALLOY_OFFSET_PTR_HPP
+#pragma once
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+namespace alloy {
+
+//
+// Relocatable pointer.
+// `offset_ptr<T>` stores the distance from its own address to the pointee
+// instead of an absolute address. A structure whose pointers are all offset
+// pointers into the same region stays valid when the region is mapped at
+// another address, e.g. a persistent arena reopened by another process.
+//
+// Copying an offset pointer recomputes the distance from the new location,
+// so it behaves like a raw pointer. Null is encoded as the distance 1, which
+// no object can be at.
+//
+
+template <typename T> class offset_ptr {
+    template <typename U> friend class offset_ptr;
+
+    static constexpr ptrdiff_t null_offset = 1;
+
+    ptrdiff_t offset_;
+
+    inline ptrdiff_t offset_to(const volatile void *p) const noexcept {
+        if (p == nullptr) {
+            return null_offset;
+        }
+        return reinterpret_cast<intptr_t>(p) -
+               reinterpret_cast<intptr_t>(this);
+    }
+
+  public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using difference_type = ptrdiff_t;
+    using pointer = T *;
+    using reference = std::add_lvalue_reference_t<T>;
+    using iterator_category = std::random_access_iterator_tag;
+
+    offset_ptr() noexcept
+        : offset_(null_offset) {}
+    offset_ptr(std::nullptr_t) noexcept
+        : offset_(null_offset) {}
+    offset_ptr(T *p) noexcept
+        : offset_(offset_to(p)) {}
+
+    offset_ptr(const offset_ptr &other) noexcept
+        : offset_(offset_to(other.get())) {}
+
+    template <typename U>
+        requires std::is_convertible_v<U *, T *>
+    offset_ptr(const offset_ptr<U> &other) noexcept
+        : offset_(offset_to(static_cast<T *>(other.get()))) {}
+
+    offset_ptr &operator=(const offset_ptr &other) noexcept {
+        offset_ = offset_to(other.get());
+        return *this;
+    }
+
+    offset_ptr &operator=(T *p) noexcept {
+        offset_ = offset_to(p);
+        return *this;
+    }
+
+    offset_ptr &operator=(std::nullptr_t) noexcept {
+        offset_ = null_offset;
+        return *this;
+    }
+
+    inline T *get() const noexcept {
+        if (offset_ == null_offset) {
+            return nullptr;
+        }
+        return reinterpret_cast<T *>(reinterpret_cast<intptr_t>(this) +
+                                     offset_);
+    }
+
+    explicit operator bool() const noexcept { return offset_ != null_offset; }
+    operator T *() const noexcept { return get(); }
+
+    reference operator*() const noexcept
+        requires(!std::is_void_v<T>)
+    {
+        return *get();
+    }
+    T *operator->() const noexcept { return get(); }
+    reference operator[](ptrdiff_t i) const noexcept
+        requires(!std::is_void_v<T>)
+    {
+        return get()[i];
+    }
+
+    offset_ptr &operator+=(ptrdiff_t n) noexcept {
+        offset_ += n * static_cast<ptrdiff_t>(sizeof(T));
+        return *this;
+    }
+    offset_ptr &operator-=(ptrdiff_t n) noexcept {
+        offset_ -= n * static_cast<ptrdiff_t>(sizeof(T));
+        return *this;
+    }
+    offset_ptr &operator++() noexcept { return *this += 1; }
+    offset_ptr &operator--() noexcept { return *this -= 1; }
+    offset_ptr operator++(int) noexcept {
+        offset_ptr old(*this);
+        ++*this;
+        return old;
+    }
+    offset_ptr operator--(int) noexcept {
+        offset_ptr old(*this);
+        --*this;
+        return old;
+    }
+
+    friend offset_ptr operator+(const offset_ptr &p, ptrdiff_t n) noexcept {
+        return offset_ptr(p.get() + n);
+    }
+    friend offset_ptr operator-(const offset_ptr &p, ptrdiff_t n) noexcept {
+        return offset_ptr(p.get() - n);
+    }
+    friend ptrdiff_t operator-(const offset_ptr &a,
+                               const offset_ptr &b) noexcept {
+        return a.get() - b.get();
+    }
+
+    friend bool operator==(const offset_ptr &a, const offset_ptr &b) noexcept {
+        return a.get() == b.get();
+    }
+    friend bool operator==(const offset_ptr &a, std::nullptr_t) noexcept {
+        return !a;
+    }
+    friend auto operator<=>(const offset_ptr &a,
+                            const offset_ptr &b) noexcept {
+        return std::compare_three_way()(a.get(), b.get());
+    }
+};
+
+} // namespace alloy
+
+#endif
@@ -0,0 +1,408 @@
+#ifndef _ALLOY_OPEN_HASH_MAP_HPP
+#define _ALLOY_OPEN_HASH_MAP_HPP
+#pragma once
+
+#include "allocator.hpp"
+#include "memlayout.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace alloy {
+
+//
+// Open addressing hash map backed by an alloy allocator.
+//
+// The whole table is one block of the allocator: a byte of control per slot,
+// then the slots, `Layout::repeat` of the entry layout placed with
+// `Layout::extend` and aligned to a cache line. A lookup scans the control
+// bytes, which hold 7 bits of the hash, and only compares the keys of slots
+// whose bits match. Collisions probe linearly and erasing shifts the
+// following entries back, so there are no tombstones and a lookup never
+// scans past the first empty slot.
+//
+// The table doubles when it would be more than 7/8 full. After
+// `reserve(n)`, the first `n` entries are inserted without allocating;
+// sized up front, e.g. for a connection table, the map never touches the
+// allocator again. Inserting and erasing move entries, so pointers to
+// values are only stable until the next insertion or erasure.
+//
+//     ProviderAllocator<HeapProvider> heap;
+//     open_hash_map<int, Connection, decltype(heap)> connections(heap);
+//     connections.reserve(10000);
+//     connections.try_emplace(fd, ...);
+//     if (Connection *c = connections.find(fd)) { ... }
+//
+
+template <typename K, typename V, LayoutAllocator A,
+          typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class open_hash_map {
+    static_assert(std::is_nothrow_move_constructible_v<K> &&
+                      std::is_nothrow_move_constructible_v<V>,
+                  "open_hash_map requires nothrow movable keys and values");
+
+  public:
+    // keys must not be modified in place.
+    struct entry {
+        K key;
+        V value;
+    };
+
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = entry;
+
+    static constexpr size_t min_capacity = 8;
+
+  private:
+    static constexpr uint8_t empty_slot = 0;
+
+    A *alloc_;
+    uint8_t *control_;
+    entry *slots_;
+    size_t size_;
+    size_t capacity_; // 0 or a power of two.
+    [[no_unique_address]] Hash hash_;
+    [[no_unique_address]] Eq eq_;
+
+    // table of `capacity` slots, and the offset of the slots in it.
+    static std::optional<std::pair<Layout, size_t>>
+    table_layout(size_t capacity) noexcept {
+        auto control = Layout::of<uint8_t>().repeat(capacity);
+        auto slots = Layout::of<entry>().repeat(capacity);
+        if (control && slots) {
+            if (auto table = control->first.extend(slots->first)) {
+                if (auto aligned = table->first.align_to_cacheline()) {
+                    return { { aligned->pad_to_align(), table->second } };
+                }
+            }
+        }
+        return {};
+    }
+
+    static M_CEXPR size_t max_entries(size_t capacity) noexcept {
+        return capacity - capacity / 8;
+    }
+
+    // Fibonacci hashing spreads weak hashes, such as the identity for
+    // integers, over the whole word.
+    inline uint64_t hash_of(const K &key) const noexcept {
+        return uint64_t(hash_(key)) * 0x9e3779b97f4a7c15ull;
+    }
+
+    inline size_t home_of(uint64_t h) const noexcept {
+        return size_t(h >> (64 - std::countr_zero(capacity_)));
+    }
+
+    static inline uint8_t tag_of(uint64_t h) noexcept {
+        return uint8_t(0x80 | (h & 0x7f));
+    }
+
+    inline size_t mask() const noexcept { return capacity_ - 1; }
+
+    // slot holding `key`, or `capacity_`.
+    inline size_t find_slot(const K &key) const noexcept {
+        if (size_ == 0) {
+            return capacity_;
+        }
+        uint64_t h = hash_of(key);
+        uint8_t tag = tag_of(h);
+        for (size_t i = home_of(h);; i = (i + 1) & mask()) {
+            if (control_[i] == empty_slot) {
+                return capacity_;
+            }
+            if (control_[i] == tag && eq_(slots_[i].key, key)) {
+                return i;
+            }
+        }
+    }
+
+    // first empty slot on the probe sequence of `h`.
+    inline size_t free_slot(uint64_t h) const noexcept {
+        size_t i = home_of(h);
+        while (control_[i] != empty_slot) {
+            i = (i + 1) & mask();
+        }
+        return i;
+    }
+
+    void rehash(size_t capacity) {
+        auto table = table_layout(capacity);
+        void *block = table ? alloc_->allocate(table->first) : nullptr;
+        if (block == nullptr) {
+            throw std::bad_alloc();
+        }
+        auto control = static_cast<uint8_t *>(block);
+        auto slots = reinterpret_cast<entry *>(control + table->second);
+        std::fill_n(control, capacity, empty_slot);
+
+        uint8_t *old_control = std::exchange(control_, control);
+        entry *old_slots = std::exchange(slots_, slots);
+        size_t old_capacity = std::exchange(capacity_, capacity);
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_control[i] != empty_slot) {
+                uint64_t h = hash_of(old_slots[i].key);
+                size_t j = free_slot(h);
+                ::new (slots_ + j) entry(std::move(old_slots[i]));
+                control_[j] = old_control[i];
+                std::destroy_at(old_slots + i);
+            }
+        }
+        if (old_capacity) {
+            alloc_->deallocate(old_control,
+                               table_layout(old_capacity)->first);
+        }
+    }
+
+    void grow_for(size_t n) {
+        if (n <= max_entries(capacity_)) {
+            return;
+        }
+        size_t capacity = std::max(min_capacity, 2 * capacity_);
+        while (n > max_entries(capacity)) {
+            capacity *= 2;
+        }
+        rehash(capacity);
+    }
+
+    template <typename Key, typename... Args>
+    std::pair<V *, bool> emplace_key(Key &&key, Args &&...args) {
+        size_t found = find_slot(key);
+        if (found != capacity_) {
+            return { &slots_[found].value, false };
+        }
+        if (size_ + 1 > max_entries(capacity_)) {
+            // `key` and `args` may refer to entries, which the rehash moves:
+            // build the entry first.
+            entry e{ K(std::forward<Key>(key)),
+                     V(std::forward<Args>(args)...) };
+            grow_for(size_ + 1);
+            return place(std::move(e));
+        }
+        uint64_t h = hash_of(key);
+        size_t i = free_slot(h);
+        ::new (slots_ + i)
+            entry{ K(std::forward<Key>(key)), V(std::forward<Args>(args)...) };
+        control_[i] = tag_of(h);
+        ++size_;
+        return { &slots_[i].value, true };
+    }
+
+    std::pair<V *, bool> place(entry &&e) noexcept {
+        uint64_t h = hash_of(e.key);
+        size_t i = free_slot(h);
+        ::new (slots_ + i) entry(std::move(e));
+        control_[i] = tag_of(h);
+        ++size_;
+        return { &slots_[i].value, true };
+    }
+
+    void destroy() noexcept {
+        clear();
+        if (capacity_) {
+            alloc_->deallocate(control_, table_layout(capacity_)->first);
+        }
+        control_ = nullptr;
+        slots_ = nullptr;
+        capacity_ = 0;
+    }
+
+  public:
+    template <bool Const> class basic_iterator {
+        friend class open_hash_map;
+        template <bool> friend class basic_iterator;
+        using map = std::conditional_t<Const, const open_hash_map,
+                                       open_hash_map>;
+
+        map *map_;
+        size_t i_;
+
+        basic_iterator(map *m, size_t i) noexcept
+            : map_(m)
+            , i_(i) {
+            skip();
+        }
+
+        void skip() noexcept {
+            while (i_ < map_->capacity_ &&
+                   map_->control_[i_] == empty_slot) {
+                ++i_;
+            }
+        }
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = entry;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const entry *, entry *>;
+        using reference = std::conditional_t<Const, const entry &, entry &>;
+
+        basic_iterator() noexcept
+            : map_(nullptr)
+            , i_(0) {}
+
+        template <bool C>
+            requires(Const && !C)
+        basic_iterator(const basic_iterator<C> &other) noexcept
+            : map_(other.map_)
+            , i_(other.i_) {}
+
+        reference operator*() const noexcept { return map_->slots_[i_]; }
+        pointer operator->() const noexcept { return map_->slots_ + i_; }
+
+        basic_iterator &operator++() noexcept {
+            ++i_;
+            skip();
+            return *this;
+        }
+        basic_iterator operator++(int) noexcept {
+            basic_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        friend bool operator==(const basic_iterator &a,
+                               const basic_iterator &b) noexcept {
+            return a.i_ == b.i_;
+        }
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    // the allocator must outlive the map.
+    explicit open_hash_map(A &alloc, Hash hash = Hash(), Eq eq = Eq()) noexcept
+        : alloc_(&alloc)
+        , control_(nullptr)
+        , slots_(nullptr)
+        , size_(0)
+        , capacity_(0)
+        , hash_(std::move(hash))
+        , eq_(std::move(eq)) {}
+
+    open_hash_map(const open_hash_map &) = delete;
+
+    open_hash_map(open_hash_map &&other) noexcept
+        : open_hash_map(*other.alloc_, other.hash_, other.eq_) {
+        swap(other);
+    }
+
+    open_hash_map &operator=(open_hash_map other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~open_hash_map() { destroy(); }
+
+    void swap(open_hash_map &other) noexcept {
+        std::swap(alloc_, other.alloc_);
+        std::swap(control_, other.control_);
+        std::swap(slots_, other.slots_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(hash_, other.hash_);
+        std::swap(eq_, other.eq_);
+    }
+
+    A &allocator() const noexcept { return *alloc_; }
+
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    size_t capacity() const noexcept { return capacity_; }
+
+    // bytes taken from the allocator.
+    size_t table_bytes() const noexcept {
+        return capacity_ ? table_layout(capacity_)->first.size() : 0;
+    }
+
+    // make room for `n` entries, so that inserting them doesn't allocate.
+    void reserve(size_t n) { grow_for(n); }
+
+    // the value of `key`, nullptr if it isn't in the map.
+    V *find(const K &key) noexcept {
+        size_t i = find_slot(key);
+        return i == capacity_ ? nullptr : &slots_[i].value;
+    }
+    const V *find(const K &key) const noexcept {
+        size_t i = find_slot(key);
+        return i == capacity_ ? nullptr : &slots_[i].value;
+    }
+
+    bool contains(const K &key) const noexcept {
+        return find_slot(key) != capacity_;
+    }
+
+    // the value of `key`, constructed from `args` if the key is new. Also
+    // returns whether it was inserted.
+    template <typename... Args>
+    std::pair<V *, bool> try_emplace(const K &key, Args &&...args) {
+        return emplace_key(key, std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    std::pair<V *, bool> try_emplace(K &&key, Args &&...args) {
+        return emplace_key(std::move(key), std::forward<Args>(args)...);
+    }
+
+    // like `try_emplace`, but an existing value is replaced.
+    std::pair<V *, bool> insert_or_assign(K key, V value) {
+        auto [v, inserted] = emplace_key(std::move(key), std::move(value));
+        if (!inserted) {
+            *v = std::move(value);
+        }
+        return { v, inserted };
+    }
+
+    V &operator[](const K &key) { return *try_emplace(key).first; }
+
+    bool erase(const K &key) noexcept {
+        size_t i = find_slot(key);
+        if (i == capacity_) {
+            return false;
+        }
+        std::destroy_at(slots_ + i);
+        control_[i] = empty_slot;
+        --size_;
+        // shift back the entries that probed past `i`.
+        for (size_t j = (i + 1) & mask(); control_[j] != empty_slot;
+             j = (j + 1) & mask()) {
+            size_t home = home_of(hash_of(slots_[j].key));
+            if (((j - home) & mask()) >= ((j - i) & mask())) {
+                ::new (slots_ + i) entry(std::move(slots_[j]));
+                std::destroy_at(slots_ + j);
+                control_[i] = control_[j];
+                control_[j] = empty_slot;
+                i = j;
+            }
+        }
+        return true;
+    }
+
+    // drop every entry, keeping the table.
+    void clear() noexcept {
+        for (size_t i = 0; i < capacity_ && size_; ++i) {
+            if (control_[i] != empty_slot) {
+                std::destroy_at(slots_ + i);
+                control_[i] = empty_slot;
+                --size_;
+            }
+        }
+    }
+
+    iterator begin() noexcept { return iterator(this, 0); }
+    iterator end() noexcept { return iterator(this, capacity_); }
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator end() const noexcept {
+        return const_iterator(this, capacity_);
+    }
+};
+
+} // namespace alloy
+
+#endif
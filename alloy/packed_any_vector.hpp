@@ -0,0 +1,335 @@
+#ifndef _ALLOY_PACKED_ANY_VECTOR_HPP
+#define _ALLOY_PACKED_ANY_VECTOR_HPP
+#pragma once
+
+#include "memlayout.hpp"
+#include <algorithm>
+#include <any>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace alloy {
+
+namespace details {
+
+// what a packed_any_vector needs to know about the type of an element.
+struct any_ops {
+    Layout layout;
+    const std::type_info *type;
+    // nullptr when the type is trivially destructible.
+    void (*destroy)(void *) noexcept;
+    // move construct at `dst` and destroy `src`, nullptr when the type is
+    // trivially copyable and can be moved with memcpy.
+    void (*relocate)(void *dst, void *src) noexcept;
+};
+
+template <typename T>
+inline constexpr any_ops any_ops_for = {
+    Layout::create<T>().value(),
+    &typeid(T),
+    std::is_trivially_destructible_v<T>
+        ? nullptr
+        : +[](void *p) noexcept { std::destroy_at(static_cast<T *>(p)); },
+    std::is_trivially_copyable_v<T>
+        ? nullptr
+        : +[](void *dst, void *src) noexcept {
+              auto s = static_cast<T *>(src);
+              ::new (dst) T(std::move(*s));
+              std::destroy_at(s);
+          },
+};
+
+} // namespace details
+
+//
+// Owning heterogeneous sequence in a single buffer.
+//
+// `packed_any_vector` holds values of any type back to back: each element is
+// placed after the previous one with `Layout::extend`, so it only pays the
+// padding its own alignment needs. The buffer is aligned to the largest
+// alignment of its elements and grows geometrically; elements keep their
+// offsets on growth. An index keeps the offset and the type operations of
+// every element.
+//
+// Compared to `std::vector<std::any>` there is no allocation per element
+// and iteration walks one linear buffer. Elements are accessed by type
+// with `get<T>` or erased as `SomeHasLayout` views. Element types must be
+// nothrow move constructible.
+//
+
+class packed_any_vector {
+    struct Entry {
+        size_t offset;
+        const details::any_ops *ops;
+    };
+
+    std::byte *data_;
+    size_t capacity_;
+    size_t align_; // alignment of `data_`.
+    Layout used_;  // bytes in use, aligned to the largest element alignment.
+    bool trivial_; // every element can be moved with memcpy.
+    std::vector<Entry> index_;
+
+  public:
+    packed_any_vector() noexcept
+        : data_(nullptr)
+        , capacity_(0)
+        , align_(alignof(std::max_align_t))
+        , used_(Layout::from_size_align(0, 1).value())
+        , trivial_(true) {}
+
+    // reserve `bytes` of element storage.
+    explicit packed_any_vector(size_t bytes)
+        : packed_any_vector() {
+        reserve(bytes);
+    }
+
+    packed_any_vector(const packed_any_vector &) = delete;
+
+    packed_any_vector(packed_any_vector &&other) noexcept
+        : packed_any_vector() {
+        swap(other);
+    }
+
+    packed_any_vector &operator=(packed_any_vector other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~packed_any_vector() {
+        clear();
+        deallocate();
+    }
+
+    void swap(packed_any_vector &other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(align_, other.align_);
+        std::swap(used_, other.used_);
+        std::swap(trivial_, other.trivial_);
+        std::swap(index_, other.index_);
+    }
+
+    size_t size() const noexcept { return index_.size(); }
+    bool empty() const noexcept { return index_.empty(); }
+
+    // bytes used by the elements, padding included.
+    size_t bytes() const noexcept { return used_.size(); }
+    size_t capacity() const noexcept { return capacity_; }
+
+    void reserve(size_t bytes) {
+        if (bytes > capacity_) {
+            reallocate(bytes, align_);
+        }
+    }
+
+    // the element is built before the old ones are moved on growth, so
+    // `args` may refer to elements of the vector.
+    template <typename T, typename... Args> T &emplace_back(Args &&...args) {
+        static_assert(std::is_nothrow_move_constructible_v<T>,
+                      "packed_any_vector requires nothrow movable elements");
+        constexpr auto &ops = details::any_ops_for<T>;
+        auto next = used_.extend(ops.layout);
+        if (!next) {
+            throw std::bad_alloc();
+        }
+        auto [grown, offset] = next.value();
+        // room in the index first, so only the element can throw below.
+        if (index_.size() == index_.capacity()) {
+            index_.reserve(std::max<size_t>(8, 2 * index_.size()));
+        }
+        std::byte *data = data_;
+        size_t capacity = capacity_;
+        size_t align = align_;
+        if (grown.size() > capacity_ || ops.layout.align() > align_) {
+            capacity = std::max(grown.size(), 2 * capacity_);
+            align = std::max(align_, ops.layout.align());
+            data = static_cast<std::byte *>(
+                ::operator new(capacity, std::align_val_t(align)));
+        }
+        T *p;
+        try {
+            p = ::new (data + offset) T(std::forward<Args>(args)...);
+        } catch (...) {
+            if (data != data_) {
+                ::operator delete(data, std::align_val_t(align));
+            }
+            throw;
+        }
+        if (data != data_) {
+            relocate(data, capacity, align);
+        }
+        index_.push_back({ offset, &ops });
+        used_ = grown;
+        trivial_ = trivial_ && ops.relocate == nullptr;
+        return *p;
+    }
+
+    template <typename T> std::decay_t<T> &push_back(T &&value) {
+        return emplace_back<std::decay_t<T>>(std::forward<T>(value));
+    }
+
+    void pop_back() noexcept {
+        Entry e = index_.back();
+        index_.pop_back();
+        if (e.ops->destroy) {
+            e.ops->destroy(data_ + e.offset);
+        }
+        size_t end = 0;
+        if (!index_.empty()) {
+            end = index_.back().offset + index_.back().ops->layout.size();
+        }
+        used_ = Layout::from_size_align(end, used_.align()).value();
+    }
+
+    void clear() noexcept {
+        for (const Entry &e : index_) {
+            if (e.ops->destroy) {
+                e.ops->destroy(data_ + e.offset);
+            }
+        }
+        index_.clear();
+        used_ = Layout::from_size_align(0, used_.align()).value();
+    }
+
+    //
+    // Element access.
+    //
+
+    const std::type_info &type(size_t i) const noexcept {
+        return *index_[i].ops->type;
+    }
+
+    Layout layout(size_t i) const noexcept { return index_[i].ops->layout; }
+
+    // byte offset of element `i` in the buffer.
+    size_t offset(size_t i) const noexcept { return index_[i].offset; }
+
+    void *data(size_t i) noexcept { return data_ + index_[i].offset; }
+    const void *data(size_t i) const noexcept {
+        return data_ + index_[i].offset;
+    }
+
+    template <typename T> bool holds(size_t i) const noexcept {
+        const auto *ops = index_[i].ops;
+        return ops == &details::any_ops_for<T> || *ops->type == typeid(T);
+    }
+
+    // element `i` if it is a `T`, nullptr otherwise.
+    template <typename T> T *get_if(size_t i) noexcept {
+        return holds<T>(i) ? std::launder(static_cast<T *>(data(i)))
+                           : nullptr;
+    }
+    template <typename T> const T *get_if(size_t i) const noexcept {
+        return holds<T>(i) ? std::launder(static_cast<const T *>(data(i)))
+                           : nullptr;
+    }
+
+    // element `i` as a `T`, throws std::bad_any_cast if it isn't one.
+    template <typename T> T &get(size_t i) {
+        if (T *p = get_if<T>(i)) {
+            return *p;
+        }
+        throw std::bad_any_cast();
+    }
+    template <typename T> const T &get(size_t i) const {
+        if (const T *p = get_if<T>(i)) {
+            return *p;
+        }
+        throw std::bad_any_cast();
+    }
+
+    // non owning view of element `i`.
+    SomeHasLayout operator[](size_t i) noexcept {
+        return SomeHasLayout::create(data(i), layout(i)).value();
+    }
+
+    //
+    // Iteration over erased views, in insertion order.
+    //
+
+    class iterator {
+        packed_any_vector *v_;
+        size_t i_;
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = SomeHasLayout;
+        using difference_type = ptrdiff_t;
+        using reference = SomeHasLayout;
+
+        iterator() noexcept
+            : v_(nullptr)
+            , i_(0) {}
+        iterator(packed_any_vector *v, size_t i) noexcept
+            : v_(v)
+            , i_(i) {}
+
+        SomeHasLayout operator*() const noexcept { return (*v_)[i_]; }
+        size_t index() const noexcept { return i_; }
+
+        iterator &operator++() noexcept {
+            ++i_;
+            return *this;
+        }
+        iterator operator++(int) noexcept { return { v_, i_++ }; }
+        bool operator==(const iterator &o) const noexcept {
+            return i_ == o.i_;
+        }
+    };
+
+    iterator begin() noexcept { return { this, 0 }; }
+    iterator end() noexcept { return { this, size() }; }
+
+  private:
+    // elements keep their offsets: the new buffer is at least as aligned as
+    // the old one.
+    void reallocate(size_t capacity, size_t align) {
+        relocate(static_cast<std::byte *>(
+                     ::operator new(capacity, std::align_val_t(align))),
+                 capacity, align);
+    }
+
+    // move the elements to `data`, `capacity` bytes aligned to `align`.
+    void relocate(std::byte *data, size_t capacity, size_t align) noexcept {
+        if (trivial_) {
+            if (used_.size()) {
+                std::memcpy(data, data_, used_.size());
+            }
+        } else {
+            for (const Entry &e : index_) {
+                if (e.ops->relocate) {
+                    e.ops->relocate(data + e.offset, data_ + e.offset);
+                } else {
+                    std::memcpy(data + e.offset, data_ + e.offset,
+                                e.ops->layout.size());
+                }
+            }
+        }
+        deallocate();
+        data_ = data;
+        capacity_ = capacity;
+        align_ = align;
+    }
+
+    void deallocate() noexcept {
+        if (data_) {
+            ::operator delete(data_, std::align_val_t(align_));
+            data_ = nullptr;
+        }
+    }
+};
+
+inline void swap(packed_any_vector &a, packed_any_vector &b) noexcept {
+    a.swap(b);
+}
+
+} // namespace alloy
+
+#endif
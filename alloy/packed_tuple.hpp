@@ -0,0 +1,229 @@
+#ifndef _ALLOY_PACKED_TUPLE_HPP
+#define _ALLOY_PACKED_TUPLE_HPP
+#pragma once
+
+#include "struct_layout.hpp"
+#include <array>
+#include <cstddef>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace alloy {
+
+//
+// Field reordering.
+// Every type's size is a multiple of its alignment, so laying fields out by
+// decreasing alignment leaves no padding between them; the only padding left
+// is the tail padding up to the record's alignment, which no order avoids.
+// That order is therefore minimal.
+//
+// Fields with the same alignment are ordered by decreasing size, then by
+// declaration order, so the result is deterministic.
+//
+
+// storage order of `Ts...` with the least padding: `order[k]` is the index
+// of the field stored in the k-th slot.
+template <typename... Ts>
+M_CEXPR std::array<size_t, sizeof...(Ts)> min_padding_order() noexcept {
+    constexpr size_t n = sizeof...(Ts);
+    constexpr std::array<Layout, n> fields{ Layout::create<Ts>().value()... };
+    std::array<size_t, n> order{};
+    for (size_t i = 0; i < n; ++i) {
+        order[i] = i;
+    }
+    auto before = [&](size_t a, size_t b) {
+        if (fields[a].align() != fields[b].align()) {
+            return fields[a].align() > fields[b].align();
+        }
+        if (fields[a].size() != fields[b].size()) {
+            return fields[a].size() > fields[b].size();
+        }
+        return a < b;
+    };
+    for (size_t i = 1; i < n; ++i) {
+        for (size_t j = i; j > 0 && before(order[j], order[j - 1]); --j) {
+            std::swap(order[j], order[j - 1]);
+        }
+    }
+    return order;
+}
+
+namespace details {
+
+template <typename... Ts, size_t... K>
+M_CEXPR auto reordered_layout(std::index_sequence<K...>) noexcept {
+    constexpr auto order = min_padding_order<Ts...>();
+    return layout_of_fields<
+        std::tuple_element_t<order[K], std::tuple<Ts...>>...>();
+}
+
+} // namespace details
+
+// field layout of `Ts...` in `min_padding_order`. Fields are listed in
+// storage order.
+template <typename... Ts>
+M_CEXPR std::optional<StructLayout<sizeof...(Ts)>>
+reordered_layout() noexcept {
+    return details::reordered_layout<Ts...>(
+        std::index_sequence_for<Ts...>{});
+}
+
+//
+// Tuple like record stored in `min_padding_order`. Fields are still
+// addressed by their declaration index, the reordering is invisible to the
+// user apart from the smaller footprint.
+//
+
+template <typename... Ts> class packed_tuple {
+    static_assert(sizeof...(Ts) > 0, "packed_tuple needs at least one field");
+
+    static constexpr size_t n = sizeof...(Ts);
+    static constexpr auto order = min_padding_order<Ts...>();
+    static constexpr auto record = reordered_layout<Ts...>().value();
+
+    // slot of each field, the inverse of `order`.
+    static constexpr auto slots = [] {
+        std::array<size_t, n> slots{};
+        for (size_t k = 0; k < n; ++k) {
+            slots[order[k]] = k;
+        }
+        return slots;
+    }();
+
+    alignas(record.layout.align()) std::byte storage_[record.layout.size()];
+
+  public:
+    template <size_t I>
+    using type = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+    static M_CEXPR Layout layout() noexcept { return record.layout; }
+
+    template <size_t I> static M_CEXPR size_t offset_of() noexcept {
+        return record.fields[slots[I]].offset;
+    }
+
+    packed_tuple() { init_default(std::index_sequence_for<Ts...>{}); }
+
+    template <typename... Us>
+        requires(sizeof...(Us) == n &&
+                 (std::is_constructible_v<Ts, Us &&> && ...))
+    explicit packed_tuple(Us &&...values) {
+        init(std::index_sequence_for<Ts...>{}, std::forward<Us>(values)...);
+    }
+
+    packed_tuple(const packed_tuple &other) {
+        copy(other, std::index_sequence_for<Ts...>{});
+    }
+
+    packed_tuple(packed_tuple &&other) {
+        move(other, std::index_sequence_for<Ts...>{});
+    }
+
+    packed_tuple &operator=(const packed_tuple &other) {
+        assign(other, std::index_sequence_for<Ts...>{});
+        return *this;
+    }
+
+    packed_tuple &operator=(packed_tuple &&other) {
+        assign(std::move(other), std::index_sequence_for<Ts...>{});
+        return *this;
+    }
+
+    ~packed_tuple() { destroy(std::index_sequence_for<Ts...>{}); }
+
+    template <size_t I> type<I> &get() & noexcept {
+        return *std::launder(
+            reinterpret_cast<type<I> *>(storage_ + offset_of<I>()));
+    }
+
+    template <size_t I> const type<I> &get() const & noexcept {
+        return *std::launder(
+            reinterpret_cast<const type<I> *>(storage_ + offset_of<I>()));
+    }
+
+    template <size_t I> type<I> &&get() && noexcept {
+        return std::move(get<I>());
+    }
+
+  private:
+    template <size_t I> void *slot() noexcept {
+        return storage_ + offset_of<I>();
+    }
+
+    // builds every field with `make(std::integral_constant<size_t, I>{})`. If
+    // one throws, the fields already built are destroyed before rethrowing.
+    template <size_t... I, typename F>
+    void construct(std::index_sequence<I...>, F &&make) {
+        size_t built = 0;
+        try {
+            ((make(std::integral_constant<size_t, I>{}), ++built), ...);
+        } catch (...) {
+            ((I < built ? get<I>().~type<I>() : void()), ...);
+            throw;
+        }
+    }
+
+    template <size_t... I> void init_default(std::index_sequence<I...> seq) {
+        construct(seq, [this](auto i) { new (slot<i>()) type<i>(); });
+    }
+
+    template <size_t... I, typename... Us>
+    void init(std::index_sequence<I...> seq, Us &&...values) {
+        auto args = std::forward_as_tuple(std::forward<Us>(values)...);
+        construct(seq, [&](auto i) {
+            new (slot<i>()) type<i>(std::get<i>(std::move(args)));
+        });
+    }
+
+    template <size_t... I>
+    void copy(const packed_tuple &other, std::index_sequence<I...> seq) {
+        construct(seq, [&](auto i) {
+            new (slot<i>()) type<i>(other.template get<i>());
+        });
+    }
+
+    template <size_t... I>
+    void move(packed_tuple &other, std::index_sequence<I...> seq) {
+        construct(seq, [&](auto i) {
+            new (slot<i>()) type<i>(std::move(other.template get<i>()));
+        });
+    }
+
+    template <typename Other, size_t... I>
+    void assign(Other &&other, std::index_sequence<I...>) {
+        ((get<I>() = std::forward<Other>(other).template get<I>()), ...);
+    }
+
+    template <size_t... I> void destroy(std::index_sequence<I...>) {
+        (get<I>().~type<I>(), ...);
+    }
+};
+
+template <size_t I, typename... Ts>
+decltype(auto) get(packed_tuple<Ts...> &t) noexcept {
+    return t.template get<I>();
+}
+
+template <size_t I, typename... Ts>
+decltype(auto) get(const packed_tuple<Ts...> &t) noexcept {
+    return t.template get<I>();
+}
+
+template <size_t I, typename... Ts>
+decltype(auto) get(packed_tuple<Ts...> &&t) noexcept {
+    return std::move(t).template get<I>();
+}
+
+} // namespace alloy
+
+template <typename... Ts>
+struct std::tuple_size<alloy::packed_tuple<Ts...>>
+    : std::integral_constant<size_t, sizeof...(Ts)> {};
+
+template <size_t I, typename... Ts>
+struct std::tuple_element<I, alloy::packed_tuple<Ts...>>
+    : std::tuple_element<I, std::tuple<Ts...>> {};
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef _ALLOY_PAGE_PROVIDER_HPP
+#define _ALLOY_PAGE_PROVIDER_HPP
+#pragma once
+
+#include "memlayout.hpp"
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <new>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+namespace alloy {
+
+//
+// Backing memory providers.
+// The bump, fixed size, slab and linked list allocators get their chunks
+// from a provider: `allocate_chunk(layout)` returns memory for `layout` or
+// nullptr, `deallocate_chunk(ptr, layout)` gives it back with the same
+// layout. Providers are small values stored inside the allocators.
+//
+
+template <typename P>
+concept MemoryProvider = requires(P &p, Layout layout, void *ptr) {
+    { p.allocate_chunk(layout) } -> std::same_as<void *>;
+    { p.deallocate_chunk(ptr, layout) } -> std::same_as<void>;
+};
+
+//
+// Chunks from the global heap. The default provider.
+//
+
+struct HeapProvider {
+    inline void *allocate_chunk(Layout layout) noexcept {
+        return ::operator new(layout.size(), std::align_val_t(layout.align()),
+                              std::nothrow);
+    }
+
+    inline void deallocate_chunk(void *ptr, Layout layout) noexcept {
+        ::operator delete(ptr, std::align_val_t(layout.align()));
+    }
+};
+
+//
+// Chunks mapped directly from the kernel with mmap.
+//
+// Huge pages cut TLB misses for large arenas: `explicit_pages` maps from the
+// hugetlbfs pool with MAP_HUGETLB (falling back to transparent huge pages
+// when the pool is empty), `transparent` asks for THP with
+// madvise(MADV_HUGEPAGE). Chunks are then rounded up to `huge_page_size`.
+//
+// With `node >= 0` the chunk is bound to that NUMA node with mbind, either
+// strictly or as a preference. Binding is best effort: on kernels without
+// NUMA support the chunk is still handed out. `prefault` touches every page
+// up front, after the binding, so the first use doesn't pay for page faults;
+// otherwise pages are committed lazily by the first touch.
+//
+
+class PageProvider {
+  public:
+    enum class HugePages { none, transparent, explicit_pages };
+
+    struct Options {
+        HugePages huge_pages = HugePages::none;
+        int node = -1;      // NUMA node to bind to, -1 for no binding.
+        bool strict = true; // MPOL_BIND when true, MPOL_PREFERRED otherwise.
+        bool prefault = false;
+    };
+
+    static constexpr size_t huge_page_size = 2 * 1024 * 1024;
+
+  private:
+    Options options_;
+
+  public:
+    PageProvider() noexcept = default;
+    explicit PageProvider(Options options) noexcept
+        : options_(options) {}
+
+    // provider bound to the node the calling thread runs on.
+    static inline PageProvider local(Options options) noexcept {
+        options.node = current_node();
+        return PageProvider(options);
+    }
+    static inline PageProvider local() noexcept { return local(Options()); }
+
+    const Options &options() const noexcept { return options_; }
+
+    static inline size_t page_size() noexcept {
+        static const size_t size = sysconf(_SC_PAGESIZE);
+        return size;
+    }
+
+    // NUMA node of the CPU the calling thread runs on, -1 if unknown.
+    static inline int current_node() noexcept {
+#if defined(__linux__) && defined(SYS_getcpu)
+        unsigned cpu = 0, node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+            return static_cast<int>(node);
+        }
+#endif
+        return -1;
+    }
+
+    // granularity chunks are rounded to.
+    inline size_t granularity() const noexcept {
+        return options_.huge_pages == HugePages::none ? page_size()
+                                                      : huge_page_size;
+    }
+
+    void *allocate_chunk(Layout layout) noexcept {
+        size_t unit = granularity();
+        size_t size = align_up(layout.size(), unit);
+        size_t align = std::max(layout.align(), unit);
+        if (size == 0 || size < layout.size()) {
+            return nullptr;
+        }
+
+        void *p = nullptr;
+#if defined(MAP_HUGETLB)
+        if (options_.huge_pages == HugePages::explicit_pages) {
+            p = map_aligned(size, align, MAP_HUGETLB);
+        }
+#endif
+        if (p == nullptr) {
+            p = map_aligned(size, align, 0);
+            if (p == nullptr) {
+                return nullptr;
+            }
+#if defined(MADV_HUGEPAGE)
+            if (options_.huge_pages != HugePages::none) {
+                madvise(p, size, MADV_HUGEPAGE);
+            }
+#endif
+        }
+
+        bind(p, size);
+        if (options_.prefault) {
+            for (size_t i = 0; i < size; i += page_size()) {
+                static_cast<volatile char *>(p)[i] = 0;
+            }
+        }
+        return p;
+    }
+
+    void deallocate_chunk(void *ptr, Layout layout) noexcept {
+        if (ptr) {
+            munmap(ptr, align_up(layout.size(), granularity()));
+        }
+    }
+
+  private:
+    // map `size` bytes at an `align` boundary. mmap only promises page
+    // alignment (huge page alignment with MAP_HUGETLB); larger alignments
+    // are met by mapping more and trimming both ends.
+    void *map_aligned(size_t size, size_t align, int extra_flags) noexcept {
+        size_t mapped_align = page_size();
+#if defined(MAP_HUGETLB)
+        if (extra_flags & MAP_HUGETLB) {
+            mapped_align = huge_page_size;
+        }
+#endif
+        size_t map_size = size;
+        if (align > mapped_align) {
+            map_size = size + align - mapped_align;
+            if (map_size < size) {
+                return nullptr;
+            }
+        }
+        void *raw = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+        if (raw == MAP_FAILED) {
+            return nullptr;
+        }
+        auto begin = reinterpret_cast<uintptr_t>(raw);
+        auto aligned = align_up(begin, align);
+        if (aligned != begin) {
+            munmap(raw, aligned - begin);
+        }
+        if (begin + map_size > aligned + size) {
+            munmap(reinterpret_cast<void *>(aligned + size),
+                   begin + map_size - (aligned + size));
+        }
+        return reinterpret_cast<void *>(aligned);
+    }
+
+    void bind(void *p, size_t size) noexcept {
+#if defined(__linux__) && defined(SYS_mbind)
+        if (options_.node < 0) {
+            return;
+        }
+        constexpr size_t bits = sizeof(unsigned long) * 8;
+        unsigned long mask[16] = {};
+        if (static_cast<size_t>(options_.node) >= bits * 16) {
+            return;
+        }
+        mask[options_.node / bits] = 1UL << (options_.node % bits);
+        int mode = options_.strict ? MPOL_BIND : MPOL_PREFERRED;
+        syscall(SYS_mbind, p, size, mode, mask, bits * 16, 0);
+#else
+        (void)p;
+        (void)size;
+#endif
+    }
+};
+
+} // namespace alloy
+
+#endif
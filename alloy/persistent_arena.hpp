@@ -0,0 +1,326 @@
+#ifndef _ALLOY_PERSISTENT_ARENA_HPP
+#define _ALLOY_PERSISTENT_ARENA_HPP
+#pragma once
+
+#include "linked_list_allocator.hpp"
+#include "mapped_file.hpp"
+#include "memlayout.hpp"
+#include "offset_ptr.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <utility>
+
+#include <unistd.h>
+
+namespace alloy {
+
+//
+// Persistent arenas.
+//
+// Allocators whose region is a file mapped with MAP_SHARED. Everything the
+// allocator needs lives in the file, next to the data, as offsets: build a
+// data structure once with `offset_ptr` links, close the file, and reopening
+// it, in this or another process, at whatever address the mapping lands,
+// gives the structure back ready to use.
+//
+//     auto arena = PersistentArena::create("index.bin", 1 << 20).value();
+//     auto *list = ::new (arena.allocate(layout)) List{};
+//     arena.set_root(list);
+//     ...
+//     auto again = PersistentArena::open("index.bin").value();
+//     List *list = again.root<List>();
+//
+// `PersistentArena` bumps a cursor, `PersistentHeap<Policy>` runs a
+// `LinkedListAllocator` over the file so blocks can be freed and reused.
+// The file does not grow: its size is fixed by `create`. Alignments up to
+// the page size are kept across mappings. Objects in the file must not hold
+// raw pointers, only offset pointers into the same file.
+//
+
+namespace details {
+
+struct PersistentHeader {
+    static constexpr char signature[8] = { 'A', 'L', 'L', 'O',
+                                           'Y', 'P', 'A', 'R' };
+    static constexpr uint32_t current_version = 1;
+
+    enum Kind : uint32_t { bump = 1, heap = 2 };
+
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;
+    uint64_t size;   // file size.
+    uint64_t used;   // bump cursor, offset from the start of the file.
+    uint64_t root;   // offset of the root object, 0 when there is none.
+};
+
+// the allocator region starts at this offset in the file.
+inline constexpr size_t persistent_data_offset =
+    align_up(sizeof(PersistentHeader), cache_line_size);
+
+// the mapped file and header shared by the persistent allocators.
+class PersistentFile {
+    MappedFile file_;
+
+    explicit PersistentFile(MappedFile file) noexcept
+        : file_(std::move(file)) {}
+
+  public:
+    PersistentFile() noexcept = default;
+
+    static std::optional<PersistentFile>
+    create(const std::filesystem::path &path, size_t size,
+           PersistentHeader::Kind kind) noexcept {
+        if (size < persistent_data_offset) {
+            return {};
+        }
+        auto file = MappedFile::create(path, size);
+        if (!file) {
+            return {};
+        }
+        PersistentHeader h{};
+        std::copy(PersistentHeader::signature,
+                  PersistentHeader::signature + 8, h.magic);
+        h.version = PersistentHeader::current_version;
+        h.kind = kind;
+        h.size = size;
+        h.used = persistent_data_offset;
+        h.root = 0;
+        std::memcpy(file->data(), &h, sizeof(h));
+        return PersistentFile(std::move(file.value()));
+    }
+
+    static std::optional<PersistentFile>
+    open(const std::filesystem::path &path,
+         PersistentHeader::Kind kind) noexcept {
+        auto file = MappedFile::open(path, MappedFile::Mode::read_write);
+        if (!file || file->size() < persistent_data_offset) {
+            return {};
+        }
+        PersistentFile f(std::move(file.value()));
+        const PersistentHeader &h = f.header();
+        if (!std::equal(h.magic, h.magic + 8, PersistentHeader::signature) ||
+            h.version != PersistentHeader::current_version ||
+            h.kind != kind || h.size != f.size() ||
+            h.used < persistent_data_offset || h.used > h.size ||
+            h.root >= h.size) {
+            return {};
+        }
+        return f;
+    }
+
+    PersistentHeader &header() noexcept {
+        return *reinterpret_cast<PersistentHeader *>(file_.data());
+    }
+    const PersistentHeader &header() const noexcept {
+        return *reinterpret_cast<const PersistentHeader *>(file_.data());
+    }
+
+    std::byte *base() noexcept { return file_.data(); }
+    const std::byte *base() const noexcept { return file_.data(); }
+    size_t size() const noexcept { return file_.size(); }
+
+    std::byte *data() noexcept { return base() + persistent_data_offset; }
+    size_t data_size() const noexcept {
+        return size() - persistent_data_offset;
+    }
+
+    bool contains(const void *ptr) const noexcept {
+        auto p = static_cast<const std::byte *>(ptr);
+        return p >= base() + persistent_data_offset && p < base() + size();
+    }
+
+    void set_root(const void *ptr) noexcept {
+        header().root = ptr ? static_cast<const std::byte *>(ptr) - base() : 0;
+    }
+    void *root() noexcept {
+        return header().root ? base() + header().root : nullptr;
+    }
+
+    bool sync() noexcept { return file_.sync(); }
+};
+
+} // namespace details
+
+//
+// Bump allocation over a mapped file. The cursor is kept in the file
+// header, so allocations survive closing and reopening the file; only the
+// most recent allocation can be given back.
+//
+
+class PersistentArena {
+    details::PersistentFile file_;
+
+    explicit PersistentArena(details::PersistentFile file) noexcept
+        : file_(std::move(file)) {}
+
+  public:
+    PersistentArena() noexcept = default;
+
+    // create `path`, or truncate it, as an empty arena of `size` bytes.
+    static std::optional<PersistentArena>
+    create(const std::filesystem::path &path, size_t size) noexcept {
+        auto file = details::PersistentFile::create(
+            path, size, details::PersistentHeader::bump);
+        if (!file) {
+            return {};
+        }
+        return PersistentArena(std::move(file.value()));
+    }
+
+    // map an arena written before, keeping its allocations.
+    static std::optional<PersistentArena>
+    open(const std::filesystem::path &path) noexcept {
+        auto file = details::PersistentFile::open(
+            path, details::PersistentHeader::bump);
+        if (!file) {
+            return {};
+        }
+        return PersistentArena(std::move(file.value()));
+    }
+
+    inline void *allocate(Layout layout) noexcept {
+        if (file_.base() == nullptr || layout.align() == 0 ||
+            layout.align() > static_cast<size_t>(sysconf(_SC_PAGESIZE))) {
+            return nullptr;
+        }
+        auto &h = file_.header();
+        size_t offset = align_up(h.used, layout.align());
+        if (offset > h.size || layout.size() > h.size - offset) {
+            return nullptr;
+        }
+        h.used = offset + layout.size();
+        return file_.base() + offset;
+    }
+
+    inline void deallocate(void *ptr, Layout layout) noexcept {
+        if (ptr == nullptr) {
+            return;
+        }
+        auto &h = file_.header();
+        auto p = static_cast<std::byte *>(ptr);
+        if (p + layout.size() == file_.base() + h.used) {
+            h.used = p - file_.base();
+        }
+    }
+
+    inline bool owns(const void *ptr) const noexcept {
+        auto p = static_cast<const std::byte *>(ptr);
+        return file_.contains(ptr) && p < file_.base() + file_.header().used;
+    }
+
+    // drop every allocation and the root.
+    inline void reset() noexcept {
+        if (file_.base()) {
+            file_.header().used = details::persistent_data_offset;
+            file_.header().root = 0;
+        }
+    }
+
+    // the object a reader of the file starts from.
+    template <typename T = void> T *root() noexcept {
+        return static_cast<T *>(file_.root());
+    }
+    void set_root(const void *ptr) noexcept { file_.set_root(ptr); }
+
+    // bytes allocated, alignment padding included.
+    size_t used() const noexcept {
+        return file_.header().used - details::persistent_data_offset;
+    }
+    size_t capacity() const noexcept { return file_.data_size(); }
+
+    std::byte *base() noexcept { return file_.base(); }
+
+    // flush the arena to the file.
+    bool sync() noexcept { return file_.sync(); }
+};
+
+//
+// Free list heap over a mapped file. The blocks are those of a
+// `LinkedListAllocator`, whose headers only hold sizes: reopening the file
+// rebuilds the free list from them.
+//
+
+template <FitPolicy Policy = FitPolicy::first_fit> class PersistentHeap {
+    details::PersistentFile file_;
+    LinkedListAllocator<Policy> heap_;
+
+    explicit PersistentHeap(details::PersistentFile file) noexcept
+        : file_(std::move(file)) {}
+
+  public:
+    PersistentHeap() noexcept = default;
+
+    // create `path`, or truncate it, as an empty heap of `size` bytes.
+    static std::optional<PersistentHeap>
+    create(const std::filesystem::path &path, size_t size) noexcept {
+        auto file = details::PersistentFile::create(
+            path, size, details::PersistentHeader::heap);
+        if (!file) {
+            return {};
+        }
+        PersistentHeap heap(std::move(file.value()));
+        heap.heap_ = LinkedListAllocator<Policy>(heap.file_.data(),
+                                                 heap.file_.data_size());
+        if (heap.heap_.capacity() == 0) {
+            return {};
+        }
+        return heap;
+    }
+
+    // map a heap written before, keeping its blocks.
+    static std::optional<PersistentHeap>
+    open(const std::filesystem::path &path) noexcept {
+        auto file = details::PersistentFile::open(
+            path, details::PersistentHeader::heap);
+        if (!file) {
+            return {};
+        }
+        PersistentHeap heap(std::move(file.value()));
+        if (!heap.heap_.attach(heap.file_.data(), heap.file_.data_size())) {
+            return {};
+        }
+        return heap;
+    }
+
+    void *allocate(Layout layout) noexcept {
+        if (layout.align() > static_cast<size_t>(sysconf(_SC_PAGESIZE))) {
+            return nullptr;
+        }
+        return heap_.allocate(layout);
+    }
+
+    void deallocate(void *ptr, Layout layout = Layout()) noexcept {
+        heap_.deallocate(ptr, layout);
+    }
+
+    bool owns(const void *ptr) const noexcept { return heap_.owns(ptr); }
+
+    // drop every block and the root.
+    void reset() noexcept {
+        heap_.reset();
+        if (file_.base()) {
+            file_.header().root = 0;
+        }
+    }
+
+    template <typename T = void> T *root() noexcept {
+        return static_cast<T *>(file_.root());
+    }
+    void set_root(const void *ptr) noexcept { file_.set_root(ptr); }
+
+    LinkedListAllocator<Policy> &heap() noexcept { return heap_; }
+    size_t capacity() const noexcept { return heap_.capacity(); }
+    size_t available() const noexcept { return heap_.available(); }
+
+    std::byte *base() noexcept { return file_.base(); }
+
+    bool sync() noexcept { return file_.sync(); }
+};
+
+} // namespace alloy
+
+#endif
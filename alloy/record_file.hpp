@@ -0,0 +1,342 @@
+#ifndef _ALLOY_RECORD_FILE_HPP
+#define _ALLOY_RECORD_FILE_HPP
+#pragma once
+
+#include "mapped_file.hpp"
+#include "memlayout.hpp"
+#include "struct_layout.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace alloy {
+
+//
+// Zero copy record files.
+//
+// Records of a trivially copyable type are stored exactly as they are laid
+// out in memory, behind a fixed size header describing that layout: record
+// size and alignment, the offset, size and alignment of every field (from
+// `layout_of_struct`) and the byte order. Reading is mapping the file and
+// checking the header against the layout of the type the reader asks for;
+// the records are then used in place, nothing is parsed or copied.
+//
+//     RecordWriter<Tick> w = RecordWriter<Tick>::create("ticks.bin").value();
+//     w.append(tick);
+//     w.finish();
+//
+//     auto r = RecordReader<Tick>::open("ticks.bin");
+//     for (const Tick &t : r->records()) { ... }
+//
+// Aggregates are described field by field, other trivially copyable types
+// as a single opaque field. Aggregates with C array members are not
+// supported by the field reflection.
+//
+
+struct RecordHeader {
+    static constexpr size_t max_fields = 16;
+    static constexpr uint32_t current_version = 1;
+    static constexpr char signature[8] = { 'A', 'L', 'L', 'O',
+                                           'Y', 'R', 'E', 'C' };
+
+    // records start on a boundary at least this large in the file.
+    static constexpr size_t data_align = 64;
+
+    enum Endian : uint8_t { little = 0, big = 1 };
+
+    struct Field {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t align;
+
+        friend M_CEXPR bool operator==(const Field &,
+                                       const Field &) noexcept = default;
+    };
+
+    char magic[8];
+    uint32_t version;
+    uint8_t endian; // a single byte, readable before the byte order is known.
+    uint8_t reserved;
+    uint16_t field_count;
+    uint64_t record_size;
+    uint64_t record_align;
+    uint64_t record_count;
+    uint64_t data_offset;
+    Field fields[max_fields];
+
+    // whether records described by `self` can be read as the records
+    // described by `other`. The record count is not compared.
+    M_CEXPR bool same_schema(const RecordHeader &other) const noexcept {
+        return std::equal(magic, magic + 8, other.magic) &&
+               version == other.version && endian == other.endian &&
+               field_count == other.field_count &&
+               record_size == other.record_size &&
+               record_align == other.record_align &&
+               data_offset == other.data_offset &&
+               std::equal(fields, fields + field_count, other.fields);
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<RecordHeader>);
+
+// the header of a file of `T` records, with no records yet.
+template <typename T> M_CEXPR RecordHeader record_header() noexcept {
+    static_assert(std::is_trivially_copyable_v<T> &&
+                      std::is_standard_layout_v<T>,
+                  "records must be trivially copyable and standard layout");
+    RecordHeader h{};
+    std::copy(RecordHeader::signature, RecordHeader::signature + 8, h.magic);
+    h.version = RecordHeader::current_version;
+    h.endian = std::endian::native == std::endian::little
+                   ? RecordHeader::little
+                   : RecordHeader::big;
+    h.record_size = sizeof(T);
+    h.record_align = alignof(T);
+    h.record_count = 0;
+    h.data_offset = align_up(sizeof(RecordHeader),
+                             std::max(RecordHeader::data_align, alignof(T)));
+    if constexpr (std::is_aggregate_v<T> && std::is_class_v<T>) {
+        auto layout = layout_of_struct<T>().value();
+        h.field_count = static_cast<uint16_t>(layout.fields.size());
+        for (size_t i = 0; i < layout.fields.size(); ++i) {
+            auto &f = layout.fields[i];
+            h.fields[i] = { f.offset, f.size, f.align };
+        }
+    } else {
+        h.field_count = 1;
+        h.fields[0] = { 0, sizeof(T), alignof(T) };
+    }
+    return h;
+}
+
+//
+// Appends records to a byte buffer or to a mapped file. The buffer or file
+// holds a valid record file after every append, `finish` trims a file to
+// its exact size and flushes it.
+//
+
+template <typename T> class RecordWriter {
+  public:
+    static constexpr RecordHeader schema = record_header<T>();
+    static constexpr size_t data_offset = schema.data_offset;
+    static constexpr size_t buffer_align =
+        std::max(RecordHeader::data_align, alignof(T));
+
+  private:
+    std::byte *data_;
+    size_t capacity_;
+    size_t count_;
+    MappedFile file_; // open when writing to a file.
+
+    RecordWriter(MappedFile file) noexcept
+        : data_(file.data())
+        , capacity_(file.size())
+        , count_(0)
+        , file_(std::move(file)) {
+        write_header();
+    }
+
+  public:
+    // write to a buffer in memory.
+    RecordWriter()
+        : data_(nullptr)
+        , capacity_(0)
+        , count_(0) {
+        if (!grow(data_offset)) {
+            throw std::bad_alloc();
+        }
+    }
+
+    // write to `path`, created or truncated, with room for `capacity`
+    // records before the file has to grow.
+    static std::optional<RecordWriter>
+    create(const std::filesystem::path &path,
+           size_t capacity = 1024) noexcept {
+        auto file =
+            MappedFile::create(path, data_offset + capacity * sizeof(T));
+        if (!file) {
+            return {};
+        }
+        return RecordWriter(std::move(file.value()));
+    }
+
+    RecordWriter(const RecordWriter &) = delete;
+    RecordWriter &operator=(const RecordWriter &) = delete;
+
+    RecordWriter(RecordWriter &&other) noexcept
+        : data_(std::exchange(other.data_, nullptr))
+        , capacity_(std::exchange(other.capacity_, 0))
+        , count_(std::exchange(other.count_, 0))
+        , file_(std::move(other.file_)) {}
+
+    ~RecordWriter() {
+        if (file_.is_open()) {
+            finish();
+        } else if (data_) {
+            ::operator delete(data_, std::align_val_t(buffer_align));
+        }
+    }
+
+    size_t size() const noexcept { return count_; }
+
+    bool append(const T &record) noexcept {
+        return append(std::span<const T>(&record, 1));
+    }
+
+    bool append(std::span<const T> records) noexcept {
+        size_t end = data_offset + (count_ + records.size()) * sizeof(T);
+        if (end > capacity_ &&
+            !grow(std::max(end, capacity_ + capacity_ / 2))) {
+            return false;
+        }
+        if (!records.empty()) {
+            std::memcpy(data_ + data_offset + count_ * sizeof(T),
+                        records.data(), records.size_bytes());
+        }
+        count_ += records.size();
+        reinterpret_cast<RecordHeader *>(data_)->record_count = count_;
+        return true;
+    }
+
+    // the record file written so far.
+    std::span<const std::byte> bytes() const noexcept {
+        return { data_, data_offset + count_ * sizeof(T) };
+    }
+
+    // trim the file to the records written and flush it to disk.
+    bool finish() noexcept {
+        if (!file_.is_open()) {
+            return true;
+        }
+        bool resized = file_.resize(data_offset + count_ * sizeof(T));
+        data_ = file_.data();
+        capacity_ = file_.size();
+        return resized && file_.sync();
+    }
+
+  private:
+    void write_header() noexcept {
+        RecordHeader h = schema;
+        h.record_count = count_;
+        std::memcpy(data_, &h, sizeof(h));
+    }
+
+    bool grow(size_t capacity) noexcept {
+        if (file_.is_open()) {
+            // the mapping may have moved even when the resize failed.
+            bool resized = file_.resize(capacity);
+            data_ = file_.data();
+            capacity_ = file_.size();
+            return resized;
+        }
+        auto data = static_cast<std::byte *>(::operator new(
+            capacity, std::align_val_t(buffer_align), std::nothrow));
+        if (data == nullptr) {
+            return false;
+        }
+        if (data_) {
+            std::memcpy(data, data_, data_offset + count_ * sizeof(T));
+            ::operator delete(data_, std::align_val_t(buffer_align));
+            data_ = data;
+        } else {
+            data_ = data;
+            write_header();
+        }
+        capacity_ = capacity;
+        return true;
+    }
+};
+
+//
+// Typed, read only view of a record file. The records are used in place in
+// the mapping (or in the caller's buffer), nothing is copied.
+//
+
+template <typename T> class RecordReader {
+    MappedFile file_; // open when the reader mapped the file itself.
+    const T *records_;
+    size_t count_;
+
+    RecordReader(MappedFile file, const T *records, size_t count) noexcept
+        : file_(std::move(file))
+        , records_(records)
+        , count_(count) {}
+
+  public:
+    static constexpr RecordHeader schema = record_header<T>();
+
+    // map `path` and check it holds `T` records.
+    static std::optional<RecordReader>
+    open(const std::filesystem::path &path) noexcept {
+        auto file = MappedFile::open(path);
+        if (!file) {
+            return {};
+        }
+        auto records = check({ file->data(), file->size() });
+        if (!records) {
+            return {};
+        }
+        auto [data, count] = records.value();
+        return RecordReader(std::move(file.value()), data, count);
+    }
+
+    // read the record file in `bytes`, which must outlive the reader and be
+    // aligned for `T`.
+    static std::optional<RecordReader>
+    view(std::span<const std::byte> bytes) noexcept {
+        auto records = check(bytes);
+        if (!records) {
+            return {};
+        }
+        auto [data, count] = records.value();
+        return RecordReader(MappedFile(), data, count);
+    }
+
+    // header of the record file in `bytes`, if it has one.
+    static std::optional<RecordHeader>
+    header_of(std::span<const std::byte> bytes) noexcept {
+        RecordHeader h;
+        if (bytes.size() < sizeof(h)) {
+            return {};
+        }
+        std::memcpy(&h, bytes.data(), sizeof(h));
+        if (!std::equal(h.magic, h.magic + 8, RecordHeader::signature)) {
+            return {};
+        }
+        return h;
+    }
+
+    std::span<const T> records() const noexcept { return { records_, count_ }; }
+    size_t size() const noexcept { return count_; }
+    const T &operator[](size_t i) const noexcept { return records_[i]; }
+    const T *begin() const noexcept { return records_; }
+    const T *end() const noexcept { return records_ + count_; }
+
+  private:
+    static std::optional<std::pair<const T *, size_t>>
+    check(std::span<const std::byte> bytes) noexcept {
+        auto h = header_of(bytes);
+        if (!h || !h->same_schema(schema) ||
+            reinterpret_cast<uintptr_t>(bytes.data()) % alignof(T) != 0) {
+            return {};
+        }
+        auto data_size = checked_mul(h->record_count, h->record_size);
+        if (!data_size || bytes.size() < h->data_offset ||
+            data_size.value() > bytes.size() - h->data_offset) {
+            return {};
+        }
+        auto data = reinterpret_cast<const T *>(bytes.data() + h->data_offset);
+        return { { std::launder(data), h->record_count } };
+    }
+};
+
+} // namespace alloy
+
+#endif
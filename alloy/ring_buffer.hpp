@@ -0,0 +1,280 @@
+#ifndef _ALLOY_RING_BUFFER_HPP
+#define _ALLOY_RING_BUFFER_HPP
+#pragma once
+
+#include "allocator.hpp"
+#include "cache_padded.hpp"
+#include "memlayout.hpp"
+#include "static_layout.hpp"
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace alloy {
+
+//
+// Fixed capacity ring buffers backed by an alloy allocator.
+//
+// The slots are one block of the allocator, `Layout::repeat` of the slot
+// layout aligned to a cache line, taken once by the constructor: pushing
+// and popping never allocate, and a full ring refuses the push. The
+// capacity is rounded up to a power of two, so positions wrap with a mask.
+//
+// `spsc_ring` has one producer and one consumer. Each side owns a cache
+// line with its own position and a copy of the other side's, refreshed only
+// when the copy says the ring looks full (or empty), so in the steady state
+// neither side reads the other's line.
+//
+// `mpmc_ring` takes any number of producers and consumers (Vyukov's bounded
+// queue). A cell is a sequence number followed by the value, laid out by
+// `static_layout`; the sequence says whether the cell is free for the
+// position a producer claimed, or full for the one a consumer claimed.
+// Claiming is one compare and swap on the shared position. Values are
+// constructed before a cell is claimed, so a throwing constructor leaves the
+// ring untouched.
+//
+//     ProviderAllocator<HeapProvider> heap;
+//     spsc_ring<Message, decltype(heap)> inbox(heap, 1024);
+//     inbox.try_push(message);          // producer thread
+//     if (auto m = inbox.try_pop()) {}  // consumer thread
+//
+
+namespace details {
+
+// storage for `capacity` slots of `slot`, and the stride between them.
+inline std::optional<std::pair<Layout, size_t>>
+ring_layout(Layout slot, size_t capacity) noexcept {
+    if (auto slots = slot.repeat(capacity)) {
+        if (auto aligned = slots->first.align_to_cacheline()) {
+            return { { aligned->pad_to_align(), slots->second } };
+        }
+    }
+    return {};
+}
+
+inline size_t ring_capacity(size_t capacity) noexcept {
+    return std::bit_ceil(std::max<size_t>(capacity, 2));
+}
+
+template <LayoutAllocator A>
+inline char *allocate_ring(A &alloc, Layout slot, size_t capacity) {
+    auto layout = ring_layout(slot, capacity);
+    void *p = layout ? alloc.allocate(layout->first) : nullptr;
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return static_cast<char *>(p);
+}
+
+} // namespace details
+
+template <typename T, LayoutAllocator A> class spsc_ring {
+    static_assert(std::is_nothrow_move_constructible_v<T>,
+                  "spsc_ring requires nothrow movable values");
+
+    struct Producer {
+        std::atomic<size_t> tail{ 0 };
+        size_t head = 0; // last head seen.
+    };
+
+    struct Consumer {
+        std::atomic<size_t> head{ 0 };
+        size_t tail = 0; // last tail seen.
+    };
+
+    A *alloc_;
+    T *slots_;
+    size_t mask_;
+    cache_padded<Producer> producer_;
+    cache_padded<Consumer> consumer_;
+
+  public:
+    using value_type = T;
+
+    spsc_ring(A &alloc, size_t capacity)
+        : alloc_(&alloc)
+        , slots_(nullptr)
+        , mask_(details::ring_capacity(capacity) - 1) {
+        slots_ = reinterpret_cast<T *>(
+            details::allocate_ring(alloc, Layout::of<T>(), mask_ + 1));
+    }
+
+    spsc_ring(const spsc_ring &) = delete;
+    spsc_ring &operator=(const spsc_ring &) = delete;
+
+    ~spsc_ring() {
+        while (try_pop()) {
+        }
+        alloc_->deallocate(
+            slots_, details::ring_layout(Layout::of<T>(), capacity())->first);
+    }
+
+    size_t capacity() const noexcept { return mask_ + 1; }
+
+    // producer side.
+    template <typename... Args> bool try_emplace(Args &&...args) {
+        size_t tail = producer_->tail.load(std::memory_order_relaxed);
+        if (tail - producer_->head == capacity()) {
+            producer_->head =
+                consumer_->head.load(std::memory_order_acquire);
+            if (tail - producer_->head == capacity()) {
+                return false;
+            }
+        }
+        ::new (slots_ + (tail & mask_)) T(std::forward<Args>(args)...);
+        producer_->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T &value) { return try_emplace(value); }
+    bool try_push(T &&value) { return try_emplace(std::move(value)); }
+
+    // consumer side.
+    std::optional<T> try_pop() noexcept {
+        size_t head = consumer_->head.load(std::memory_order_relaxed);
+        if (head == consumer_->tail) {
+            consumer_->tail =
+                producer_->tail.load(std::memory_order_acquire);
+            if (head == consumer_->tail) {
+                return {};
+            }
+        }
+        T *slot = slots_ + (head & mask_);
+        std::optional<T> value(std::move(*slot));
+        std::destroy_at(slot);
+        consumer_->head.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    // values in the ring, exact only when neither side is running.
+    size_t size() const noexcept {
+        size_t head = consumer_->head.load(std::memory_order_acquire);
+        return producer_->tail.load(std::memory_order_acquire) - head;
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+};
+
+template <typename T, LayoutAllocator A> class mpmc_ring {
+    static_assert(std::is_nothrow_move_constructible_v<T>,
+                  "mpmc_ring requires nothrow movable values");
+
+    using cell = static_layout<std::atomic<size_t>, T>;
+
+    A *alloc_;
+    char *cells_;
+    size_t mask_;
+    cache_padded<std::atomic<size_t>> tail_;
+    cache_padded<std::atomic<size_t>> head_;
+
+    inline char *cell_at(size_t pos) const noexcept {
+        return cells_ + (pos & mask_) * cell::size;
+    }
+
+    inline std::atomic<size_t> &sequence(size_t pos) const noexcept {
+        return *cell::template field<0>(cell_at(pos));
+    }
+
+    inline T *value_at(size_t pos) const noexcept {
+        return cell::template field<1>(cell_at(pos));
+    }
+
+  public:
+    using value_type = T;
+
+    mpmc_ring(A &alloc, size_t capacity)
+        : alloc_(&alloc)
+        , cells_(nullptr)
+        , mask_(details::ring_capacity(capacity) - 1)
+        , tail_(std::in_place, 0)
+        , head_(std::in_place, 0) {
+        cells_ = details::allocate_ring(alloc, cell::layout, mask_ + 1);
+        for (size_t i = 0; i <= mask_; ++i) {
+            ::new (&sequence(i)) std::atomic<size_t>(i);
+        }
+    }
+
+    mpmc_ring(const mpmc_ring &) = delete;
+    mpmc_ring &operator=(const mpmc_ring &) = delete;
+
+    ~mpmc_ring() {
+        while (try_pop()) {
+        }
+        for (size_t i = 0; i <= mask_; ++i) {
+            std::destroy_at(&sequence(i));
+        }
+        alloc_->deallocate(
+            cells_, details::ring_layout(cell::layout, capacity())->first);
+    }
+
+    size_t capacity() const noexcept { return mask_ + 1; }
+
+    template <typename... Args> bool try_emplace(Args &&...args) {
+        return try_push(T(std::forward<Args>(args)...));
+    }
+
+    bool try_push(const T &value) { return try_push(T(value)); }
+
+    // `value` is left alone when the ring is full.
+    bool try_push(T &&value) noexcept {
+        size_t pos = tail_->load(std::memory_order_relaxed);
+        for (;;) {
+            size_t seq = sequence(pos).load(std::memory_order_acquire);
+            auto diff = std::intptr_t(seq - pos);
+            if (diff == 0) {
+                if (tail_->compare_exchange_weak(pos, pos + 1,
+                                                 std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_->load(std::memory_order_relaxed);
+            }
+        }
+        ::new (value_at(pos)) T(std::move(value));
+        sequence(pos).store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> try_pop() noexcept {
+        size_t pos = head_->load(std::memory_order_relaxed);
+        for (;;) {
+            size_t seq = sequence(pos).load(std::memory_order_acquire);
+            auto diff = std::intptr_t(seq - (pos + 1));
+            if (diff == 0) {
+                if (head_->compare_exchange_weak(pos, pos + 1,
+                                                 std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return {};
+            } else {
+                pos = head_->load(std::memory_order_relaxed);
+            }
+        }
+        T *slot = value_at(pos);
+        std::optional<T> result(std::move(*slot));
+        std::destroy_at(slot);
+        sequence(pos).store(pos + capacity(), std::memory_order_release);
+        return result;
+    }
+
+    // values in the ring, exact only when no thread is running.
+    size_t size() const noexcept {
+        size_t head = head_->load(std::memory_order_acquire);
+        return tail_->load(std::memory_order_acquire) - head;
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+};
+
+} // namespace alloy
+
+#endif
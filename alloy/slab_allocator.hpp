@@ -2,11 +2,557 @@
 #define _ALLOY_SLAB_ALLOCATOR_HPP
 #pragma once
 
+#include "allocator_stats.hpp"
 #include "memlayout.hpp"
+#include "page_provider.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
-class SlabAllocator {
-    using allocator_type = SlabAllocator;
+namespace alloy {
+
+//
+// Multi size class slab allocator.
+//
+// A request is rounded up with `Layout::pad_to_align` and served from the
+// smallest size class that fits it and keeps its alignment. Objects of one
+// class live in slabs: `slab_size` aligned spans, so the slab of any object
+// is found by masking its address.
+//
+// Every thread works on its own heap. A heap owns a set of slabs per class
+// and keeps a magazine (a small stack) of free objects per class in front of
+// them, so the common allocate/deallocate is a push or pop with no atomics.
+// An object freed by a thread that doesn't own its slab is pushed onto the
+// slab's lock-free MPSC list; the owning heap drains it the next time it
+// refills from that slab.
+//
+// Slabs are carved out of `region_size` regions taken from the provider, so
+// a huge page provider backs many slabs with a single huge page.
+//
+// Heaps of exited threads are adopted by new threads. Regions are returned
+// to the provider only by `reset()`, `release()` or destruction, which must
+// not race with other calls.
+//
+
+template <MemoryProvider Provider = HeapProvider, StatsPolicy Stats = NoStats>
+class BasicSlabAllocator {
+    static_assert(Stats::thread_safe,
+                  "the slab allocator is shared between threads");
+
+  public:
+    using allocator_type = BasicSlabAllocator<Provider, Stats>;
+    using provider_type = Provider;
+    using stats_type = Stats;
+
+    // may be called from several threads at once.
+    static constexpr bool thread_safe = true;
+
+    static constexpr size_t slab_size = 64 * 1024;
+    static constexpr size_t region_size = 2 * 1024 * 1024;
+    static constexpr size_t magazine_size = 64;
+    static constexpr size_t refill_count = magazine_size / 2;
+
+    static constexpr std::array<size_t, 32> size_classes = {
+        16,   32,   48,   64,   80,   96,   112,  128,  160,  192,  224,
+        256,  320,  384,  448,  512,  640,  768,  896,  1024, 1280, 1536,
+        1792, 2048, 2560, 3072, 3584, 4096, 5120, 6144, 7168, 8192
+    };
+    static constexpr size_t class_count = size_classes.size();
+    static constexpr size_t max_size = size_classes.back();
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    // statistics of one size class, summed over all heaps.
+    struct ClassStats {
+        size_t size;        // object size of the class.
+        size_t slabs;       // slabs held by the class.
+        size_t allocations; // objects handed out.
+        size_t frees;       // objects given back, remote frees are counted
+                            // once they're drained by the owner.
+
+        M_CEXPR size_t in_use() const noexcept { return allocations - frees; }
+        M_CEXPR size_t reserved() const noexcept { return slabs * slab_size; }
+
+        friend inline std::string to_string(const ClassStats &self) noexcept {
+            return "<SlabClass| size: " + std::to_string(self.size) +
+                   ", slabs: " + std::to_string(self.slabs) +
+                   ", in use: " + std::to_string(self.in_use()) +
+                   ", allocations: " + std::to_string(self.allocations) +
+                   ", frees: " + std::to_string(self.frees) + ">";
+        }
+    };
+
+    using ClassStatsArray = std::array<ClassStats, class_count>;
+
+  private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    struct Heap;
+
+    // header at the start of each slab.
+    struct Slab {
+        Heap *owner;
+        Slab *next; // next slab of the same class in the owning heap.
+        FreeBlock *free;
+        char *cursor; // next object never handed out.
+        char *end;
+        size_t cls;
+        std::atomic<FreeBlock *> remote;
+    };
+
+    struct Magazine {
+        size_t count;
+        void *items[magazine_size];
+    };
+
+    // only written by the thread owning the heap, read by `stats()`.
+    struct Counters {
+        std::atomic<size_t> slabs;
+        std::atomic<size_t> allocations;
+        std::atomic<size_t> frees;
+    };
+
+    struct Heap {
+        std::atomic<bool> active{ false };
+        Slab *slabs[class_count] = {};
+        Slab *current[class_count] = {};
+        Magazine magazines[class_count] = {};
+        Counters counters[class_count] = {};
+    };
+
+    // per thread list of the heaps it holds, one per live allocator.
+    struct ThreadHeaps {
+        struct Entry {
+            uint64_t id;
+            Heap *heap;
+        };
+        Entry last{ 0, nullptr };
+        std::vector<Entry> entries;
+
+        ~ThreadHeaps() {
+            for (auto &e : entries) {
+                abandon(e.id, e.heap);
+            }
+        }
+    };
+
+    uint64_t id_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Heap>> heaps_;
+    std::unordered_set<const void *> slab_set_;
+    std::vector<void *> regions_;
+    char *region_cursor_ = nullptr; // next slab of the newest region.
+    char *region_end_ = nullptr;
+    [[no_unique_address]] Provider provider_;
+    [[no_unique_address]] Stats stats_;
+
+  public:
+    explicit BasicSlabAllocator(Provider provider = Provider())
+        : id_(register_allocator())
+        , provider_(std::move(provider)) {}
+
+    BasicSlabAllocator(const BasicSlabAllocator &) = delete;
+    BasicSlabAllocator &operator=(const BasicSlabAllocator &) = delete;
+
+    ~BasicSlabAllocator() {
+        unregister_allocator(id_);
+        release();
+    }
+
+    Provider &provider() noexcept { return provider_; }
+
+    AllocatorStats statistics() const noexcept { return stats_.snapshot(); }
+
+    // size class that serves `layout`, or `npos` if it is too large or
+    // invalid.
+    static M_CEXPR size_t class_of(Layout layout) noexcept {
+        if (layout.align() == 0) {
+            return npos;
+        }
+        size_t size = std::max<size_t>(layout.pad_to_align().size(), 1);
+        if (size > max_size || layout.align() > max_size) {
+            return npos;
+        }
+        for (size_t i = class_lookup[(size + 15) / 16]; i < class_count;
+             ++i) {
+            if (size_classes[i] % layout.align() == 0) {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+    inline void *allocate(Layout layout) noexcept {
+        size_t cls = class_of(layout);
+        Heap *heap = cls == npos ? nullptr : local_heap();
+        if (heap == nullptr) {
+            stats_.on_failure(layout);
+            return nullptr;
+        }
+        Magazine &mag = heap->magazines[cls];
+        void *p = mag.count ? mag.items[--mag.count] : refill(heap, cls);
+        if (p) {
+            bump(heap->counters[cls].allocations, 1);
+            stats_.on_allocate(layout, size_classes[cls]);
+        } else {
+            stats_.on_failure(layout);
+        }
+        return p;
+    }
+
+    // the layout is not needed, the size class is recorded in the slab.
+    inline void deallocate(void *ptr, Layout = Layout()) noexcept {
+        if (ptr == nullptr) {
+            return;
+        }
+        Slab *slab = slab_of(ptr);
+        stats_.on_deallocate(size_classes[slab->cls]);
+        Heap *heap = find_local_heap();
+        if (slab->owner != heap) {
+            push_remote(slab, ptr);
+            return;
+        }
+        Magazine &mag = heap->magazines[slab->cls];
+        if (mag.count == magazine_size) {
+            flush(mag, magazine_size / 2);
+        }
+        mag.items[mag.count++] = ptr;
+        bump(heap->counters[slab->cls].frees, 1);
+    }
+
+    inline bool owns(const void *ptr) noexcept {
+        std::lock_guard lock(mutex_);
+        return slab_set_.count(slab_of(ptr)) != 0;
+    }
+
+    inline ClassStatsArray stats() noexcept {
+        ClassStatsArray stats{};
+        for (size_t i = 0; i < class_count; ++i) {
+            stats[i].size = size_classes[i];
+        }
+        std::lock_guard lock(mutex_);
+        for (auto &heap : heaps_) {
+            for (size_t i = 0; i < class_count; ++i) {
+                auto &c = heap->counters[i];
+                stats[i].slabs += c.slabs.load(std::memory_order_relaxed);
+                stats[i].allocations +=
+                    c.allocations.load(std::memory_order_relaxed);
+                stats[i].frees += c.frees.load(std::memory_order_relaxed);
+            }
+        }
+        return stats;
+    }
+
+    // drop every object and return all regions to the provider. Heaps stay
+    // attached to their threads.
+    inline void reset() noexcept {
+        std::lock_guard lock(mutex_);
+        stats_.on_reset();
+        for (auto &heap : heaps_) {
+            for (size_t i = 0; i < class_count; ++i) {
+                for (Slab *s = heap->slabs[i]; s;) {
+                    Slab *next = s->next;
+                    s->~Slab();
+                    s = next;
+                }
+                heap->slabs[i] = heap->current[i] = nullptr;
+                heap->magazines[i].count = 0;
+                heap->counters[i].slabs.store(0, std::memory_order_relaxed);
+                heap->counters[i].allocations.store(0,
+                                                    std::memory_order_relaxed);
+                heap->counters[i].frees.store(0, std::memory_order_relaxed);
+            }
+        }
+        slab_set_.clear();
+        for (void *region : regions_) {
+            provider_.deallocate_chunk(region, region_layout);
+        }
+        regions_.clear();
+        region_cursor_ = region_end_ = nullptr;
+    }
+
+    inline void release() noexcept { reset(); }
+
+  private:
+    static constexpr Layout region_layout =
+        Layout::from_size_align(region_size, slab_size).value();
+
+    // index of the first class that holds `16 * i` bytes.
+    static constexpr auto class_lookup = [] {
+        std::array<uint8_t, max_size / 16 + 1> table{};
+        size_t cls = 0;
+        for (size_t i = 0; i < table.size(); ++i) {
+            while (size_classes[cls] < i * 16) {
+                ++cls;
+            }
+            table[i] = static_cast<uint8_t>(cls);
+        }
+        return table;
+    }();
+
+    static inline void bump(std::atomic<size_t> &counter, size_t n) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + n,
+                      std::memory_order_relaxed);
+    }
+
+    static inline Slab *slab_of(const void *ptr) noexcept {
+        return reinterpret_cast<Slab *>(reinterpret_cast<uintptr_t>(ptr) &
+                                        ~(slab_size - 1));
+    }
+
+    // offset of the first object of class `cls` from the slab base. Objects
+    // start at an address aligned to the largest power of two dividing the
+    // class size, so every object keeps that alignment.
+    static M_CEXPR size_t objects_offset(size_t cls) noexcept {
+        size_t size = size_classes[cls];
+        auto object = Layout::from_size_align(size, size & (~size + 1));
+        return Layout::create<Slab>()
+            .value()
+            .extend(object.value())
+            .value()
+            .second;
+    }
+
+    static inline void push_remote(Slab *slab, void *ptr) noexcept {
+        auto block = static_cast<FreeBlock *>(ptr);
+        block->next = slab->remote.load(std::memory_order_relaxed);
+        while (!slab->remote.compare_exchange_weak(block->next, block,
+                                                   std::memory_order_release,
+                                                   std::memory_order_relaxed))
+            ;
+    }
+
+    // move objects freed by other threads into the local free list.
+    static inline void collect_remote(Slab *slab) noexcept {
+        FreeBlock *list =
+            slab->remote.exchange(nullptr, std::memory_order_acquire);
+        size_t n = 0;
+        while (list) {
+            FreeBlock *next = list->next;
+            list->next = slab->free;
+            slab->free = list;
+            list = next;
+            ++n;
+        }
+        if (n) {
+            bump(slab->owner->counters[slab->cls].frees, n);
+        }
+    }
+
+    // give `n` objects of a full magazine back to their slabs.
+    static inline void flush(Magazine &mag, size_t n) noexcept {
+        while (n--) {
+            auto block = static_cast<FreeBlock *>(mag.items[--mag.count]);
+            Slab *slab = slab_of(block);
+            block->next = slab->free;
+            slab->free = block;
+        }
+    }
+
+    // move up to `refill_count` objects from `slab` into `mag`. Returns
+    // false if the slab had nothing to give.
+    static inline bool fill(Slab *slab, Magazine &mag) noexcept {
+        if (slab->free == nullptr) {
+            collect_remote(slab);
+        }
+        if (slab->free == nullptr && slab->cursor == slab->end) {
+            return false;
+        }
+        while (mag.count < refill_count && slab->free) {
+            mag.items[mag.count++] =
+                std::exchange(slab->free, slab->free->next);
+        }
+        size_t stride = size_classes[slab->cls];
+        while (mag.count < refill_count && slab->cursor != slab->end) {
+            mag.items[mag.count++] = slab->cursor;
+            slab->cursor += stride;
+        }
+        return true;
+    }
+
+    void *refill(Heap *heap, size_t cls) noexcept {
+        Magazine &mag = heap->magazines[cls];
+        Slab *slab = heap->current[cls];
+        while (mag.count < refill_count) {
+            if (slab == nullptr || !fill(slab, mag)) {
+                if ((slab = next_slab(heap, cls)) == nullptr) {
+                    break;
+                }
+                heap->current[cls] = slab;
+            }
+        }
+        return mag.count ? mag.items[--mag.count] : nullptr;
+    }
+
+    // a slab of the heap with objects to give, or a fresh one.
+    Slab *next_slab(Heap *heap, size_t cls) noexcept {
+        for (Slab *s = heap->slabs[cls]; s; s = s->next) {
+            if (s != heap->current[cls] &&
+                (s->free || s->cursor != s->end ||
+                 s->remote.load(std::memory_order_relaxed))) {
+                return s;
+            }
+        }
+
+        void *mem = carve_slab();
+        if (mem == nullptr) {
+            return nullptr;
+        }
+        auto slab = new (mem) Slab{};
+        size_t stride = size_classes[cls];
+        size_t offset = objects_offset(cls);
+        slab->owner = heap;
+        slab->cls = cls;
+        slab->cursor = static_cast<char *>(mem) + offset;
+        slab->end = slab->cursor + (slab_size - offset) / stride * stride;
+        slab->next = heap->slabs[cls];
+        heap->slabs[cls] = slab;
+        bump(heap->counters[cls].slabs, 1);
+        return slab;
+    }
+
+    // next unused slab, taking a new region from the provider if needed.
+    void *carve_slab() noexcept {
+        std::lock_guard lock(mutex_);
+        if (region_cursor_ == region_end_) {
+            void *region = provider_.allocate_chunk(region_layout);
+            if (region == nullptr) {
+                return nullptr;
+            }
+            try {
+                regions_.push_back(region);
+            } catch (...) {
+                provider_.deallocate_chunk(region, region_layout);
+                return nullptr;
+            }
+            region_cursor_ = static_cast<char *>(region);
+            region_end_ = region_cursor_ + region_size;
+        }
+        void *slab = std::exchange(region_cursor_, region_cursor_ + slab_size);
+        try {
+            slab_set_.insert(slab);
+        } catch (...) {
+            region_cursor_ -= slab_size;
+            return nullptr;
+        }
+        return slab;
+    }
+
+    //
+    // Thread to heap mapping.
+    //
+
+    static inline ThreadHeaps &thread_heaps() noexcept {
+        static thread_local ThreadHeaps heaps;
+        return heaps;
+    }
+
+    // ids of live allocators. A thread exiting after its allocator is gone
+    // must not touch the heap.
+    struct Registry {
+        std::mutex mutex;
+        std::unordered_set<uint64_t> live;
+        uint64_t next_id = 1;
+    };
+
+    static inline Registry &registry() noexcept {
+        static Registry registry;
+        return registry;
+    }
+
+    static inline uint64_t register_allocator() {
+        auto &r = registry();
+        std::lock_guard lock(r.mutex);
+        r.live.insert(r.next_id);
+        return r.next_id++;
+    }
+
+    static inline void unregister_allocator(uint64_t id) noexcept {
+        auto &r = registry();
+        std::lock_guard lock(r.mutex);
+        r.live.erase(id);
+    }
+
+    static inline void abandon(uint64_t id, Heap *heap) noexcept {
+        auto &r = registry();
+        std::lock_guard lock(r.mutex);
+        if (r.live.count(id)) {
+            heap->active.store(false, std::memory_order_release);
+        }
+    }
+
+    // heap of the calling thread, nullptr if it doesn't have one yet.
+    inline Heap *find_local_heap() noexcept {
+        auto &tls = thread_heaps();
+        if (tls.last.id == id_) {
+            return tls.last.heap;
+        }
+        for (auto &e : tls.entries) {
+            if (e.id == id_) {
+                tls.last = e;
+                return e.heap;
+            }
+        }
+        return nullptr;
+    }
+
+    inline Heap *local_heap() noexcept {
+        if (Heap *heap = find_local_heap()) {
+            return heap;
+        }
+        return attach_heap();
+    }
+
+    // adopt an abandoned heap, or create one.
+    Heap *attach_heap() noexcept {
+        Heap *heap = nullptr;
+        try {
+            std::lock_guard lock(mutex_);
+            for (auto &h : heaps_) {
+                bool expected = false;
+                if (h->active.compare_exchange_strong(
+                        expected, true, std::memory_order_acquire)) {
+                    heap = h.get();
+                    break;
+                }
+            }
+            if (heap == nullptr) {
+                heaps_.push_back(std::make_unique<Heap>());
+                heap = heaps_.back().get();
+                heap->active.store(true, std::memory_order_relaxed);
+            }
+
+            auto &tls = thread_heaps();
+            {
+                // forget heaps of allocators that are gone.
+                auto &r = registry();
+                std::lock_guard registry_lock(r.mutex);
+                std::erase_if(tls.entries, [&](auto &e) {
+                    return r.live.count(e.id) == 0;
+                });
+            }
+            tls.entries.push_back({ id_, heap });
+            tls.last = tls.entries.back();
+        } catch (...) {
+            if (heap) {
+                heap->active.store(false, std::memory_order_release);
+            }
+            return nullptr;
+        }
+        return heap;
+    }
 };
 
+using SlabAllocator = BasicSlabAllocator<>;
+
+} // namespace alloy
+
 #endif
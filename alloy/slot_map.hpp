@@ -0,0 +1,304 @@
+#ifndef _ALLOY_SLOT_MAP_HPP
+#define _ALLOY_SLOT_MAP_HPP
+#pragma once
+
+#include "memlayout.hpp"
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace alloy {
+
+//
+// Generational handle table.
+//
+// `slot_map<T>` keeps its values packed in one array laid out with
+// `Layout::repeat`, and hands out handles instead of pointers. A handle is
+// a slot index and the generation of the slot when the value was inserted:
+// a lookup is one bounds check, a generation compare and an index into the
+// dense array. Erasing moves the last value into the hole, so iteration
+// walks live values only, in one linear pass.
+//
+// Slot generations are odd while the slot is live and are bumped on insert
+// and on erase, so a handle to an erased value never matches again. A slot
+// whose generation would wrap is retired instead of reused. With `Index =
+// uint32_t` handles are 64 bits, with `uint16_t` 32 bits.
+//
+//     slot_map<Session> sessions;
+//     auto h = sessions.insert(Session{ ... });
+//     if (Session *s = sessions.get(h)) { ... }
+//     sessions.erase(h);
+//
+
+template <typename T, std::unsigned_integral Index = uint32_t>
+class slot_map {
+    static_assert(std::is_nothrow_move_constructible_v<T>,
+                  "slot_map requires nothrow movable values");
+
+  public:
+    struct handle {
+        Index index = 0;
+        Index generation = 0; // 0 is never live: a default handle is null.
+
+        friend M_CEXPR bool operator==(const handle &,
+                                       const handle &) noexcept = default;
+    };
+
+    using value_type = T;
+    using iterator = T *;
+    using const_iterator = const T *;
+
+    static constexpr size_t max_size = std::numeric_limits<Index>::max();
+
+  private:
+    static constexpr Index npos = std::numeric_limits<Index>::max();
+
+    struct Slot {
+        Index target;     // dense index when live, next free slot when free.
+        Index generation; // odd when live.
+    };
+
+    T *values_;
+    size_t size_;
+    size_t capacity_;
+    std::vector<Slot> slots_;
+    std::vector<Index> owners_; // slot of each dense value.
+    Index free_;                // first free slot, `npos` if none.
+
+  public:
+    slot_map() noexcept
+        : values_(nullptr)
+        , size_(0)
+        , capacity_(0)
+        , free_(npos) {}
+
+    explicit slot_map(size_t capacity)
+        : slot_map() {
+        reserve(capacity);
+    }
+
+    slot_map(const slot_map &) = delete;
+
+    slot_map(slot_map &&other) noexcept
+        : slot_map() {
+        swap(other);
+    }
+
+    slot_map &operator=(slot_map other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~slot_map() {
+        clear();
+        deallocate();
+    }
+
+    void swap(slot_map &other) noexcept {
+        std::swap(values_, other.values_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(slots_, other.slots_);
+        std::swap(owners_, other.owners_);
+        std::swap(free_, other.free_);
+    }
+
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    size_t capacity() const noexcept { return capacity_; }
+
+    void reserve(size_t capacity) {
+        if (capacity > capacity_) {
+            reallocate(capacity);
+        }
+        slots_.reserve(capacity);
+        owners_.reserve(capacity);
+    }
+
+    // the value is built before the old ones are moved, so `args` may refer
+    // to values of the map.
+    template <typename... Args> handle emplace(Args &&...args) {
+        T *values = values_;
+        size_t capacity = capacity_;
+        if (size_ == capacity_) {
+            capacity = grown_capacity();
+            values = allocate_values(capacity);
+        }
+        Index slot = free_;
+        try {
+            if (slot == npos) {
+                if (slots_.size() >= max_size) {
+                    throw std::length_error("slot_map is full");
+                }
+                slots_.push_back({ npos, 0 });
+                slot = static_cast<Index>(slots_.size() - 1);
+            }
+            owners_.push_back(slot);
+            try {
+                ::new (values + size_) T(std::forward<Args>(args)...);
+            } catch (...) {
+                owners_.pop_back();
+                throw;
+            }
+        } catch (...) {
+            if (slot != free_) {
+                slots_.pop_back();
+            }
+            if (values != values_) {
+                deallocate_values(values);
+            }
+            throw;
+        }
+        if (values != values_) {
+            relocate(values, capacity);
+        }
+        Slot &s = slots_[slot];
+        if (slot == free_) {
+            free_ = s.target;
+        }
+        s.target = static_cast<Index>(size_++);
+        ++s.generation;
+        return { slot, s.generation };
+    }
+
+    handle insert(const T &value) { return emplace(value); }
+    handle insert(T &&value) { return emplace(std::move(value)); }
+
+    bool contains(handle h) const noexcept {
+        return h.index < slots_.size() &&
+               slots_[h.index].generation == h.generation &&
+               (h.generation & 1);
+    }
+
+    // the value of `h`, nullptr if it was erased.
+    T *get(handle h) noexcept {
+        return contains(h) ? values_ + slots_[h.index].target : nullptr;
+    }
+    const T *get(handle h) const noexcept {
+        return contains(h) ? values_ + slots_[h.index].target : nullptr;
+    }
+
+    // `h` must be live.
+    T &operator[](handle h) noexcept { return values_[slots_[h.index].target]; }
+    const T &operator[](handle h) const noexcept {
+        return values_[slots_[h.index].target];
+    }
+
+    bool erase(handle h) noexcept {
+        if (!contains(h)) {
+            return false;
+        }
+        Slot &s = slots_[h.index];
+        Index hole = s.target;
+        Index last = static_cast<Index>(size_ - 1);
+        if (hole != last) {
+            std::destroy_at(values_ + hole);
+            ::new (values_ + hole) T(std::move(values_[last]));
+            owners_[hole] = owners_[last];
+            slots_[owners_[hole]].target = hole;
+        }
+        std::destroy_at(values_ + last);
+        owners_.pop_back();
+        --size_;
+        release(h.index);
+        return true;
+    }
+
+    void clear() noexcept {
+        for (size_t i = 0; i < size_; ++i) {
+            std::destroy_at(values_ + i);
+            release(owners_[i]);
+        }
+        owners_.clear();
+        size_ = 0;
+    }
+
+    // handle of the value at dense position `i`.
+    handle handle_of(size_t i) const noexcept {
+        Index slot = owners_[i];
+        return { slot, slots_[slot].generation };
+    }
+
+    // the live values, densely packed.
+    T *data() noexcept { return values_; }
+    const T *data() const noexcept { return values_; }
+
+    iterator begin() noexcept { return values_; }
+    iterator end() noexcept { return values_ + size_; }
+    const_iterator begin() const noexcept { return values_; }
+    const_iterator end() const noexcept { return values_ + size_; }
+
+  private:
+    // mark `slot` free and put it on the free list, unless its generation
+    // is exhausted.
+    void release(Index slot) noexcept {
+        Slot &s = slots_[slot];
+        ++s.generation;
+        if (s.generation == npos - 1) {
+            s.target = npos; // retired.
+            return;
+        }
+        s.target = free_;
+        free_ = slot;
+    }
+
+    size_t grown_capacity() const {
+        size_t capacity =
+            std::min(std::max<size_t>(8, 2 * capacity_), max_size);
+        if (capacity <= size_) {
+            throw std::length_error("slot_map is full");
+        }
+        return capacity;
+    }
+
+    static T *allocate_values(size_t capacity) {
+        auto layout = Layout::of<T>().repeat(capacity);
+        if (!layout) {
+            throw std::length_error("slot_map is full");
+        }
+        Layout array = layout.value().first;
+        return static_cast<T *>(
+            ::operator new(array.size(), std::align_val_t(array.align())));
+    }
+
+    static void deallocate_values(T *values) noexcept {
+        ::operator delete(values, std::align_val_t(alignof(T)));
+    }
+
+    // move the values to `values`, which has room for `capacity` of them.
+    void relocate(T *values, size_t capacity) noexcept {
+        for (size_t i = 0; i < size_; ++i) {
+            ::new (values + i) T(std::move(values_[i]));
+            std::destroy_at(values_ + i);
+        }
+        deallocate();
+        values_ = values;
+        capacity_ = capacity;
+    }
+
+    void reallocate(size_t capacity) {
+        capacity = std::min(capacity, max_size);
+        if (capacity <= size_) {
+            throw std::length_error("slot_map is full");
+        }
+        relocate(allocate_values(capacity), capacity);
+    }
+
+    void deallocate() noexcept {
+        if (values_) {
+            deallocate_values(values_);
+            values_ = nullptr;
+        }
+    }
+};
+
+} // namespace alloy
+
+#endif
@@ -0,0 +1,397 @@
+#ifndef _ALLOY_SOA_VECTOR_HPP
+#define _ALLOY_SOA_VECTOR_HPP
+#pragma once
+
+#include "memlayout.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace alloy {
+
+//
+// Struct of arrays vector.
+// `soa_vector<Ts...>` stores a sequence of records with fields `Ts...`, one
+// contiguous column per field. All columns live in a single allocation laid
+// out by extending `Layout::repeat` of each field; every column starts on a
+// `column_align` boundary so kernels scanning a column get aligned, dense
+// data.
+//
+// Rows are accessed through `reference`, a tuple of references into the
+// columns; columns are accessed as spans.
+//
+
+template <typename... Ts> class soa_vector {
+    static_assert(sizeof...(Ts) > 0, "soa_vector needs at least one field");
+
+    static constexpr size_t n_columns = sizeof...(Ts);
+
+  public:
+    static constexpr size_t column_align = 64;
+    static constexpr size_t block_align = std::max({ column_align,
+                                                     alignof(Ts)... });
+
+    using value_type = std::tuple<Ts...>;
+    using reference = std::tuple<Ts &...>;
+    using const_reference = std::tuple<const Ts &...>;
+    using size_type = size_t;
+
+    template <size_t I>
+    using column_type = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+    // layout of the block holding `capacity` rows, and where each column
+    // starts in it.
+    struct BlockLayout {
+        Layout layout;
+        std::array<size_t, n_columns> offsets;
+    };
+
+    static M_CEXPR std::optional<BlockLayout>
+    block_layout(size_t capacity) noexcept {
+        BlockLayout block{};
+        auto acc = Layout::from_size_align(0, column_align).value();
+        size_t i = 0;
+        bool ok = true;
+        auto add = [&](std::optional<Layout> field) {
+            if (!ok || !field) {
+                ok = false;
+                return;
+            }
+            auto column = field->repeat(capacity);
+            if (!column) {
+                ok = false;
+                return;
+            }
+            auto aligned = column->first.align_to(column_align);
+            if (auto next = aligned ? acc.extend(aligned.value())
+                                    : std::nullopt) {
+                block.offsets[i++] = next->second;
+                acc = next->first;
+            } else {
+                ok = false;
+            }
+        };
+        (add(Layout::create<Ts>()), ...);
+        if (!ok) {
+            return {};
+        }
+        block.layout = acc.pad_to_align();
+        return block;
+    }
+
+  private:
+    std::byte *data_;
+    std::array<std::byte *, n_columns> columns_;
+    size_t size_;
+    size_t capacity_;
+
+  public:
+    soa_vector() noexcept
+        : data_(nullptr)
+        , columns_{}
+        , size_(0)
+        , capacity_(0) {}
+
+    explicit soa_vector(size_t capacity)
+        : soa_vector() {
+        reserve(capacity);
+    }
+
+    soa_vector(const soa_vector &other)
+        : soa_vector() {
+        reserve(other.size_);
+        copy_columns(other, std::index_sequence_for<Ts...>{});
+        size_ = other.size_;
+    }
+
+    soa_vector(soa_vector &&other) noexcept
+        : data_(std::exchange(other.data_, nullptr))
+        , columns_(std::exchange(other.columns_, {}))
+        , size_(std::exchange(other.size_, 0))
+        , capacity_(std::exchange(other.capacity_, 0)) {}
+
+    soa_vector &operator=(soa_vector other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~soa_vector() {
+        clear();
+        deallocate();
+    }
+
+    void swap(soa_vector &other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(columns_, other.columns_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+    }
+
+    size_t size() const noexcept { return size_; }
+    size_t capacity() const noexcept { return capacity_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    // column `I` as a contiguous span.
+    template <size_t I> std::span<column_type<I>> column() noexcept {
+        return { column_data<I>(), size_ };
+    }
+
+    template <size_t I>
+    std::span<const column_type<I>> column() const noexcept {
+        return { column_data<I>(), size_ };
+    }
+
+    reference operator[](size_t i) noexcept {
+        return row(i, std::index_sequence_for<Ts...>{});
+    }
+
+    const_reference operator[](size_t i) const noexcept {
+        return row(i, std::index_sequence_for<Ts...>{});
+    }
+
+    void reserve(size_t capacity) {
+        if (capacity > capacity_) {
+            reallocate(capacity);
+        }
+    }
+
+    // the row is built before the old rows are moved on growth, so
+    // `values` may refer to fields of the vector.
+    template <typename... Us>
+        requires(sizeof...(Us) == n_columns)
+    reference emplace_back(Us &&...values) {
+        if (size_ < capacity_) {
+            construct_row(columns_, size_, std::index_sequence_for<Ts...>{},
+                          std::forward<Us>(values)...);
+            return (*this)[size_++];
+        }
+        size_t capacity = std::max<size_t>(8, capacity_ * 2);
+        auto [data, block] = allocate_block(capacity);
+        auto columns = columns_of(data, block);
+        try {
+            construct_row(columns, size_, std::index_sequence_for<Ts...>{},
+                          std::forward<Us>(values)...);
+        } catch (...) {
+            ::operator delete(data, std::align_val_t(block_align));
+            throw;
+        }
+        relocate(data, block, capacity);
+        return (*this)[size_++];
+    }
+
+    void push_back(const value_type &value) {
+        std::apply([&](auto &...v) { emplace_back(v...); }, value);
+    }
+
+    void pop_back() noexcept {
+        --size_;
+        destroy_row(size_, std::index_sequence_for<Ts...>{});
+    }
+
+    void clear() noexcept {
+        while (size_) {
+            pop_back();
+        }
+    }
+
+    //
+    // Row iteration.
+    //
+
+    template <bool Const> class basic_iterator {
+        using owner = std::conditional_t<Const, const soa_vector, soa_vector>;
+        owner *v_;
+        size_t i_;
+
+      public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = soa_vector::value_type;
+        using difference_type = ptrdiff_t;
+        using reference =
+            std::conditional_t<Const, const_reference, soa_vector::reference>;
+
+        basic_iterator() noexcept
+            : v_(nullptr)
+            , i_(0) {}
+        basic_iterator(owner *v, size_t i) noexcept
+            : v_(v)
+            , i_(i) {}
+
+        reference operator*() const noexcept { return (*v_)[i_]; }
+        reference operator[](difference_type n) const noexcept {
+            return (*v_)[i_ + n];
+        }
+        basic_iterator &operator++() noexcept {
+            ++i_;
+            return *this;
+        }
+        basic_iterator operator++(int) noexcept { return { v_, i_++ }; }
+        basic_iterator &operator--() noexcept {
+            --i_;
+            return *this;
+        }
+        basic_iterator operator--(int) noexcept { return { v_, i_-- }; }
+        basic_iterator &operator+=(difference_type n) noexcept {
+            i_ += n;
+            return *this;
+        }
+        basic_iterator &operator-=(difference_type n) noexcept {
+            i_ -= n;
+            return *this;
+        }
+        basic_iterator operator+(difference_type n) const noexcept {
+            return { v_, i_ + n };
+        }
+        basic_iterator operator-(difference_type n) const noexcept {
+            return { v_, i_ - n };
+        }
+        difference_type operator-(const basic_iterator &o) const noexcept {
+            return static_cast<difference_type>(i_) -
+                   static_cast<difference_type>(o.i_);
+        }
+        auto operator<=>(const basic_iterator &o) const noexcept {
+            return i_ <=> o.i_;
+        }
+        bool operator==(const basic_iterator &o) const noexcept {
+            return i_ == o.i_;
+        }
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    iterator begin() noexcept { return { this, 0 }; }
+    iterator end() noexcept { return { this, size_ }; }
+    const_iterator begin() const noexcept { return { this, 0 }; }
+    const_iterator end() const noexcept { return { this, size_ }; }
+
+  private:
+    using column_array = std::array<std::byte *, n_columns>;
+
+    template <size_t I>
+    static column_type<I> *column_at(const column_array &columns) noexcept {
+        return std::launder(reinterpret_cast<column_type<I> *>(columns[I]));
+    }
+
+    template <size_t I> column_type<I> *column_data() const noexcept {
+        return column_at<I>(columns_);
+    }
+
+    template <size_t... I>
+    reference row(size_t i, std::index_sequence<I...>) noexcept {
+        return { column_data<I>()[i]... };
+    }
+
+    template <size_t... I>
+    const_reference row(size_t i, std::index_sequence<I...>) const noexcept {
+        return { column_data<I>()[i]... };
+    }
+
+    // build row `i` in `columns`. If a field throws, the fields already
+    // built are destroyed.
+    template <size_t... I, typename... Us>
+    static void construct_row(const column_array &columns, size_t i,
+                              std::index_sequence<I...>, Us &&...values) {
+        size_t built = 0;
+        try {
+            ((::new (column_at<I>(columns) + i)
+                  column_type<I>(std::forward<Us>(values)),
+              ++built),
+             ...);
+        } catch (...) {
+            ((I < built ? std::destroy_at(column_at<I>(columns) + i)
+                        : void()),
+             ...);
+            throw;
+        }
+    }
+
+    template <size_t... I>
+    void destroy_row(size_t i, std::index_sequence<I...>) noexcept {
+        (std::destroy_at(column_data<I>() + i), ...);
+    }
+
+    // copy the rows of `other`, column by column. If a copy throws, the
+    // columns already copied are destroyed.
+    template <size_t... I>
+    void copy_columns(const soa_vector &other, std::index_sequence<I...>) {
+        size_t copied = 0;
+        try {
+            ((std::uninitialized_copy_n(other.template column_data<I>(),
+                                        other.size_, column_data<I>()),
+              ++copied),
+             ...);
+        } catch (...) {
+            ((I < copied ? (void)std::destroy_n(column_data<I>(), other.size_)
+                         : void()),
+             ...);
+            throw;
+        }
+    }
+
+    template <size_t... I>
+    void move_columns(std::byte *data, const BlockLayout &block,
+                      std::index_sequence<I...>) noexcept {
+        ((std::uninitialized_move_n(
+              column_data<I>(), size_,
+              reinterpret_cast<column_type<I> *>(data + block.offsets[I])),
+          std::destroy_n(column_data<I>(), size_)),
+         ...);
+    }
+
+    static std::pair<std::byte *, BlockLayout>
+    allocate_block(size_t capacity) {
+        auto block = block_layout(capacity);
+        if (!block) {
+            throw std::bad_alloc();
+        }
+        auto data = static_cast<std::byte *>(
+            ::operator new(block->layout.size(),
+                           std::align_val_t(block->layout.align())));
+        return { data, block.value() };
+    }
+
+    static column_array columns_of(std::byte *data,
+                                   const BlockLayout &block) noexcept {
+        column_array columns;
+        for (size_t i = 0; i < n_columns; ++i) {
+            columns[i] = data + block.offsets[i];
+        }
+        return columns;
+    }
+
+    // move the rows to `data`, laid out as `block` for `capacity` rows.
+    void relocate(std::byte *data, const BlockLayout &block,
+                  size_t capacity) noexcept {
+        static_assert((std::is_nothrow_move_constructible_v<Ts> && ...),
+                      "soa_vector requires nothrow movable fields");
+        move_columns(data, block, std::index_sequence_for<Ts...>{});
+        deallocate();
+        data_ = data;
+        columns_ = columns_of(data, block);
+        capacity_ = capacity;
+    }
+
+    void reallocate(size_t capacity) {
+        auto [data, block] = allocate_block(capacity);
+        relocate(data, block, capacity);
+    }
+
+    void deallocate() noexcept {
+        if (data_) {
+            ::operator delete(data_, std::align_val_t(block_align));
+            data_ = nullptr;
+        }
+    }
+};
+
+} // namespace alloy
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef _ALLOY_STATIC_LAYOUT_HPP
+#define _ALLOY_STATIC_LAYOUT_HPP
+#pragma once
+
+#include "composite_allocator.hpp"
+#include "memlayout.hpp"
+#include "struct_layout.hpp"
+#include <array>
+#include <cstddef>
+#include <tuple>
+
+namespace alloy {
+
+//
+// Record layouts checked at compile time.
+// `static_layout<Ts...>` lays out fields `Ts...` in declaration order, with
+// the rules of `layout_of_fields`, and exposes the result as constants: the
+// size, alignment and every offset can be template arguments, and a record
+// that can't be laid out doesn't compile.
+//
+//     using Node = static_layout<uint32_t, double, char[3]>;
+//     static_assert(Node::offset<1> == 8 && Node::size == 24);
+//     double *d = Node::field<1>(base);
+//
+// `allocate_for<Node>(a)` allocates one record through the compile time
+// route of `a` (`a.allocate<Size, Align>()`, see composite_allocator.hpp), so
+// requests known at compile time reach the allocator that serves them with
+// no size or alignment check on the way.
+//
+
+namespace details {
+
+template <typename... Ts>
+consteval StructLayout<sizeof...(Ts)> checked_layout_of_fields() {
+    constexpr auto fields = layout_of_fields<Ts...>();
+    static_assert(fields.has_value(), "record layout overflows");
+    return fields.value();
+}
+
+} // namespace details
+
+template <typename... Ts> struct static_layout {
+  private:
+    static constexpr StructLayout<sizeof...(Ts)> fields_ =
+        details::checked_layout_of_fields<Ts...>();
+
+    static consteval std::array<size_t, sizeof...(Ts)> offsets_of() {
+        std::array<size_t, sizeof...(Ts)> offsets{};
+        for (size_t i = 0; i < sizeof...(Ts); ++i) {
+            offsets[i] = fields_.fields[i].offset;
+        }
+        return offsets;
+    }
+
+  public:
+    static constexpr size_t count = sizeof...(Ts);
+    static constexpr size_t size = fields_.layout.size();
+    static constexpr size_t align = fields_.layout.align();
+    static constexpr size_t padding = fields_.padding();
+    static constexpr std::array<size_t, count> offsets = offsets_of();
+    static constexpr Layout layout = Layout::fixed<size, align>();
+
+    template <size_t I> static constexpr size_t offset = offsets[I];
+
+    template <size_t I> using type = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+    // field `I` of the record at `base`.
+    template <size_t I> static type<I> *field(void *base) noexcept {
+        return reinterpret_cast<type<I> *>(static_cast<char *>(base) +
+                                           offset<I>);
+    }
+
+    template <size_t I>
+    static const type<I> *field(const void *base) noexcept {
+        return reinterpret_cast<const type<I> *>(
+            static_cast<const char *>(base) + offset<I>);
+    }
+
+    static M_CEXPR const StructLayout<count> &describe() noexcept {
+        return fields_;
+    }
+};
+
+// storage for one `L` record from `a`.
+template <typename L, typename A> inline void *allocate_for(A &a) noexcept {
+    return details::allocate_static<L::size, L::align>(a);
+}
+
+template <typename L, typename A>
+inline void deallocate_for(A &a, void *ptr) noexcept {
+    details::deallocate_static<L::size, L::align>(a, ptr);
+}
+
+} // namespace alloy
+
+#endif
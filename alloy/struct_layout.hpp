@@ -0,0 +1,246 @@
+#ifndef _ALLOY_STRUCT_LAYOUT_HPP
+#define _ALLOY_STRUCT_LAYOUT_HPP
+#pragma once
+
+#include "memlayout.hpp"
+#include <array>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace alloy {
+
+//
+// Field level layout description.
+// `layout_of_fields<Ts...>()` folds `Layout::extend` over a list of field
+// types, recording where each field lands and how much padding precedes it.
+// `layout_of_struct<T>()` does the same for the fields of an aggregate,
+// which are discovered at compile time.
+//
+// Both are constexpr, so padding and false sharing can be checked with a
+// static_assert:
+//
+//     static_assert(padding_of<A>() == 0, "A has padding holes");
+//     static_assert(!layout_of_struct<Queue>()->first_shared_cache_line());
+//
+
+struct FieldInfo {
+    size_t offset;
+    size_t size;
+    size_t align;
+    size_t padding; // padding bytes right before this field.
+};
+
+// whether two fields of a record placed at a `line` aligned address touch a
+// common cache line.
+M_CEXPR bool fields_share_line(const FieldInfo &a, const FieldInfo &b,
+                               size_t line = cache_line_size) noexcept {
+    if (a.size == 0 || b.size == 0) {
+        return false;
+    }
+    size_t a_first = a.offset / line;
+    size_t a_last = (a.offset + a.size - 1) / line;
+    size_t b_first = b.offset / line;
+    size_t b_last = (b.offset + b.size - 1) / line;
+    return a_first <= b_last && b_first <= a_last;
+}
+
+template <size_t N> struct StructLayout {
+    std::array<FieldInfo, N> fields;
+    Layout layout;       // layout of the whole record, padded to its align.
+    size_t tail_padding; // padding after the last field.
+
+    M_CEXPR size_t padding() const noexcept {
+        size_t n = tail_padding;
+        for (auto &f : fields) {
+            n += f.padding;
+        }
+        return n;
+    }
+
+    // whether fields `i` and `j` touch a common cache line, for a record
+    // placed at a `line` aligned address.
+    M_CEXPR bool shares_cache_line(size_t i, size_t j,
+                                   size_t line = cache_line_size) const
+        noexcept {
+        return i != j && fields_share_line(fields[i], fields[j], line);
+    }
+
+    // first pair of fields sharing a cache line, nothing if every field is
+    // on lines of its own.
+    M_CEXPR std::optional<std::pair<size_t, size_t>>
+    first_shared_cache_line(size_t line = cache_line_size) const noexcept {
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = i + 1; j < N; ++j) {
+                if (shares_cache_line(i, j, line)) {
+                    return { { i, j } };
+                }
+            }
+        }
+        return {};
+    }
+
+    friend inline std::string to_string(const StructLayout &self) noexcept {
+        std::string s = "<StructLayout| size: " +
+                        std::to_string(self.layout.size()) +
+                        ", align: " + std::to_string(self.layout.align()) +
+                        ", padding: " + std::to_string(self.padding());
+        for (size_t i = 0; i < N; ++i) {
+            auto &f = self.fields[i];
+            if (f.padding) {
+                s += "\n  [padding " + std::to_string(f.padding) + "]";
+            }
+            s += "\n  field " + std::to_string(i) +
+                 ": offset: " + std::to_string(f.offset) +
+                 ", size: " + std::to_string(f.size) +
+                 ", align: " + std::to_string(f.align);
+        }
+        if (self.tail_padding) {
+            s += "\n  [padding " + std::to_string(self.tail_padding) + "]";
+        }
+        return s + ">";
+    }
+};
+
+// layout of a record whose fields are `Ts...` in declaration order.
+template <typename... Ts>
+M_CEXPR std::optional<StructLayout<sizeof...(Ts)>>
+layout_of_fields() noexcept {
+    StructLayout<sizeof...(Ts)> result{};
+    auto record = Layout::from_size_align(0, 1).value();
+    size_t i = 0;
+    bool ok = true;
+    auto add = [&](std::optional<Layout> field) {
+        if (!ok || !field) {
+            ok = false;
+            return;
+        }
+        if (auto next = record.extend(field.value())) {
+            auto [layout, offset] = next.value();
+            result.fields[i++] = { offset, field->size(), field->align(),
+                                   offset - record.size() };
+            record = layout;
+        } else {
+            ok = false;
+        }
+    };
+    (add(Layout::create<Ts>()), ...);
+    if (!ok) {
+        return {};
+    }
+    result.layout = record.pad_to_align();
+    result.tail_padding = result.layout.size() - record.size();
+    return result;
+}
+
+namespace details {
+
+// converts to anything, used to probe how many initializers an aggregate
+// takes.
+struct any_field {
+    template <typename U> operator U() const noexcept;
+};
+
+template <typename T, typename... Args> consteval size_t field_count() {
+    if constexpr (requires { T{ Args{}..., any_field{} }; }) {
+        return field_count<T, Args..., any_field>();
+    } else {
+        return sizeof...(Args);
+    }
+}
+
+template <typename... Ts> struct type_list {};
+
+auto field_types_of(auto &...fields) {
+    return type_list<std::remove_reference_t<decltype(fields)>...>{};
+}
+
+template <typename T> auto field_types(T &t) {
+    constexpr size_t n = field_count<T>();
+    static_assert(n > 0 && n <= 16,
+                  "layout_of_struct supports aggregates with 1 to 16 fields");
+    if constexpr (n == 1) {
+        auto &[f0] = t;
+        return field_types_of(f0);
+    } else if constexpr (n == 2) {
+        auto &[f0, f1] = t;
+        return field_types_of(f0, f1);
+    } else if constexpr (n == 3) {
+        auto &[f0, f1, f2] = t;
+        return field_types_of(f0, f1, f2);
+    } else if constexpr (n == 4) {
+        auto &[f0, f1, f2, f3] = t;
+        return field_types_of(f0, f1, f2, f3);
+    } else if constexpr (n == 5) {
+        auto &[f0, f1, f2, f3, f4] = t;
+        return field_types_of(f0, f1, f2, f3, f4);
+    } else if constexpr (n == 6) {
+        auto &[f0, f1, f2, f3, f4, f5] = t;
+        return field_types_of(f0, f1, f2, f3, f4, f5);
+    } else if constexpr (n == 7) {
+        auto &[f0, f1, f2, f3, f4, f5, f6] = t;
+        return field_types_of(f0, f1, f2, f3, f4, f5, f6);
+    } else if constexpr (n == 8) {
+        auto &[f0, f1, f2, f3, f4, f5, f6, f7] = t;
+        return field_types_of(f0, f1, f2, f3, f4, f5, f6, f7);
+    } else if constexpr (n == 9) {
+        auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8] = t;
+        return field_types_of(f0, f1, f2, f3, f4, f5, f6, f7, f8);
+    } else if constexpr (n == 10) {
+        auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9] = t;
+        return field_types_of(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9);
+    } else if constexpr (n == 11) {
+        auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10] = t;
+        return field_types_of(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10);
+    } else if constexpr (n == 12) {
+        auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11] = t;
+        return field_types_of(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10,
+                              f11);
+    } else if constexpr (n == 13) {
+        auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12] = t;
+        return field_types_of(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11,
+                              f12);
+    } else if constexpr (n == 14) {
+        auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13] = t;
+        return field_types_of(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11,
+                              f12, f13);
+    } else if constexpr (n == 15) {
+        auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13,
+               f14] = t;
+        return field_types_of(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11,
+                              f12, f13, f14);
+    } else if constexpr (n == 16) {
+        auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14,
+               f15] = t;
+        return field_types_of(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11,
+                              f12, f13, f14, f15);
+    }
+}
+
+template <typename T> struct struct_fields;
+template <typename... Ts> struct struct_fields<type_list<Ts...>> {
+    static M_CEXPR auto layout() noexcept {
+        return layout_of_fields<Ts...>();
+    }
+};
+
+} // namespace details
+
+// layout of the fields of aggregate `T`. Fields are discovered by
+// aggregate initialization, so `T` must not have base classes or C array
+// members (they're counted element by element).
+template <typename T> M_CEXPR auto layout_of_struct() noexcept {
+    static_assert(std::is_aggregate_v<T> && std::is_standard_layout_v<T>,
+                  "layout_of_struct requires a standard layout aggregate");
+    using fields = decltype(details::field_types(std::declval<T &>()));
+    return details::struct_fields<fields>::layout();
+}
+
+// total padding bytes of aggregate `T`.
+template <typename T> M_CEXPR size_t padding_of() noexcept {
+    return layout_of_struct<T>().value().padding();
+}
+
+} // namespace alloy
+
+#endif
@@ -0,0 +1,375 @@
+#ifndef _ALLOY_THREAD_CACHE_HPP
+#define _ALLOY_THREAD_CACHE_HPP
+#pragma once
+
+#include "allocator_stats.hpp"
+#include "memlayout.hpp"
+#include "treiber_stack.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace alloy {
+
+namespace details {
+
+// size classes a thread cache keeps for a central allocator: the class table
+// of an allocator that has one, otherwise the single block of a pool.
+template <typename A> struct cache_classes {
+    static constexpr size_t count = 1;
+
+    static M_CEXPR size_t of(Layout l) noexcept {
+        return l.size() <= A::layout.size() && l.align() <= A::layout.align()
+                   ? 0
+                   : std::numeric_limits<size_t>::max();
+    }
+
+    static M_CEXPR Layout layout(size_t) noexcept { return A::layout; }
+};
+
+template <typename A>
+    requires requires(Layout l) {
+        A::size_classes;
+        A::class_of(l);
+    }
+struct cache_classes<A> {
+    static constexpr size_t count = A::class_count;
+
+    static M_CEXPR size_t of(Layout l) noexcept { return A::class_of(l); }
+
+    // the central allocator maps a class' own size back to that class.
+    static M_CEXPR Layout layout(size_t cls) noexcept {
+        return Layout::from_size_align(A::size_classes[cls], 1).value();
+    }
+};
+
+} // namespace details
+
+//
+// Thread local caching front end over a central allocator.
+//
+// Every thread keeps a bounded stack of free blocks per size class, so the
+// common allocate/deallocate is a push or pop with no atomics and no lock.
+// When a stack runs empty it takes a batch of `batch_size` blocks from the
+// class' depot, a lock-free Treiber stack of batches; when it fills up it
+// hands its coldest `batch_size` blocks to the depot as one batch. Only when
+// the depot is empty does the cache go to the central allocator, under a
+// lock, for a fresh batch.
+//
+// Blocks freed by another thread than the one that allocated them flow
+// through the depot, which keeps producer/consumer pipelines from draining
+// the central allocator. Blocks are given back to the central allocator only
+// by `reset()`.
+//
+// The central allocator is either a pool with a single block `layout`
+// (`FixedSizeAllocator`) or has a size class table (`SlabAllocator`). A
+// block must be large enough to hold two pointers, the batch link.
+//
+
+template <typename Central, size_t BatchSize = 32,
+          StatsPolicy Stats = NoStats>
+class ThreadCache {
+    using classes = details::cache_classes<Central>;
+
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    // header of the first block of a batch.
+    struct Batch : TreiberStack::Node {
+        FreeBlock *rest; // the other `batch_size - 1` blocks.
+    };
+
+  public:
+    using allocator_type = ThreadCache<Central, BatchSize, Stats>;
+    using central_type = Central;
+    using stats_type = Stats;
+
+    // may be called from several threads at once.
+    static constexpr bool thread_safe = true;
+
+    static constexpr size_t batch_size = BatchSize;
+    static constexpr size_t cache_size = 2 * BatchSize;
+    static constexpr size_t class_count = classes::count;
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    static_assert(batch_size > 0, "batches hold at least one block");
+    static_assert(Stats::thread_safe, "the cache is shared between threads");
+    static_assert(
+        [] {
+            for (size_t i = 0; i < class_count; ++i) {
+                if (classes::layout(i).size() < sizeof(Batch)) {
+                    return false;
+                }
+            }
+            return true;
+        }(),
+        "blocks must hold two pointers");
+
+  private:
+    struct Bin {
+        size_t count;
+        void *items[cache_size];
+    };
+
+    struct Cache {
+        std::atomic<bool> active{ false };
+        Bin bins[class_count] = {};
+    };
+
+    // per thread list of the caches it holds, one per live front end.
+    struct ThreadCaches {
+        struct Entry {
+            uint64_t id;
+            Cache *cache;
+        };
+        Entry last{ 0, nullptr };
+        std::vector<Entry> entries;
+
+        ~ThreadCaches() {
+            for (auto &e : entries) {
+                abandon(e.id, e.cache);
+            }
+        }
+    };
+
+    Central central_;
+    uint64_t id_;
+    std::mutex mutex_; // guards `central_` and `caches_`.
+    std::vector<std::unique_ptr<Cache>> caches_;
+    std::array<TreiberStack, class_count> depots_;
+    [[no_unique_address]] Stats stats_;
+
+  public:
+    template <typename... Args>
+    explicit ThreadCache(Args &&...args)
+        : central_(std::forward<Args>(args)...)
+        , id_(register_cache()) {}
+
+    ThreadCache(const ThreadCache &) = delete;
+    ThreadCache &operator=(const ThreadCache &) = delete;
+
+    ~ThreadCache() { unregister_cache(id_); }
+
+    // the central allocator. Not synchronized, only use it while no other
+    // thread goes through the cache.
+    Central &central() noexcept { return central_; }
+
+    // statistics of the front end. Blocks held by the caches and depots
+    // count as free, the central allocator's own statistics count them as
+    // in use.
+    AllocatorStats statistics() const noexcept { return stats_.snapshot(); }
+
+    inline void *allocate(Layout layout) noexcept {
+        size_t cls = classes::of(layout);
+        Cache *cache = cls == npos ? nullptr : local_cache();
+        void *p = nullptr;
+        if (cache == nullptr) {
+            std::lock_guard lock(mutex_);
+            p = central_.allocate(layout);
+        } else {
+            Bin &bin = cache->bins[cls];
+            p = bin.count ? bin.items[--bin.count] : refill(bin, cls);
+        }
+        if constexpr (Stats::enabled) {
+            if (p) {
+                stats_.on_allocate(layout, cls == npos
+                                               ? layout.size()
+                                               : classes::layout(cls).size());
+            } else {
+                stats_.on_failure(layout);
+            }
+        }
+        return p;
+    }
+
+    // `layout` must be the one the block was allocated with, it picks the
+    // size class.
+    inline void deallocate(void *ptr, Layout layout) noexcept {
+        if (ptr == nullptr) {
+            return;
+        }
+        size_t cls = classes::of(layout);
+        stats_.on_deallocate(cls == npos ? layout.size()
+                                         : classes::layout(cls).size());
+        Cache *cache = cls == npos ? nullptr : local_cache();
+        if (cache == nullptr) {
+            std::lock_guard lock(mutex_);
+            central_.deallocate(ptr, cls == npos ? layout
+                                                 : classes::layout(cls));
+            return;
+        }
+        Bin &bin = cache->bins[cls];
+        if (bin.count == cache_size) {
+            flush(bin, cls);
+        }
+        bin.items[bin.count++] = ptr;
+    }
+
+    inline bool owns(const void *ptr) noexcept {
+        std::lock_guard lock(mutex_);
+        return central_.owns(ptr);
+    }
+
+    // drop every block in the caches and the depots and reset the central
+    // allocator. Must not race with other calls.
+    inline void reset() noexcept {
+        std::lock_guard lock(mutex_);
+        for (auto &cache : caches_) {
+            for (auto &bin : cache->bins) {
+                bin.count = 0;
+            }
+        }
+        for (auto &depot : depots_) {
+            depot.clear();
+        }
+        central_.reset();
+        stats_.on_reset();
+    }
+
+  private:
+    void *refill(Bin &bin, size_t cls) noexcept {
+        if (auto batch = static_cast<Batch *>(depots_[cls].pop())) {
+            for (FreeBlock *b = batch->rest; b; b = b->next) {
+                bin.items[bin.count++] = b;
+            }
+            return batch;
+        }
+        std::lock_guard lock(mutex_);
+        Layout layout = classes::layout(cls);
+        while (bin.count < batch_size) {
+            void *p = central_.allocate(layout);
+            if (p == nullptr) {
+                break;
+            }
+            bin.items[bin.count++] = p;
+        }
+        return bin.count ? bin.items[--bin.count] : nullptr;
+    }
+
+    // move the `batch_size` oldest blocks of a full bin to the depot.
+    void flush(Bin &bin, size_t cls) noexcept {
+        FreeBlock *rest = nullptr;
+        for (size_t i = 1; i < batch_size; ++i) {
+            auto b = static_cast<FreeBlock *>(bin.items[i]);
+            b->next = rest;
+            rest = b;
+        }
+        auto batch = new (bin.items[0]) Batch;
+        batch->rest = rest;
+        bin.count -= batch_size;
+        std::memmove(bin.items, bin.items + batch_size,
+                     bin.count * sizeof(void *));
+        depots_[cls].push(batch);
+    }
+
+    //
+    // Thread to cache mapping.
+    //
+
+    static inline ThreadCaches &thread_caches() noexcept {
+        static thread_local ThreadCaches caches;
+        return caches;
+    }
+
+    // ids of live front ends. A thread exiting after its front end is gone
+    // must not touch the cache.
+    struct Registry {
+        std::mutex mutex;
+        std::unordered_set<uint64_t> live;
+        uint64_t next_id = 1;
+    };
+
+    static inline Registry &registry() noexcept {
+        static Registry registry;
+        return registry;
+    }
+
+    static inline uint64_t register_cache() {
+        auto &r = registry();
+        std::lock_guard lock(r.mutex);
+        r.live.insert(r.next_id);
+        return r.next_id++;
+    }
+
+    static inline void unregister_cache(uint64_t id) noexcept {
+        auto &r = registry();
+        std::lock_guard lock(r.mutex);
+        r.live.erase(id);
+    }
+
+    // the blocks of an exiting thread stay in its cache until another thread
+    // adopts it.
+    static inline void abandon(uint64_t id, Cache *cache) noexcept {
+        auto &r = registry();
+        std::lock_guard lock(r.mutex);
+        if (r.live.count(id)) {
+            cache->active.store(false, std::memory_order_release);
+        }
+    }
+
+    inline Cache *local_cache() noexcept {
+        auto &tls = thread_caches();
+        if (tls.last.id == id_) {
+            return tls.last.cache;
+        }
+        for (auto &e : tls.entries) {
+            if (e.id == id_) {
+                tls.last = e;
+                return e.cache;
+            }
+        }
+        return attach_cache();
+    }
+
+    // adopt an abandoned cache, or create one.
+    Cache *attach_cache() noexcept {
+        Cache *cache = nullptr;
+        try {
+            std::lock_guard lock(mutex_);
+            for (auto &c : caches_) {
+                bool expected = false;
+                if (c->active.compare_exchange_strong(
+                        expected, true, std::memory_order_acquire)) {
+                    cache = c.get();
+                    break;
+                }
+            }
+            if (cache == nullptr) {
+                caches_.push_back(std::make_unique<Cache>());
+                cache = caches_.back().get();
+                cache->active.store(true, std::memory_order_relaxed);
+            }
+
+            auto &tls = thread_caches();
+            {
+                // forget caches of front ends that are gone.
+                auto &r = registry();
+                std::lock_guard registry_lock(r.mutex);
+                std::erase_if(tls.entries, [&](auto &e) {
+                    return r.live.count(e.id) == 0;
+                });
+            }
+            tls.entries.push_back({ id_, cache });
+            tls.last = tls.entries.back();
+        } catch (...) {
+            if (cache) {
+                cache->active.store(false, std::memory_order_release);
+            }
+            return nullptr;
+        }
+        return cache;
+    }
+};
+
+} // namespace alloy
+
+#endif
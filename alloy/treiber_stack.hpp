@@ -0,0 +1,89 @@
+#ifndef _ALLOY_TREIBER_STACK_HPP
+#define _ALLOY_TREIBER_STACK_HPP
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace alloy {
+
+//
+// Lock-free intrusive LIFO stack (Treiber stack).
+//
+// Nodes are caller owned and derive from `Node`; the stack only writes their
+// link. The top of the stack is a tagged pointer, the pointer in the low
+// `pointer_bits` bits and a counter bumped by every update in the high bits,
+// so a compare and swap fails when the top was popped and pushed again in
+// between (ABA).
+//
+// `pop` may read the link of a node another thread just popped, so node
+// memory must stay mapped while the stack is in use. Blocks recycled within
+// an allocator meet that, memory returned to the system does not.
+//
+
+class TreiberStack {
+  public:
+    struct Node {
+        std::atomic<Node *> next;
+    };
+
+    static_assert(sizeof(void *) == 8, "tagged pointers need 64-bit pointers");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    // user space addresses fit in 48 bits on x86-64 and aarch64.
+    static constexpr unsigned pointer_bits = 48;
+
+  private:
+    static constexpr uint64_t pointer_mask = (uint64_t(1) << pointer_bits) - 1;
+
+    std::atomic<uint64_t> top_{ 0 };
+
+    static inline Node *pointer(uint64_t top) noexcept {
+        return reinterpret_cast<Node *>(top & pointer_mask);
+    }
+
+    // `node` with the tag of `top` advanced by one.
+    static inline uint64_t retag(uint64_t top, Node *node) noexcept {
+        return ((top & ~pointer_mask) + (pointer_mask + 1)) |
+               reinterpret_cast<uint64_t>(node);
+    }
+
+  public:
+    TreiberStack() noexcept = default;
+    TreiberStack(const TreiberStack &) = delete;
+    TreiberStack &operator=(const TreiberStack &) = delete;
+
+    inline void push(Node *node) noexcept {
+        uint64_t top = top_.load(std::memory_order_relaxed);
+        do {
+            node->next.store(pointer(top), std::memory_order_relaxed);
+        } while (!top_.compare_exchange_weak(top, retag(top, node),
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+    }
+
+    // the most recently pushed node, or nullptr if the stack is empty.
+    inline Node *pop() noexcept {
+        uint64_t top = top_.load(std::memory_order_acquire);
+        while (Node *node = pointer(top)) {
+            Node *next = node->next.load(std::memory_order_relaxed);
+            if (top_.compare_exchange_weak(top, retag(top, next),
+                                           std::memory_order_acquire,
+                                           std::memory_order_acquire)) {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    inline bool empty() const noexcept {
+        return pointer(top_.load(std::memory_order_relaxed)) == nullptr;
+    }
+
+    // drop every node. Must not race with `push` or `pop`.
+    inline void clear() noexcept { top_.store(0, std::memory_order_relaxed); }
+};
+
+} // namespace alloy
+
+#endif
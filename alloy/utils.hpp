@@ -3,6 +3,7 @@
 #pragma once
 
 #include <any>
+#include <concepts>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
@@ -13,10 +14,28 @@
 #include <optional>
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <typeinfo>
 
 #define M_CEXPR inline constexpr
 
+// the compiler's overflow checking arithmetic (a single add or mul and a
+// branch on the carry / overflow flag). Defined to 0 to always use the
+// portable checks.
+#ifndef ALLOY_HAS_OVERFLOW_BUILTINS
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_add_overflow) && \
+    __has_builtin(__builtin_mul_overflow)
+#define ALLOY_HAS_OVERFLOW_BUILTINS 1
+#endif
+#elif defined(__GNUC__)
+#define ALLOY_HAS_OVERFLOW_BUILTINS 1
+#endif
+#endif
+#ifndef ALLOY_HAS_OVERFLOW_BUILTINS
+#define ALLOY_HAS_OVERFLOW_BUILTINS 0
+#endif
+
 namespace alloy::details {
 M_CEXPR static bool is_power_of_two(size_t n) noexcept {
     if (n == 0)
@@ -24,23 +43,48 @@ M_CEXPR static bool is_power_of_two(size_t n) noexcept {
     return (n & (n - 1)) == 0;
 }
 
+// round `n` up to a multiple of `align`, which must be a power of two.
+M_CEXPR static size_t align_up(size_t n, size_t align) noexcept {
+    return (n + align - 1) & ~(align - 1);
+}
+
 //
 // Bit twiddling
 //
 
-// TODO: verify
-template <typename T> T bit_set_range(T value, size_t offset, size_t n) {
-    constexpr auto cap = std::numeric_limits<T>::max();
-    constexpr size_t bits = sizeof(T) * 8;
-    T mask = cap >> (bits - n);
-    return value | (mask << offset);
+// `n` low bits set, for 0 <= n <= bits of T.
+template <std::unsigned_integral T> M_CEXPR T bit_mask(size_t n) noexcept {
+    constexpr size_t bits = std::numeric_limits<T>::digits;
+    constexpr T all = std::numeric_limits<T>::max();
+    // shifting by the full width is undefined, n == 0 is selected instead.
+    T mask = static_cast<T>(all >> ((bits - n) % bits));
+    return n == 0 ? T(0) : mask;
+}
+
+// set bits [offset, offset + n) of `value`. The range must fit in T.
+template <std::unsigned_integral T>
+M_CEXPR T bit_set_range(T value, size_t offset, size_t n) noexcept {
+    return static_cast<T>(value | (bit_mask<T>(n) << offset));
+}
+
+// clear bits [offset, offset + n) of `value`.
+template <std::unsigned_integral T>
+M_CEXPR T bit_clear_range(T value, size_t offset, size_t n) noexcept {
+    return static_cast<T>(value & ~(bit_mask<T>(n) << offset));
+}
+
+// bits [offset, offset + n) of `value`, shifted down.
+template <std::unsigned_integral T>
+M_CEXPR T bit_get_range(T value, size_t offset, size_t n) noexcept {
+    return static_cast<T>((value >> offset) & bit_mask<T>(n));
 }
 
-template <typename T> T bit_clear_range(T value, size_t offset, size_t n) {
-    constexpr size_t cap = std::numeric_limits<T>::max();
-    constexpr size_t bits = sizeof(T) * 8;
-    T mask = cap >> (bits - n);
-    return value & ~(mask << offset);
+// replace bits [offset, offset + n) of `value` by the low n bits of `bits`.
+template <std::unsigned_integral T>
+M_CEXPR T bit_insert_range(T value, size_t offset, size_t n,
+                           T bits) noexcept {
+    T mask = static_cast<T>(bit_mask<T>(n) << offset);
+    return static_cast<T>((value & ~mask) | ((bits << offset) & mask));
 }
 
 // get the size and the alignment of type T
@@ -53,8 +97,9 @@ constexpr std::pair<size_t, size_t> size_align() noexcept {
 // memory safe binary operation
 //
 
-// binary operation on (Z, n). This handles overflow.
-M_CEXPR decltype(auto) wrap_op(auto op, size_t n, auto x, auto y) noexcept {
+// binary operation on (Z, 2^bits). Unsigned arithmetic already wraps modulo
+// 2^bits, the wrapper only enforces the operand types.
+M_CEXPR decltype(auto) wrap_op(auto op, auto x, auto y) noexcept {
     static_assert(
         std::is_same_v<decltype(x), decltype(y)>,
         "wrapping arithmetics are required to perform on the same type");
@@ -62,21 +107,19 @@ M_CEXPR decltype(auto) wrap_op(auto op, size_t n, auto x, auto y) noexcept {
         std::is_unsigned_v<decltype(x)>,
         "wrapping arithmetics are required to perform on the same type");
 
-    return op(x, y) % n;
+    return static_cast<decltype(x)>(op(x, y));
 }
 
 M_CEXPR decltype(auto) wrap_add(auto x, auto y) noexcept {
-    size_t n = sizeof(decltype(x));
-    return wrap_op([](auto x, auto y) { return x + y; }, n, x, y);
+    return wrap_op([](auto x, auto y) { return x + y; }, x, y);
 }
 
-M_CEXPR decltype(auto) wrap_sub(auto x, auto y) {
-    size_t n = sizeof(decltype(y));
-    return wrap_op([](auto x, auto y) { return x - y; }, n, x, y);
+M_CEXPR decltype(auto) wrap_sub(auto x, auto y) noexcept {
+    return wrap_op([](auto x, auto y) { return x - y; }, x, y);
 }
 
 // Perform binop and detect overflow or underflow. if either happends, return
-// nothing.
+// nothing. `check(result, x, y)` returns true when the result overflowed.
 M_CEXPR decltype(auto) checked_op(auto op, auto check, auto x,
                                   auto y) noexcept {
     static_assert(
@@ -85,37 +128,47 @@ M_CEXPR decltype(auto) checked_op(auto op, auto check, auto x,
     static_assert(std::is_unsigned_v<decltype(x)>,
                   "signed overflow is undefined.");
 
-    constexpr auto cap = std::numeric_limits<decltype(x)>::max();
-    constexpr auto bot = std::numeric_limits<decltype(x)>::min();
-    auto raw_result = op(x, y);
+    auto raw_result = static_cast<decltype(x)>(op(x, y));
     if (check(raw_result, x, y)) {
         return std::optional<decltype(x)>();
     }
     return std::optional<decltype(x)>{ raw_result };
 }
 
-// #define SET_RANGE_TO_1(from, to) ()
-
-M_CEXPR decltype(auto) checked_add(auto x, auto y) {
+// `checked_add` and `checked_mul` use the overflow built-ins at run time and
+// the portable checks in constant evaluation, both give the same results.
+M_CEXPR decltype(auto) checked_add(auto x, auto y) noexcept {
+#if ALLOY_HAS_OVERFLOW_BUILTINS
+    if (!std::is_constant_evaluated()) {
+        static_assert(std::is_same_v<decltype(x), decltype(y)> &&
+                      std::is_unsigned_v<decltype(x)>);
+        decltype(x) result;
+        if (__builtin_add_overflow(x, y, &result)) {
+            return std::optional<decltype(x)>();
+        }
+        return std::optional<decltype(x)>{ result };
+    }
+#endif
     return checked_op([](auto x, auto y) noexcept { return x + y; },
-                      [](auto res, auto x, auto y) noexcept {
-                          return res < (x | y)
-                                     ? std::optional<decltype(x)>()
-                                     : std::optional<decltype(x)>(res);
-                      },
+                      [](auto res, auto x, auto) noexcept { return res < x; },
                       x, y);
 }
 
-// 16
-M_CEXPR decltype(auto) checked_mul(auto x, auto y) {
+M_CEXPR decltype(auto) checked_mul(auto x, auto y) noexcept {
+#if ALLOY_HAS_OVERFLOW_BUILTINS
+    if (!std::is_constant_evaluated()) {
+        static_assert(std::is_same_v<decltype(x), decltype(y)> &&
+                      std::is_unsigned_v<decltype(x)>);
+        decltype(x) result;
+        if (__builtin_mul_overflow(x, y, &result)) {
+            return std::optional<decltype(x)>();
+        }
+        return std::optional<decltype(x)>{ result };
+    }
+#endif
     return checked_op([](auto x, auto y) noexcept { return x * y; },
                       [](auto res, auto x, auto y) noexcept {
-                          constexpr auto sz = sizeof(decltype(x));
-                          constexpr size_t half = sz / 2;
-                          auto a{ (x >> half) * bit_clear_range(y, 0, half) };
-                          auto b{ bit_clear_range(x, 0, half) * (y >> half) };
-                          return (x >> half) * (y >> half) + (a >> half) +
-                                 (b >> half);
+                          return x != 0 && res / x != y;
                       },
                       x, y);
 }
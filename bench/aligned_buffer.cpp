@@ -0,0 +1,80 @@
+// A float dot product over std::vector, with a scalar remainder loop and
+// unaligned loads, against aligned_vector, whole aligned vectors only. Both
+// kernels keep one accumulator per lane so the compiler vectorizes them
+// without -ffast-math.
+//
+//   g++ -std=c++20 -O3 -march=native bench/aligned_buffer.cpp -lbenchmark -lpthread
+#include "../alloy/aligned_buffer.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+using namespace alloy;
+
+constexpr size_t lanes = aligned_vector<float>::lanes;
+
+static float dot_std(const std::vector<float> &a, const std::vector<float> &b) {
+    const float *x = a.data();
+    const float *y = b.data();
+    const size_t n = a.size();
+    const size_t whole = n - n % lanes;
+    float acc[lanes] = {};
+    for (size_t i = 0; i < whole; i += lanes) {
+        for (size_t k = 0; k < lanes; ++k) {
+            acc[k] += x[i + k] * y[i + k];
+        }
+    }
+    float sum = 0;
+    for (size_t i = whole; i < n; ++i) {
+        sum += x[i] * y[i];
+    }
+    for (size_t k = 0; k < lanes; ++k) {
+        sum += acc[k];
+    }
+    return sum;
+}
+
+static float dot_aligned(const aligned_vector<float> &a,
+                         const aligned_vector<float> &b) {
+    const float *x = a.data();
+    const float *y = b.data();
+    const size_t n = a.padded_size();
+    float acc[lanes] = {};
+    for (size_t i = 0; i < n; i += lanes) {
+        for (size_t k = 0; k < lanes; ++k) {
+            acc[k] += x[i + k] * y[i + k];
+        }
+    }
+    float sum = 0;
+    for (size_t k = 0; k < lanes; ++k) {
+        sum += acc[k];
+    }
+    return sum;
+}
+
+// sizes that are never a multiple of the vector width.
+static size_t size_of(benchmark::State &state) {
+    return static_cast<size_t>(state.range(0)) + lanes - 1;
+}
+
+static void bm_dot_std_vector(benchmark::State &state) {
+    const size_t n = size_of(state);
+    std::vector<float> a(n, 1.0f), b(n, 2.0f);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dot_std(a, b));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void bm_dot_aligned_vector(benchmark::State &state) {
+    const size_t n = size_of(state);
+    aligned_vector<float> a(n, 1.0f), b(n, 2.0f);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dot_aligned(a, b));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(bm_dot_std_vector)->RangeMultiplier(4)->Range(16, 16 << 10);
+BENCHMARK(bm_dot_aligned_vector)->RangeMultiplier(4)->Range(16, 16 << 10);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,284 @@
+// Throughput and latency of the alloy allocators against malloc, jemalloc and
+// std::pmr::monotonic_buffer_resource.
+//
+// Every round allocates `round_size` blocks with layouts drawn from a size
+// distribution, writes to each block and frees them in a shuffled order.
+// Arena like subjects (bump allocator, monotonic resource) drop the whole
+// round with a reset instead. Layouts and free orders are generated from a
+// fixed seed, so runs are reproducible.
+//
+// Thread safe subjects are shared by all benchmark threads; the others get
+// one instance per thread, the way they're meant to be deployed. A shared
+// arena is reset by the last thread to finish a round while the others wait
+// for it, so its rounds are phases and the wait is part of its time.
+//
+//   g++ -std=c++20 -O2 -DNDEBUG bench/allocators.cpp -lbenchmark -lpthread
+//
+// Add `-DALLOY_BENCH_JEMALLOC -ljemalloc` to compare against jemalloc.
+// `--benchmark_filter=latency` runs only the latency percentiles.
+#include "../alloy/alloy.h"
+#include <algorithm>
+#include <array>
+#include <barrier>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+#if defined(ALLOY_BENCH_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#endif
+
+using namespace alloy;
+
+//
+// Size distributions.
+//
+
+enum class Dist {
+    fixed,   // every block 64 bytes.
+    uniform, // 8 to 1024 bytes.
+    mixed,   // mostly small, a tail up to 8 KiB, alignments up to 64.
+};
+
+constexpr size_t round_size = 1024;
+constexpr size_t pattern_size = 4096;
+
+struct Pattern {
+    std::vector<Layout> layouts;
+    std::vector<size_t> free_order;
+};
+
+template <Dist D> const Pattern &pattern() {
+    static const Pattern p = [] {
+        Pattern p;
+        std::mt19937_64 rng(42);
+        for (size_t i = 0; i < pattern_size; ++i) {
+            size_t size = 64, align = 8;
+            if constexpr (D == Dist::uniform) {
+                size = std::uniform_int_distribution<size_t>(8, 1024)(rng);
+            } else if constexpr (D == Dist::mixed) {
+                size_t bucket = rng() % 100;
+                size = bucket < 80   ? 16 + rng() % 112
+                       : bucket < 95 ? 128 + rng() % 896
+                                     : 1024 + rng() % 7168;
+                align = std::array<size_t, 3>{ 8, 16, 64 }[rng() % 3];
+            }
+            p.layouts.push_back(Layout::from_size_align(size, align).value());
+        }
+        p.free_order.resize(round_size);
+        for (size_t i = 0; i < round_size; ++i) {
+            p.free_order[i] = i;
+        }
+        std::shuffle(p.free_order.begin(), p.free_order.end(), rng);
+        return p;
+    }();
+    return p;
+}
+
+//
+// Subjects. `shared` subjects are one instance for all threads, `arena`
+// subjects are reset at the end of every round.
+//
+
+struct Malloc {
+    static constexpr bool shared = true;
+    static constexpr bool arena = false;
+
+    void *allocate(Layout l) noexcept {
+        if (l.align() <= alignof(std::max_align_t)) {
+            return std::malloc(l.size());
+        }
+        return std::aligned_alloc(l.align(), align_up(l.size(), l.align()));
+    }
+    void deallocate(void *p, Layout) noexcept { std::free(p); }
+    void reset() noexcept {}
+};
+
+#if defined(ALLOY_BENCH_JEMALLOC)
+struct Jemalloc {
+    static constexpr bool shared = true;
+    static constexpr bool arena = false;
+
+    void *allocate(Layout l) noexcept {
+        return mallocx(l.size(), MALLOCX_ALIGN(l.align()));
+    }
+    void deallocate(void *p, Layout l) noexcept {
+        sdallocx(p, l.size(), MALLOCX_ALIGN(l.align()));
+    }
+    void reset() noexcept {}
+};
+#endif
+
+struct Monotonic {
+    static constexpr bool shared = false;
+    static constexpr bool arena = true;
+
+    std::pmr::monotonic_buffer_resource resource;
+
+    void *allocate(Layout l) { return resource.allocate(l.size(), l.align()); }
+    void deallocate(void *, Layout) noexcept {}
+    void reset() noexcept { resource.release(); }
+};
+
+template <typename A, bool Shared, bool Arena = false> struct Alloy {
+    static constexpr bool shared = Shared;
+    static constexpr bool arena = Arena;
+
+    A alloc;
+
+    void *allocate(Layout l) noexcept { return alloc.allocate(l); }
+    void deallocate(void *p, Layout l) noexcept { alloc.deallocate(p, l); }
+    void reset() noexcept { alloc.reset(); }
+};
+
+struct LinkedList {
+    static constexpr bool shared = false;
+    static constexpr bool arena = false;
+
+    LinkedListAllocator<FitPolicy::first_fit, PageProvider> alloc{ 64 << 20 };
+
+    void *allocate(Layout l) noexcept { return alloc.allocate(l); }
+    void deallocate(void *p, Layout l) noexcept { alloc.deallocate(p, l); }
+    void reset() noexcept {}
+};
+
+using Bump = Alloy<BumpAllocator, false, true>;
+using SharedBump = Alloy<ConcurrentBumpAllocator, true, true>;
+using Pool = Alloy<FixedSizeAllocator<64>, false>;
+using Slab = Alloy<SlabAllocator, true>;
+using CachedSlab = Alloy<ThreadCache<SlabAllocator>, true>;
+using CachedPool = Alloy<ThreadCache<FixedSizeAllocator<64>>, true>;
+
+// resets a shared arena at the end of a phase.
+template <typename S> struct PhaseEnd {
+    S *s;
+    void operator()() noexcept { s->reset(); }
+};
+
+template <typename S> S &subject() {
+    if constexpr (S::shared) {
+        static S s;
+        return s;
+    } else {
+        thread_local S s;
+        return s;
+    }
+}
+
+//
+// Benchmarks.
+//
+
+template <typename S, Dist D>
+static void bm_throughput(benchmark::State &state) {
+    S &s = subject<S>();
+    const Pattern &p = pattern<D>();
+    std::vector<void *> blocks(round_size);
+    size_t offset = state.thread_index() * round_size;
+    // every thread runs the same number of rounds; the barrier is in place
+    // before any of them starts.
+    using Barrier = std::barrier<PhaseEnd<S>>;
+    static std::unique_ptr<Barrier> phases;
+    if constexpr (S::shared && S::arena) {
+        if (state.thread_index() == 0) {
+            phases = std::make_unique<Barrier>(state.threads(),
+                                               PhaseEnd<S>{ &s });
+        }
+    }
+    for (auto _ : state) {
+        for (size_t i = 0; i < round_size; ++i) {
+            blocks[i] = s.allocate(p.layouts[(offset + i) % pattern_size]);
+            *static_cast<char *>(blocks[i]) = 1;
+        }
+        benchmark::ClobberMemory();
+        if constexpr (S::shared && S::arena) {
+            phases->arrive_and_wait();
+        } else if constexpr (S::arena) {
+            s.reset();
+        } else {
+            for (size_t i : p.free_order) {
+                s.deallocate(blocks[i],
+                             p.layouts[(offset + i) % pattern_size]);
+            }
+        }
+        offset = (offset + round_size) % pattern_size;
+    }
+    state.SetItemsProcessed(state.iterations() * round_size);
+}
+
+// per operation latency percentiles of allocate and deallocate, reported as
+// counters. Includes the cost of reading the clock.
+template <typename S, Dist D> static void bm_latency(benchmark::State &state) {
+    using clock = std::chrono::steady_clock;
+    S &s = subject<S>();
+    const Pattern &p = pattern<D>();
+    std::vector<void *> blocks(round_size);
+    std::vector<float> alloc_ns, free_ns;
+    size_t offset = 0;
+    auto elapsed = [](clock::time_point t) {
+        return std::chrono::duration<float, std::nano>(clock::now() - t)
+            .count();
+    };
+    for (auto _ : state) {
+        for (size_t i = 0; i < round_size; ++i) {
+            auto t = clock::now();
+            blocks[i] = s.allocate(p.layouts[(offset + i) % pattern_size]);
+            alloc_ns.push_back(elapsed(t));
+            *static_cast<char *>(blocks[i]) = 1;
+        }
+        if constexpr (S::arena) {
+            s.reset();
+        } else {
+            for (size_t i : p.free_order) {
+                auto t = clock::now();
+                s.deallocate(blocks[i],
+                             p.layouts[(offset + i) % pattern_size]);
+                free_ns.push_back(elapsed(t));
+            }
+        }
+        offset = (offset + round_size) % pattern_size;
+    }
+    auto report = [&](const char *name, std::vector<float> &ns) {
+        if (ns.empty()) {
+            return;
+        }
+        std::sort(ns.begin(), ns.end());
+        for (auto [suffix, q] : { std::pair{ "_p50", 0.5 },
+                                  std::pair{ "_p99", 0.99 },
+                                  std::pair{ "_p999", 0.999 } }) {
+            state.counters[std::string(name) + suffix] =
+                ns[static_cast<size_t>(q * (ns.size() - 1))];
+        }
+    };
+    report("alloc_ns", alloc_ns);
+    report("free_ns", free_ns);
+}
+
+#define ALLOY_BENCH(S, D)                                                     \
+    BENCHMARK_TEMPLATE(bm_throughput, S, D)->ThreadRange(1, 8)->UseRealTime(); \
+    BENCHMARK_TEMPLATE(bm_latency, S, D)->Iterations(200)
+
+#define ALLOY_BENCH_ALL(S)                                                    \
+    ALLOY_BENCH(S, Dist::fixed);                                              \
+    ALLOY_BENCH(S, Dist::uniform);                                            \
+    ALLOY_BENCH(S, Dist::mixed)
+
+ALLOY_BENCH_ALL(Malloc);
+#if defined(ALLOY_BENCH_JEMALLOC)
+ALLOY_BENCH_ALL(Jemalloc);
+#endif
+ALLOY_BENCH_ALL(Monotonic);
+ALLOY_BENCH_ALL(Bump);
+ALLOY_BENCH_ALL(SharedBump);
+ALLOY_BENCH_ALL(Slab);
+ALLOY_BENCH_ALL(CachedSlab);
+ALLOY_BENCH_ALL(LinkedList);
+// pools only serve their block size.
+ALLOY_BENCH(Pool, Dist::fixed);
+ALLOY_BENCH(CachedPool, Dist::fixed);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,71 @@
+// Bump allocator against std::allocator on a per-request scratch pattern:
+// allocate a batch of small objects, touch them, free them all.
+//
+//   g++ -std=c++20 -O2 bench/bump_allocator.cpp -lbenchmark -lpthread
+#include "../alloy/bump_allocator.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+using namespace alloy;
+
+struct A {
+    int a;
+    double b;
+    char c;
+    int d;
+};
+
+static void bm_std_allocator(benchmark::State &state) {
+    const size_t n = state.range(0);
+    std::allocator<A> alloc;
+    std::vector<A *> ptrs(n);
+    for (auto _ : state) {
+        for (size_t i = 0; i < n; ++i) {
+            ptrs[i] = alloc.allocate(1);
+            ptrs[i]->a = static_cast<int>(i);
+        }
+        benchmark::DoNotOptimize(ptrs.data());
+        for (size_t i = 0; i < n; ++i) {
+            alloc.deallocate(ptrs[i], 1);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void bm_bump_allocator(benchmark::State &state) {
+    const size_t n = state.range(0);
+    BumpAllocator arena;
+    const Layout layout = Layout::create<A>().value();
+    std::vector<A *> ptrs(n);
+    for (auto _ : state) {
+        for (size_t i = 0; i < n; ++i) {
+            ptrs[i] = static_cast<A *>(arena.allocate(layout));
+            ptrs[i]->a = static_cast<int>(i);
+        }
+        benchmark::DoNotOptimize(ptrs.data());
+        arena.reset();
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void bm_bump_allocator_scope(benchmark::State &state) {
+    const size_t n = state.range(0);
+    BumpAllocator arena;
+    const Layout layout = Layout::create<A>().value();
+    std::vector<A *> ptrs(n);
+    for (auto _ : state) {
+        BumpAllocator::Scope scope(arena);
+        for (size_t i = 0; i < n; ++i) {
+            ptrs[i] = static_cast<A *>(arena.allocate(layout));
+            ptrs[i]->a = static_cast<int>(i);
+        }
+        benchmark::DoNotOptimize(ptrs.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(bm_std_allocator)->Range(64, 64 << 10);
+BENCHMARK(bm_bump_allocator)->Range(64, 64 << 10);
+BENCHMARK(bm_bump_allocator_scope)->Range(64, 64 << 10);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,119 @@
+// Runtime cost of the Layout arithmetic. Inputs come from an array the
+// compiler can't see through, so nothing is folded at compile time.
+//
+//   g++ -std=c++20 -O2 -DNDEBUG bench/layout.cpp -lbenchmark -lpthread
+#include "../alloy/memlayout.hpp"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+using namespace alloy;
+
+struct Inputs {
+    std::vector<Layout> layouts;
+    std::vector<size_t> counts;
+};
+
+static const Inputs &inputs() {
+    static const Inputs in = [] {
+        Inputs in;
+        std::mt19937_64 rng(42);
+        for (int i = 0; i < 1024; ++i) {
+            size_t align = size_t(1) << (rng() % 7);
+            in.layouts.push_back(
+                Layout::from_size_align(rng() % 4096, align).value());
+            in.counts.push_back(1 + rng() % 1000);
+        }
+        return in;
+    }();
+    return in;
+}
+
+static void bm_extend(benchmark::State &state) {
+    const auto &in = inputs();
+    size_t i = 0;
+    for (auto _ : state) {
+        auto r = in.layouts[i % 1024].extend(in.layouts[(i + 1) % 1024]);
+        benchmark::DoNotOptimize(r);
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// a struct of `range(0)` fields laid out one after the other.
+static void bm_extend_chain(benchmark::State &state) {
+    const auto &in = inputs();
+    const size_t n = state.range(0);
+    size_t i = 0;
+    for (auto _ : state) {
+        Layout acc;
+        for (size_t f = 0; f < n; ++f) {
+            if (auto r = acc.extend(in.layouts[(i + f) % 1024])) {
+                acc = r->first;
+            }
+        }
+        benchmark::DoNotOptimize(acc.pad_to_align());
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+// the same chain computed by `extend_all`, with the offsets of every field.
+static void bm_extend_all(benchmark::State &state) {
+    const auto &in = inputs();
+    const size_t n = state.range(0);
+    std::vector<Layout> fields(n);
+    for (size_t f = 0; f < n; ++f) {
+        fields[f] = in.layouts[f % 1024];
+    }
+    std::vector<size_t> offsets(n);
+    const Layout start = Layout::from_size_align(0, 1).value();
+    for (auto _ : state) {
+        auto r = start.extend_all(fields, offsets);
+        benchmark::DoNotOptimize(r);
+        benchmark::DoNotOptimize(offsets.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void bm_repeat(benchmark::State &state) {
+    const auto &in = inputs();
+    size_t i = 0;
+    for (auto _ : state) {
+        auto r = in.layouts[i % 1024].repeat(in.counts[i % 1024]);
+        benchmark::DoNotOptimize(r);
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void bm_checked_mul(benchmark::State &state) {
+    const auto &in = inputs();
+    size_t i = 0;
+    for (auto _ : state) {
+        auto r = checked_mul(in.layouts[i % 1024].size(), in.counts[i % 1024]);
+        benchmark::DoNotOptimize(r);
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void bm_checked_add(benchmark::State &state) {
+    const auto &in = inputs();
+    size_t i = 0;
+    for (auto _ : state) {
+        auto r = checked_add(in.layouts[i % 1024].size(), in.counts[i % 1024]);
+        benchmark::DoNotOptimize(r);
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(bm_extend);
+BENCHMARK(bm_extend_chain)->RangeMultiplier(4)->Range(2, 4096);
+BENCHMARK(bm_extend_all)->RangeMultiplier(4)->Range(2, 4096);
+BENCHMARK(bm_repeat);
+BENCHMARK(bm_checked_mul);
+BENCHMARK(bm_checked_add);
+
+BENCHMARK_MAIN();
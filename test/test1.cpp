@@ -1,6 +1,12 @@
+#include "../alloy/cache_padded.hpp"
 #include "../alloy/memlayout.hpp"
+#include "../alloy/packed_tuple.hpp"
+#include "../alloy/struct_layout.hpp"
 #include <any>
+#include <atomic>
+#include <cassert>
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 
 using namespace alloy;
@@ -12,7 +18,92 @@ struct A {
     int d;
 };
 
+// field layouts are computed at compile time.
+static_assert(layout_of_struct<A>().value().layout ==
+              Layout::create<A>().value());
+static_assert(layout_of_struct<A>().value().fields[1].offset ==
+              offsetof(A, b));
+static_assert(layout_of_struct<A>().value().fields[3].offset ==
+              offsetof(A, d));
+static_assert(padding_of<A>() == 7);
+static_assert(layout_of_fields<char, int, char>().value().layout.size() == 12);
+
+// reordering by decreasing alignment removes the padding between fields.
+static_assert(min_padding_order<int, double, char, int>() ==
+              std::array<size_t, 4>{ 1, 0, 3, 2 });
+static_assert(
+    reordered_layout<int, double, char, int>().value().padding() == 7);
+static_assert(reordered_layout<char, double, char>().value().layout.size() ==
+              16);
+static_assert(packed_tuple<char, double, char>::layout().size() == 16);
+static_assert(packed_tuple<char, double, char>::offset_of<0>() == 8);
+
+// cache line aware layouts.
+static_assert(Layout::create<A>().value().align_to_cacheline().value() ==
+              Layout::from_size_align(64, 64).value());
+static_assert(Layout::create<A>().value().pad_to(16).value().size() == 32);
+static_assert(!Layout::create<A>().value().pad_to(12));
+
+struct Counters {
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
+
+struct PaddedCounters {
+    cache_padded<std::atomic<size_t>> head;
+    cache_padded<std::atomic<size_t>> tail;
+};
+
+static_assert(sizeof(cache_padded<char>) == cache_line_size);
+static_assert(Layout::create<cache_padded<A>>().value() ==
+              cache_padded<A>::layout());
+static_assert(layout_of_struct<Counters>().value().shares_cache_line(0, 1));
+static_assert(!layout_of_struct<PaddedCounters>()
+                   .value()
+                   .first_shared_cache_line());
+
+// counts live instances, throws when built from a negative number.
+struct Tracked {
+    static inline int live = 0;
+    int value;
+
+    Tracked(int v)
+        : value(v) {
+        if (v < 0) {
+            throw std::invalid_argument("negative");
+        }
+        ++live;
+    }
+    Tracked(const Tracked &other)
+        : Tracked(other.value) {}
+    ~Tracked() { --live; }
+};
+
+// a field that throws takes down the ones built before it.
+static void packed_tuple_unwinds() {
+    using T = packed_tuple<Tracked, double, Tracked>;
+    bool thrown = false;
+    try {
+        T t(1, 2.0, -1);
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    assert(thrown && Tracked::live == 0);
+
+    T t(1, 2.0, 3);
+    t.get<2>().value = -1;
+    thrown = false;
+    try {
+        T copy(t);
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    assert(thrown && Tracked::live == 2);
+}
+
 int main(void) {
+    packed_tuple_unwinds();
+
     if (auto l1 = Layout::create<int>()) {
         std::cout << to_string(l1.value()) << std::endl;
     }
@@ -23,5 +114,20 @@ int main(void) {
     }
     std::cout << "no" << std::endl;
 
+    if (auto l3 = layout_of_struct<A>()) {
+        std::cout << to_string(l3.value()) << std::endl;
+    }
+
+    packed_tuple<char, double, char> t('a', 2.5, 'b');
+    auto &[c0, d, c1] = t;
+    std::cout << c0 << " " << d << " " << c1 << " in "
+              << to_string(t.layout()) << std::endl;
+
+    // erased pointers keep their layout.
+    A a{};
+    if (auto some = make_some_has_layout(&a)) {
+        std::cout << to_string(some.value().layout()) << std::endl;
+    }
+
     return 0;
 }
@@ -0,0 +1,126 @@
+#include "../alloy/aligned_buffer.hpp"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+
+using namespace alloy;
+
+template <typename T> bool aligned(const T *p, size_t align) {
+    return reinterpret_cast<uintptr_t>(p) % align == 0;
+}
+
+// storage is `repeat` raised to the alignment and padded to whole vectors.
+void layouts() {
+    using B = aligned_buffer<float, 64>;
+    static_assert(B::lanes == 16);
+    assert(B::layout_for(1).value() ==
+           Layout::from_size_align(64, 64).value());
+    assert(B::layout_for(16).value() ==
+           Layout::from_size_align(64, 64).value());
+    assert(B::layout_for(17).value() ==
+           Layout::from_size_align(128, 64).value());
+    assert(B::layout_for(0).value().size() == 0);
+    assert(!B::layout_for(std::numeric_limits<size_t>::max() / 2));
+    static_assert(aligned_buffer<double, 32>::lanes == 4);
+}
+
+void buffer() {
+    aligned_buffer<float> b(37, 1.5f);
+    assert(b.size() == 37 && b.padded_size() == 48);
+    assert(aligned(b.data(), 64));
+    for (float x : b) {
+        assert(x == 1.5f);
+    }
+    // the tail is zero, a whole vector loop sees only neutral elements.
+    float sum = 0;
+    for (float x : b.padded_span()) {
+        sum += x;
+    }
+    assert(sum == 37 * 1.5f);
+
+    aligned_buffer<float> copy = b;
+    assert(copy.size() == 37 && copy.data() != b.data());
+    assert(copy[36] == 1.5f && copy.padded_span()[47] == 0);
+    aligned_buffer<float> moved = std::move(copy);
+    assert(moved.size() == 37 && copy.empty());
+
+    aligned_buffer<uint8_t, 32> bytes{ 1, 2, 3 };
+    assert(bytes.padded_size() == 32 && aligned(bytes.data(), 32));
+    assert(bytes[2] == 3 && bytes.padded_span()[31] == 0);
+
+    aligned_buffer<int> empty(0);
+    assert(empty.empty() && empty.padded_size() == 0);
+}
+
+void vector() {
+    aligned_vector<int32_t, 32> v;
+    assert(v.empty() && v.capacity() == 0);
+    for (int i = 0; i < 100; ++i) {
+        v.push_back(i);
+        assert(aligned(v.data(), 32));
+        assert(v.capacity() % v.lanes == 0);
+    }
+    assert(v.size() == 100 && v.padded_size() == 104);
+    for (int i = 0; i < 100; ++i) {
+        assert(v[i] == i);
+    }
+    // zero past the size, up to the capacity.
+    for (size_t i = v.size(); i < v.capacity(); ++i) {
+        assert(v.data()[i] == 0);
+    }
+
+    v.pop_back();
+    assert(v.size() == 99 && v.data()[99] == 0);
+    v.resize(10);
+    for (size_t i = 10; i < v.capacity(); ++i) {
+        assert(v.data()[i] == 0);
+    }
+    v.resize(20, 7);
+    assert(v[9] == 9 && v[10] == 7 && v[19] == 7 && v.data()[20] == 0);
+    int64_t sum = std::accumulate(v.padded_span().begin(),
+                                  v.padded_span().end(), int64_t(0));
+    assert(sum == 45 + 70);
+
+    v.shrink_to_fit();
+    assert(v.capacity() == 24 && v.size() == 20 && v[19] == 7);
+    v.reserve(1000);
+    assert(v.capacity() >= 1000 && v[19] == 7 && v.data()[20] == 0);
+
+    aligned_vector<int32_t, 32> w{ 1, 2, 3 };
+    w = v;
+    assert(w.size() == 20 && w[19] == 7);
+    v.clear();
+    assert(v.empty() && v.data()[0] == 0 && w[0] == 0);
+
+    aligned_vector<double> zeros(5);
+    assert(zeros.size() == 5 && zeros.capacity() == 8);
+    assert(zeros[4] == 0.0 && aligned(zeros.data(), 64));
+
+    bool thrown = false;
+    try {
+        aligned_vector<double> huge(std::numeric_limits<size_t>::max());
+    } catch (const std::length_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // elements of the vector appended again while it grows.
+    aligned_vector<int32_t, 32> x{ 5 };
+    while (x.size() < x.capacity()) {
+        x.push_back(1);
+    }
+    size_t full = x.capacity();
+    x.push_back(x[0]);
+    assert(x.capacity() > full && x.back() == 5);
+    x.resize(x.capacity() + 1, x[0]);
+    assert(x.back() == 5 && x[full] == 5);
+}
+
+int main() {
+    layouts();
+    buffer();
+    vector();
+    std::cout << "aligned buffer: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "../alloy/allocation_trace.hpp"
+#include "../alloy/bump_allocator.hpp"
+#include "../alloy/fixed_size_allocator.hpp"
+#include "../alloy/slab_allocator.hpp"
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace alloy;
+
+static_assert(Traced<SlabAllocator>::thread_safe);
+static_assert(!Traced<BumpAllocator>::thread_safe);
+static_assert(LayoutAllocator<Traced<BumpAllocator>>);
+
+// every call is recorded, in order for each thread, through ring overflows.
+void records_every_call() {
+    constexpr int n_threads = 4;
+    constexpr int n_blocks = 300;
+
+    Tracer tracer({}, 64);
+    Traced<SlabAllocator> slab(tracer);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t) {
+        threads.emplace_back([&, t] {
+            std::vector<std::pair<void *, Layout>> blocks;
+            for (int i = 0; i < n_blocks; ++i) {
+                auto l = Layout::from_size_align(8 + (i + t) % 500, 8).value();
+                blocks.push_back({ slab.allocate(l), l });
+            }
+            for (auto [p, l] : blocks) {
+                slab.deallocate(p, l);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    tracer.flush();
+    assert(tracer.size() == n_threads * n_blocks * 2 && tracer.lost() == 0);
+
+    auto trace = RecordReader<TraceEvent>::view(tracer.bytes());
+    assert(trace && trace->size() == tracer.size());
+    // a thread that starts after another exited takes over its ring and
+    // its index.
+    std::vector<uint64_t> last(n_threads, 0);
+    size_t allocations = 0;
+    for (const TraceEvent &e : trace->records()) {
+        assert(e.thread < n_threads && e.ptr != 0 && e.align == 8);
+        assert(e.time >= last[e.thread]);
+        last[e.thread] = e.time;
+        allocations += e.op == uint8_t(TraceOp::allocate);
+    }
+    assert(allocations == n_threads * n_blocks);
+
+    // replayed on another allocator, every free finds its block.
+    FixedSizeAllocator<512> pool;
+    ReplayReport report = replay(trace->records(), pool);
+    assert(report.allocations == n_threads * n_blocks);
+    assert(report.frees == n_threads * n_blocks);
+    assert(report.failures == 0 && report.skipped == 0);
+    assert(report.threads >= 1 && report.threads <= n_threads);
+    assert(report.seconds > 0 && report.ops_per_second() > 0);
+    assert(pool.statistics().bytes_in_use == 0);
+}
+
+// resets and failures replay as such, frees of blocks the trace never saw
+// are skipped.
+void replay_semantics() {
+    auto path = std::filesystem::temp_directory_path() / "alloy_test.trace";
+    {
+        Tracer tracer(RecordWriter<TraceEvent>::create(path).value());
+        Traced<BumpAllocator> arena(tracer, size_t(4096));
+        char outside;
+        auto l = Layout::from_size_align(100, 16).value();
+        for (int round = 0; round < 3; ++round) {
+            for (int i = 0; i < 10; ++i) {
+                void *p = arena.allocate(l);
+                assert(p);
+            }
+            arena.reset();
+        }
+        arena.deallocate(&outside, l);
+        arena.allocate(Layout()); // fails, recorded with a null block.
+        bool finished = tracer.finish();
+        assert(finished);
+    }
+    auto trace = RecordReader<TraceEvent>::open(path);
+    assert(trace && trace->size() == 35);
+
+    BumpAllocator arena(1024);
+    ReplayReport report = replay(trace->records(), arena);
+    assert(report.allocations == 30 && report.resets == 3);
+    assert(report.frees == 0 && report.skipped == 2);
+    assert(report.peak_live_bytes == 1000);
+    assert(report.ops() == 33);
+    // the replay's chunks are at least what was live.
+    assert(arena.capacity() >= 1000);
+    std::filesystem::remove(path);
+}
+
+// blocks a replay leaves live are given back.
+void frees_leftovers() {
+    Tracer tracer;
+    Traced<FixedSizeAllocator<64, 8, HeapProvider, BasicStats>> traced(tracer);
+    auto l = Layout::from_size_align(64, 8).value();
+    for (int i = 0; i < 100; ++i) {
+        traced.allocate(l);
+    }
+    tracer.flush();
+    auto trace = RecordReader<TraceEvent>::view(tracer.bytes());
+
+    FixedSizeAllocator<64, 8, HeapProvider, BasicStats> pool;
+    ReplayReport report = replay(trace->records(), pool, { 0, false });
+    assert(report.allocations == 100 && report.peak_rss_bytes == 0);
+    assert(report.fragmentation() == 0);
+    auto s = pool.statistics();
+    assert(s.allocations == 100 && s.frees == 100);
+    traced.reset();
+}
+
+int main() {
+    records_every_call();
+    replay_semantics();
+    frees_leftovers();
+    std::cout << "allocation trace: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "../alloy/alloy.h"
+#include <cassert>
+#include <iostream>
+#include <list>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace alloy;
+
+static_assert(LayoutAllocator<BumpAllocator>);
+static_assert(LayoutAllocator<FixedSizeAllocator<32>>);
+static_assert(LayoutAllocator<SlabAllocator>);
+static_assert(LayoutAllocator<LinkedListAllocator<FitPolicy::best_fit>>);
+
+int main(void) {
+    // arena behind pmr containers.
+    BumpAllocator arena;
+    MemoryResource arena_resource(arena);
+    {
+        std::pmr::vector<int> v(&arena_resource);
+        for (int i = 0; i < 1000; ++i) {
+            v.push_back(i);
+        }
+        assert(arena.owns(v.data()));
+    }
+
+    SlabAllocator slab;
+    MemoryResource slab_resource(slab);
+    {
+        std::pmr::unordered_map<int, std::pmr::string> m(&slab_resource);
+        // the bucket array must stay within the largest size class.
+        for (int i = 0; i < 500; ++i) {
+            m.emplace(i, std::to_string(i) + " is a number long enough");
+        }
+        assert(m.at(250) == "250 is a number long enough");
+    }
+    assert(slab.stats()[0].in_use() == 0);
+
+    // pool behind a node based container.
+    FixedSizeAllocator<32> pool;
+    {
+        std::list<int, StlAllocator<int, FixedSizeAllocator<32>>> l{
+            StlAllocator<int, FixedSizeAllocator<32>>(pool)
+        };
+        for (int i = 0; i < 1000; ++i) {
+            l.push_back(i);
+        }
+        assert(pool.capacity() >= 1000);
+    }
+
+    alignas(16) static char region[1 << 16];
+    LinkedListAllocator<> heap(region, sizeof(region));
+    {
+        std::vector<double, StlAllocator<double, LinkedListAllocator<>>> v{
+            StlAllocator<double, LinkedListAllocator<>>(heap)
+        };
+        v.resize(1000);
+        assert(heap.owns(v.data()));
+    }
+    assert(heap.free_blocks() == 1);
+
+    std::cout << "allocator adapters: ok" << std::endl;
+    return 0;
+}
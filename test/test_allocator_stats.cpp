@@ -0,0 +1,159 @@
+#include "../alloy/alloy.h"
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace alloy;
+
+struct A {
+    int a;
+    double b;
+    char c;
+    int d;
+};
+
+// statistics cost no space when they're off.
+static_assert(sizeof(BumpAllocator) == 3 * sizeof(void *));
+static_assert(sizeof(FixedSizeAllocator<32>) == 7 * sizeof(void *));
+
+int main(void) {
+    constexpr auto la = Layout::create<A>().value();
+    constexpr auto lc = Layout::create<char>().value();
+    constexpr auto lv = Layout::from_size_align(100, 64).value();
+
+    {
+        BasicBumpAllocator<HeapProvider, BasicStats> arena;
+        void *c = arena.allocate(lc);
+        void *a = arena.allocate(la); // 7 bytes of padding after the char.
+        auto s = arena.statistics();
+        assert(s.allocations == 2 && s.bytes_in_use == 1 + 7 + 24);
+        assert(s.padding_bytes == 7);
+        assert(s.histogram[AllocatorStats::bucket_of(1)] == 1);
+        assert(s.histogram[AllocatorStats::bucket_of(24)] == 1);
+
+        // only the last block is rolled back, the char and the padding
+        // after it stay in use.
+        arena.deallocate(a, la);
+        arena.deallocate(c, lc);
+        s = arena.statistics();
+        assert(s.frees == 2 && s.bytes_in_use == 8);
+        assert(s.peak_bytes == 32);
+
+        {
+            BasicBumpAllocator<HeapProvider, BasicStats>::Scope scope(arena);
+            for (int i = 0; i < 100; ++i) {
+                arena.allocate(lv);
+            }
+            assert(arena.statistics().bytes_in_use >= 100 * lv.size());
+        }
+        assert(arena.statistics().bytes_in_use == 8);
+        arena.reset();
+        s = arena.statistics();
+        assert(s.bytes_in_use == 0 && s.peak_bytes >= 100 * lv.size());
+        std::cout << to_string(s) << std::endl;
+    }
+
+    {
+        FixedSizeAllocator<32, 16, HeapProvider, BasicStats> pool;
+        std::vector<void *> blocks;
+        for (int i = 0; i < 10; ++i) {
+            blocks.push_back(pool.allocate(lc));
+        }
+        void *too_large = pool.allocate(lv);
+        assert(!too_large);
+        for (void *p : blocks) {
+            pool.deallocate(p, lc);
+        }
+        auto s = pool.statistics();
+        assert(s.allocations == 10 && s.frees == 10 && s.failures == 1);
+        assert(s.bytes_in_use == 0 && s.peak_bytes == 320);
+        assert(s.padding_bytes == 310);
+        std::cout << to_string(s) << std::endl;
+    }
+
+    {
+        alignas(64) static char region[1 << 16];
+        LinkedListAllocator<FitPolicy::best_fit, HeapProvider, BasicStats> heap(
+            region, sizeof(region));
+        void *p = heap.allocate(la);
+        auto s = heap.statistics();
+        // the header and the rounding to a granule count as padding.
+        assert(s.bytes_in_use == heap.header_size + 32);
+        assert(s.padding_bytes == heap.header_size + 32 - la.size());
+        heap.deallocate(p, la);
+        assert(heap.statistics().bytes_in_use == 0);
+        void *too_large =
+            heap.allocate(Layout::from_size_align(1 << 20, 8).value());
+        assert(!too_large);
+        assert(heap.statistics().failures == 1);
+    }
+
+    {
+        BasicSlabAllocator<HeapProvider, ConcurrentStats> slab;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                std::vector<void *> mine;
+                for (int i = 0; i < 1000; ++i) {
+                    mine.push_back(slab.allocate(la));
+                }
+                for (void *p : mine) {
+                    slab.deallocate(p, la);
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        auto s = slab.statistics();
+        assert(s.allocations == 4000 && s.frees == 4000);
+        assert(s.bytes_in_use == 0 && s.peak_bytes >= 1000 * 32);
+        assert(s.padding_bytes == 4000 * (32 - la.size()));
+        std::cout << to_string(s) << std::endl;
+    }
+
+    {
+        ThreadCache<SlabAllocator, 32, ConcurrentStats> cache;
+        void *p = cache.allocate(lv);
+        assert(cache.statistics().bytes_in_use == 128);
+        cache.deallocate(p, lv);
+        auto s = cache.statistics();
+        assert(s.live() == 0 && s.bytes_in_use == 0 && s.peak_bytes == 128);
+    }
+
+    // atomic counters move with the allocator.
+    {
+        BasicBumpAllocator<HeapProvider, ConcurrentStats> arena;
+        void *p = arena.allocate(la);
+        assert(p);
+        auto moved = std::move(arena);
+        assert(moved.statistics().allocations == 1);
+        assert(arena.statistics().allocations == 0);
+        arena = std::move(moved);
+        assert(arena.statistics().bytes_in_use == 24);
+
+        FixedSizeAllocator<32, 16, HeapProvider, ConcurrentStats> pool;
+        p = pool.allocate(lc);
+        assert(p);
+        auto pool2 = std::move(pool);
+        pool2.deallocate(p, lc);
+        auto s = pool2.statistics();
+        assert(s.allocations == 1 && s.frees == 1 && s.peak_bytes == 32);
+        pool = std::move(pool2);
+        assert(pool.statistics().allocations == 1);
+
+        alignas(64) static char region[1 << 12];
+        LinkedListAllocator<FitPolicy::first_fit, HeapProvider,
+                            ConcurrentStats>
+            heap(region, sizeof(region));
+        p = heap.allocate(la);
+        assert(p);
+        auto heap2 = std::move(heap);
+        assert(heap2.statistics().allocations == 1);
+        heap = std::move(heap2);
+        heap.deallocate(p, la);
+        assert(heap.statistics().live() == 0);
+    }
+    return 0;
+}
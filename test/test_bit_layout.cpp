@@ -0,0 +1,108 @@
+#include "../alloy/bit_layout.hpp"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace alloy;
+
+// the bit range helpers at the edges of the word.
+static_assert(bit_mask<uint64_t>(0) == 0 && bit_mask<uint64_t>(64) == ~0ull);
+static_assert(bit_mask<uint8_t>(3) == 0b111);
+static_assert(bit_set_range<uint8_t>(0, 5, 3) == 0b11100000);
+static_assert(bit_clear_range<uint32_t>(~0u, 0, 32) == 0);
+static_assert(bit_clear_range<uint16_t>(0xffff, 4, 8) == 0xf00f);
+static_assert(bit_set_range<uint64_t>(1, 3, 0) == 1);
+static_assert(bit_get_range<uint32_t>(0xabcd1234, 8, 12) == 0xd12);
+static_assert(bit_insert_range<uint16_t>(0xffff, 4, 4, 0x3) == 0xff3f);
+
+enum class Color : uint8_t { red, green, blue, black };
+
+using Flags = bit_record<uint16_t, bit_field<bool, 1>, bit_field<Color, 2>,
+                         bit_field<int8_t, 5>, bit_field<uint8_t, 8>>;
+
+static_assert(Flags::bit_size == 16 && sizeof(Flags) == 2);
+static_assert(Flags::offsets[3] == 8 && Flags::mask<1> == 0b110);
+static_assert(Flags(true, Color::blue, -3, 200).get<2>() == -3);
+static_assert(Flags(true, Color::blue, -3, 200).get<1>() == Color::blue);
+static_assert(Flags(false, Color::black, 15, 0).bits() == 0b0111'1110);
+static_assert(Flags::layout() == Layout::create<uint16_t>().value());
+
+static void test_record() {
+    Flags f(true, Color::green, -16, 255);
+    assert(f.get<0>() && f.get<1>() == Color::green);
+    assert(f.get<2>() == -16 && f.get<3>() == 255);
+    f.set<2>(15);
+    f.set<0>(false);
+    assert(!f.get<0>() && f.get<2>() == 15 && f.get<3>() == 255);
+    // values are truncated to the field width.
+    f.set<2>(static_cast<int8_t>(33));
+    assert(f.get<2>() == 1 && f.get<1>() == Color::green);
+}
+
+static void test_bulk(std::mt19937_64 &rng) {
+    std::vector<Flags> records(1003);
+    std::vector<int8_t> in(records.size());
+    std::vector<Color> colors(records.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        in[i] = static_cast<int8_t>(int(rng() % 32) - 16);
+        colors[i] = static_cast<Color>(rng() % 4);
+    }
+    Flags::insert<2>(records, std::span<const int8_t>(in));
+    Flags::insert<1>(records, std::span<const Color>(colors));
+
+    std::vector<int8_t> out(records.size());
+    Flags::extract<2>(records, std::span(out));
+    assert(out == in);
+    for (size_t i = 0; i < records.size(); ++i) {
+        assert(records[i].get<1>() == colors[i] && !records[i].get<0>());
+    }
+}
+
+static void test_bit_array(std::mt19937_64 &rng) {
+    bit_array<3> a(1000000);
+    // 21 values per word: 8 times smaller than a byte per value.
+    assert(a.bytes() == (1000000 + 20) / 21 * 8);
+
+    std::vector<uint8_t> values(a.size());
+    for (auto &v : values) {
+        v = rng() % 8;
+    }
+    a.insert(0, std::span<const uint8_t>(values));
+    for (size_t i = 0; i < a.size(); i += 997) {
+        assert(a[i] == values[i]);
+    }
+
+    // unaligned bulk ranges.
+    std::vector<uint16_t> out(1000);
+    a.extract(13, std::span(out));
+    for (size_t i = 0; i < out.size(); ++i) {
+        assert(out[i] == values[13 + i]);
+    }
+    std::vector<uint16_t> ones(100, 7);
+    a.insert(500, std::span<const uint16_t>(ones));
+    assert(a[499] == values[499] && a[500] == 7 && a[599] == 7 &&
+           a[600] == values[600]);
+
+    // shrinking clears the dropped values, growing yields zeros.
+    a.resize(5);
+    a.resize(22);
+    assert(a[4] == values[4] && a[5] == 0 && a[21] == 0);
+
+    bit_array<1> flags;
+    for (int i = 0; i < 130; ++i) {
+        flags.push_back(i % 3 == 0);
+    }
+    assert(flags.size() == 130 && flags.bytes() == 24);
+    assert(flags[129] == 1 && flags[128] == 0);
+}
+
+int main(void) {
+    std::mt19937_64 rng(19);
+    test_record();
+    test_bulk(rng);
+    test_bit_array(rng);
+    std::cout << "bit layout: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "../alloy/bump_allocator.hpp"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+using namespace alloy;
+
+struct A {
+    int a;
+    double b;
+    char c;
+    int d;
+};
+
+static bool is_aligned(void *p, size_t align) {
+    return reinterpret_cast<uintptr_t>(p) % align == 0;
+}
+
+int main(void) {
+    BumpAllocator arena(1024);
+
+    // every block honors the alignment of its layout.
+    auto lc = Layout::create<char>().value();
+    auto la = Layout::create<A>().value();
+    auto lv = Layout::from_size_align(32, 64).value();
+    for (int i = 0; i < 100; ++i) {
+        void *c = arena.allocate(lc);
+        void *a = arena.allocate(la);
+        void *v = arena.allocate(lv);
+        assert(c && a && v);
+        assert(is_aligned(a, alignof(A)));
+        assert(is_aligned(v, 64));
+        assert(arena.owns(c) && arena.owns(a) && arena.owns(v));
+    }
+
+    // large blocks get their own chunk.
+    auto big = Layout::from_size_align(100000, 8).value();
+    void *b = arena.allocate(big);
+    assert(b && arena.owns(b));
+
+    // the last block can be returned.
+    size_t before = arena.used();
+    void *last = arena.allocate(la);
+    arena.deallocate(last, la);
+    assert(arena.used() == before);
+
+    // scopes rewind everything allocated inside them.
+    {
+        BumpAllocator::Scope scope(arena);
+        for (int i = 0; i < 1000; ++i) {
+            A *p = arena.allocate<A>(4);
+            assert(p);
+        }
+    }
+    assert(arena.used() == before);
+
+    // reset keeps the chunks around for reuse.
+    size_t capacity = arena.capacity();
+    arena.reset();
+    assert(arena.used() == 0);
+    assert(arena.capacity() == capacity);
+    assert(!arena.owns(b));
+    void *reused = arena.allocate(big);
+    assert(reused && arena.capacity() == capacity);
+
+    arena.release();
+    assert(arena.capacity() == 0);
+
+    // chunks mapped straight from the kernel, on transparent huge pages.
+    PageProvider pages({ .huge_pages = PageProvider::HugePages::transparent });
+    BasicBumpAllocator<PageProvider> mapped(1 << 16, pages);
+    for (int i = 0; i < 100; ++i) {
+        void *p = mapped.allocate(big);
+        assert(p && is_aligned(p, 8) && mapped.owns(p));
+        std::memset(p, 0xab, big.size());
+    }
+    assert(mapped.capacity() >= 100 * big.size());
+    mapped.release();
+
+    std::cout << "bump allocator: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "../alloy/composite_allocator.hpp"
+#include "../alloy/fixed_size_allocator.hpp"
+#include "../alloy/inline_arena.hpp"
+#include "../alloy/linked_list_allocator.hpp"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace alloy;
+
+template <size_t S> using Pool = FixedSizeAllocator<S>;
+
+using Small = Bucketizer<32, 256, Pool>;
+using Medium = LinkedListAllocator<FitPolicy::best_fit>;
+using Huge = ProviderAllocator<PageProvider>;
+using Large = Segregator<(64 << 10), Medium, Huge>;
+using ServiceAllocator = Segregator<256, Small, Large>;
+
+static_assert(LayoutAllocator<ServiceAllocator>);
+static_assert(LayoutAllocator<FallbackAllocator<inline_arena<64>, Huge>>);
+static_assert(Small::bucket_count == 8);
+
+static Layout bytes(size_t size, size_t align = 8) {
+    return Layout::from_size_align(size, align).value();
+}
+
+int main(void) {
+    ServiceAllocator a(Small(), Large(Medium(64 << 20), Huge()));
+
+    // run time routing.
+    void *tiny = a.allocate(bytes(1));
+    void *small = a.allocate(bytes(200));
+    void *medium = a.allocate(bytes(1000));
+    void *huge = a.allocate(bytes(1 << 20, 4096));
+    assert(a.small().bucket<0>().owns(tiny));
+    assert(a.small().bucket<6>().owns(small));
+    assert(a.large().small().owns(medium));
+    assert(a.large().large().owns(huge) && !a.small().owns(huge));
+    assert(reinterpret_cast<uintptr_t>(huge) % 4096 == 0);
+    assert(a.owns(tiny) && a.owns(medium) && a.owns(huge));
+
+    // compile time routing reaches the same allocators.
+    void *s = a.allocate<64, 8>();
+    assert(a.small().bucket<1>().owns(s));
+    void *m = a.allocate<4096>();
+    assert(a.large().small().owns(m));
+    a.deallocate<64, 8>(s);
+    a.deallocate<4096>(m);
+
+    a.deallocate(tiny, bytes(1));
+    a.deallocate(small, bytes(200));
+    a.deallocate(medium, bytes(1000));
+    a.deallocate(huge, bytes(1 << 20, 4096));
+    assert(!a.owns(huge));
+
+    // a mixed workload.
+    std::mt19937_64 rng(21);
+    std::vector<std::pair<void *, Layout>> live;
+    for (int i = 0; i < 20000; ++i) {
+        if (live.empty() || rng() % 3) {
+            size_t size = rng() % 8 ? 1 + rng() % 256 : 1 + rng() % 200000;
+            Layout l = bytes(size);
+            void *p = a.allocate(l);
+            assert(p && a.owns(p));
+            static_cast<char *>(p)[size - 1] = 1;
+            live.push_back({ p, l });
+        } else {
+            size_t k = rng() % live.size();
+            a.deallocate(live[k].first, live[k].second);
+            live[k] = live.back();
+            live.pop_back();
+        }
+    }
+    a.reset();
+    assert(a.large().large().owns(live.front().first) == false);
+
+    // a full primary hands over to the fallback.
+    FallbackAllocator<inline_arena<64, Huge>, Huge> f;
+    void *p1 = f.allocate(bytes(48));
+    void *p2 = f.allocate(bytes(48));
+    assert(f.primary().owns_inline(p1) && !f.primary().owns_inline(p2));
+    f.deallocate(p2, bytes(48));
+    f.deallocate(p1, bytes(48));
+    assert(f.primary().inline_used() == 0);
+
+    // sizes past the last bucket are refused.
+    Small b;
+    void *too_large = b.allocate(bytes(257));
+    void *empty = b.allocate(bytes(0));
+    assert(too_large == nullptr && empty != nullptr);
+
+    std::cout << "composite allocator: ok" << std::endl;
+    return 0;
+}
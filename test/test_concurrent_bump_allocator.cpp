@@ -0,0 +1,142 @@
+#include "../alloy/concurrent_bump_allocator.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace alloy;
+
+using Arena = BasicConcurrentBumpAllocator<HeapProvider, ConcurrentStats>;
+
+static bool is_aligned(void *p, size_t align) {
+    return reinterpret_cast<uintptr_t>(p) % align == 0;
+}
+
+// blocks honor their alignment and the cursor moves by whole granules.
+void alignment() {
+    ConcurrentBumpAllocator arena(4096, 4);
+    assert(arena.shards() == 4);
+    auto lc = Layout::create<char>().value();
+    auto lv = Layout::from_size_align(32, 64).value();
+    auto lp = Layout::from_size_align(100, 8192).value();
+    for (int i = 0; i < 100; ++i) {
+        void *c = arena.allocate(lc);
+        void *v = arena.allocate(lv);
+        assert(c && v);
+        assert(is_aligned(c, ConcurrentBumpAllocator::granule));
+        assert(is_aligned(v, 64));
+        assert(arena.owns(c) && arena.owns(v));
+    }
+    // alignments past the chunk's get a chunk of their own.
+    void *p = arena.allocate(lp);
+    assert(p && is_aligned(p, 8192) && arena.owns(p));
+
+    // large blocks too.
+    void *big = arena.allocate(Layout::from_size_align(100000, 8).value());
+    assert(big && arena.owns(big));
+
+    void *invalid = arena.allocate(Layout());
+    assert(invalid == nullptr && !arena.owns(&arena));
+
+    // an invalid layout is refused on the fast path too, where a chunk is
+    // already current.
+    ConcurrentBumpAllocator one(4096, 1);
+    void *c = one.allocate(lc);
+    invalid = one.allocate(Layout());
+    assert(c != nullptr && invalid == nullptr);
+}
+
+// the last block of a chunk can be given back.
+void deallocate_last() {
+    Arena arena(4096, 1);
+    auto l = Layout::from_size_align(24, 8).value();
+    void *a = arena.allocate(l);
+    size_t before = arena.used();
+    void *b = arena.allocate(l);
+    assert(arena.used() == before + 32);
+    arena.deallocate(a, l); // not the last one, kept.
+    assert(arena.used() == before + 32);
+    arena.deallocate(b, l);
+    assert(arena.used() == before);
+    void *again = arena.allocate(l);
+    assert(again == b);
+
+    auto s = arena.statistics();
+    assert(s.allocations == 3 && s.frees == 2);
+    assert(s.bytes_in_use == 2 * 32);
+}
+
+// threads get disjoint blocks, and a reset phase reuses the chunks.
+void concurrent_phases() {
+    constexpr int n_threads = 8;
+    constexpr int n_blocks = 4000;
+
+    Arena arena(16 * 1024);
+    size_t capacity = 0;
+    for (int phase = 0; phase < 3; ++phase) {
+        std::vector<std::vector<std::pair<char *, size_t>>> blocks(n_threads);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < n_threads; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < n_blocks; ++i) {
+                    size_t size = 1 + (i * 7 + t) % 200;
+                    size_t align = size_t(1) << (i % 8);
+                    auto l = Layout::from_size_align(size, align).value();
+                    auto p = static_cast<char *>(arena.allocate(l));
+                    assert(p && is_aligned(p, align));
+                    std::memset(p, t, size);
+                    blocks[t].push_back({ p, size });
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+
+        // every block still holds what its thread wrote, and none overlap.
+        std::vector<std::pair<char *, size_t>> all;
+        for (int t = 0; t < n_threads; ++t) {
+            for (auto [p, size] : blocks[t]) {
+                assert(arena.owns(p));
+                assert(std::all_of(p, p + size,
+                                   [t](char c) { return c == char(t); }));
+                all.push_back({ p, size });
+            }
+        }
+        std::sort(all.begin(), all.end());
+        for (size_t i = 1; i < all.size(); ++i) {
+            assert(all[i - 1].first + all[i - 1].second <= all[i].first);
+        }
+
+        auto s = arena.statistics();
+        assert(s.allocations == size_t(n_threads * n_blocks) * (phase + 1));
+        assert(s.bytes_in_use <= arena.used());
+        assert(arena.used() <= arena.capacity());
+
+        arena.reset();
+        assert(arena.used() == 0);
+        assert(arena.statistics().bytes_in_use == 0);
+        assert(!arena.owns(all.front().first));
+        if (phase == 0) {
+            capacity = arena.capacity();
+        }
+    }
+    // a steady workload runs out of the chunks of the first phase, give or
+    // take the ones sized for growth.
+    assert(arena.capacity() <= 2 * capacity);
+
+    arena.release();
+    assert(arena.capacity() == 0);
+}
+
+int main() {
+    alignment();
+    deallocate_last();
+    concurrent_phases();
+    std::cout << "concurrent bump allocator: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include "../alloy/epoch_domain.hpp"
+#include "../alloy/fixed_size_allocator.hpp"
+#include "../alloy/slab_allocator.hpp"
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace alloy;
+
+using Pool = FixedSizeAllocator<32, 8, HeapProvider, BasicStats>;
+
+static_assert(EpochDomain<SlabAllocator>::allocator_thread_safe);
+static_assert(!EpochDomain<Pool>::allocator_thread_safe);
+
+static const Layout block = Layout::from_size_align(32, 8).value();
+
+// nothing retired is freed while a thread pinned before the retirement is
+// still pinned.
+void deferred_while_pinned() {
+    Pool pool;
+    {
+        EpochDomain domain(pool, 4);
+        std::atomic<int> stage{ 0 };
+        std::thread reader([&] {
+            auto guard = domain.pin();
+            stage.store(1);
+            while (stage.load() != 2) {
+                std::this_thread::yield();
+            }
+        });
+        while (stage.load() != 1) {
+            std::this_thread::yield();
+        }
+
+        for (int i = 0; i < 16; ++i) {
+            void *p = domain.allocate(block);
+            assert(p);
+            domain.retire(p, block);
+        }
+        for (int i = 0; i < 8; ++i) {
+            domain.collect();
+        }
+        assert(domain.pending() == 16);
+        assert(pool.statistics().frees == 0);
+        // the epoch moves at most once past the reader's.
+        assert(domain.epoch() <= 2);
+
+        stage.store(2);
+        reader.join();
+        for (int i = 0; i < 3; ++i) {
+            domain.collect();
+        }
+        assert(domain.pending() == 0);
+        assert(pool.statistics().frees == 16);
+    }
+}
+
+// pins nest, the thread stays pinned until the outer guard goes.
+void nested_pins() {
+    Pool pool;
+    EpochDomain domain(pool, 1);
+    {
+        auto outer = domain.pin();
+        {
+            auto inner = domain.pin();
+        }
+        void *p = domain.allocate(block);
+        domain.retire(p, block);
+        for (int i = 0; i < 4; ++i) {
+            domain.collect();
+        }
+        // the epoch can't pass our own pin twice.
+        assert(domain.pending() == 1);
+    }
+    for (int i = 0; i < 3; ++i) {
+        domain.collect();
+    }
+    assert(domain.pending() == 0);
+    assert(pool.statistics().frees == 1);
+}
+
+// blocks of exited threads and the ones still waiting are freed by the
+// destructor.
+void destructor_frees_everything() {
+    Pool pool;
+    {
+        EpochDomain domain(pool);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                auto guard = domain.pin();
+                for (int i = 0; i < 10; ++i) {
+                    domain.retire(domain.allocate(block), block);
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        assert(domain.pending() == 40);
+    }
+    auto s = pool.statistics();
+    assert(s.allocations == 40 && s.frees == 40 && s.bytes_in_use == 0);
+}
+
+// scribbles over every block it frees, so a reader that sees a block after
+// it was freed notices.
+struct PoisoningSlab {
+    static constexpr bool thread_safe = true;
+
+    SlabAllocator slab;
+
+    void *allocate(Layout l) noexcept { return slab.allocate(l); }
+    void deallocate(void *p, Layout l) noexcept {
+        std::memset(p, 0xdd, l.size());
+        slab.deallocate(p, l);
+    }
+    bool owns(const void *p) noexcept { return slab.owns(p); }
+    void reset() noexcept { slab.reset(); }
+};
+
+struct Node {
+    uint64_t key;
+    uint64_t check; // ~key while the node is live.
+};
+
+// readers walk slots swapped and retired by writers, and never see a freed
+// node.
+void concurrent_readers_and_writers() {
+    constexpr int n_slots = 8;
+    constexpr int n_readers = 3;
+    constexpr int n_writers = 2;
+    constexpr int n_updates = 20000;
+
+    PoisoningSlab allocator;
+    EpochDomain domain(allocator, 32);
+    std::atomic<Node *> slots[n_slots];
+    auto make = [&](uint64_t key) {
+        auto n = static_cast<Node *>(
+            domain.allocate(Layout::create<Node>().value()));
+        n->key = key;
+        n->check = ~key;
+        return n;
+    };
+    for (int i = 0; i < n_slots; ++i) {
+        slots[i].store(make(i));
+    }
+
+    std::atomic<bool> done{ false };
+    std::atomic<uint64_t> reads{ 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_readers; ++t) {
+        threads.emplace_back([&] {
+            uint64_t n = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                auto guard = domain.pin();
+                for (auto &slot : slots) {
+                    Node *node = slot.load(std::memory_order_acquire);
+                    for (int spin = 0; spin < 8; ++spin) {
+                        assert(node->check == ~node->key);
+                    }
+                    ++n;
+                }
+            }
+            reads.fetch_add(n);
+        });
+    }
+    for (int t = 0; t < n_writers; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < n_updates; ++i) {
+                Node *fresh = make(uint64_t(t) << 32 | i);
+                auto guard = domain.pin();
+                Node *old = slots[(i + t) % n_slots].exchange(
+                    fresh, std::memory_order_acq_rel);
+                domain.retire(old);
+            }
+        });
+    }
+    for (int t = n_readers; t < n_readers + n_writers; ++t) {
+        threads[t].join();
+    }
+    done.store(true);
+    for (int t = 0; t < n_readers; ++t) {
+        threads[t].join();
+    }
+    assert(reads.load() > 0);
+    // nobody is pinned any more, the epoch moves freely.
+    uint64_t e = domain.epoch();
+    bool first = domain.try_advance();
+    bool second = domain.try_advance();
+    assert(first && second);
+    assert(domain.epoch() == e + 2);
+    for (auto &slot : slots) {
+        domain.retire(slot.load());
+    }
+}
+
+int main() {
+    deferred_while_pinned();
+    nested_pins();
+    destructor_frees_everything();
+    concurrent_readers_and_writers();
+    std::cout << "epoch domain: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "../alloy/fixed_size_allocator.hpp"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <vector>
+
+using namespace alloy;
+
+struct A {
+    int a;
+    double b;
+    char c;
+    int d;
+};
+
+struct alignas(64) Timer {
+    uint64_t deadline;
+};
+
+int main(void) {
+    using Pool = FixedSizeAllocatorFor<A>;
+    static_assert(Pool::layout.size() == sizeof(A));
+    static_assert(Pool::layout.align() == alignof(A));
+    static_assert(FixedSizeAllocator<1, 1>::layout.size() == sizeof(void *));
+
+    Pool pool(8);
+    std::vector<void *> blocks;
+    for (int i = 0; i < 100; ++i) {
+        void *p = pool.allocate();
+        assert(p && pool.owns(p));
+        assert(reinterpret_cast<uintptr_t>(p) % alignof(A) == 0);
+        blocks.push_back(p);
+    }
+    assert(std::set<void *>(blocks.begin(), blocks.end()).size() == 100);
+    assert(pool.capacity() == 104);
+    assert(!pool.owns(static_cast<char *>(blocks[0]) + 1));
+
+    // freed blocks are reused before the pool grows.
+    for (void *p : blocks) {
+        pool.deallocate(p);
+    }
+    for (int i = 0; i < 100; ++i) {
+        void *p = pool.allocate();
+        assert(p);
+    }
+    assert(pool.capacity() == 104);
+
+    // layouts that don't fit a block are rejected.
+    void *fits = pool.allocate(Layout::create<A>().value());
+    void *too_large = pool.allocate(Layout::create<Timer>().value());
+    assert(fits && !too_large);
+
+    FixedSizeAllocatorFor<Timer> timers;
+    for (int i = 0; i < 10; ++i) {
+        void *p = timers.allocate(Layout::create<Timer>().value());
+        assert(reinterpret_cast<uintptr_t>(p) % 64 == 0);
+    }
+
+    pool.reset();
+    assert(pool.capacity() == 104);
+    pool.release();
+    assert(pool.capacity() == 0);
+
+    std::cout << "fixed size allocator: ok" << std::endl;
+    return 0;
+}
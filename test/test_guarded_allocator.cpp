@@ -0,0 +1,210 @@
+#include "../alloy/bump_allocator.hpp"
+#include "../alloy/fixed_size_allocator.hpp"
+#include "../alloy/guarded_allocator.hpp"
+#include "../alloy/slab_allocator.hpp"
+#include <cassert>
+#include <csetjmp>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+using namespace alloy;
+
+// records errors instead of aborting.
+struct Recorded {
+    GuardError error;
+    const void *ptr;
+};
+
+static std::vector<Recorded> errors;
+
+struct TestGuards : DebugGuards {
+    static constexpr size_t quarantine = 4;
+
+    static void on_error(GuardError e, const void *ptr, Layout) noexcept {
+        errors.push_back({ e, ptr });
+    }
+};
+
+struct PagedGuards : TestGuards {
+    static constexpr size_t guard_pages_from = 4096;
+};
+
+using Heap = GuardedAllocator<SlabAllocator, TestGuards>;
+
+static_assert(LayoutAllocator<Heap>);
+static_assert(Heap::thread_safe);
+static_assert(!GuardedAllocator<BumpAllocator, TestGuards>::thread_safe);
+// compiled away without guards.
+static_assert(std::is_same_v<Guarded<BumpAllocator, NoGuards>, BumpAllocator>);
+static_assert(std::is_same_v<Guarded<BumpAllocator, TestGuards>,
+                             GuardedAllocator<BumpAllocator, TestGuards>>);
+#if ALLOY_GUARDED
+static_assert(std::is_same_v<Guarded<BumpAllocator>,
+                             GuardedAllocator<BumpAllocator, DebugGuards>>);
+#else
+static_assert(std::is_same_v<Guarded<BumpAllocator>, BumpAllocator>);
+#endif
+
+static bool only(GuardError e, const void *ptr) {
+    bool ok = errors.size() == 1 && errors[0].error == e &&
+              errors[0].ptr == ptr;
+    errors.clear();
+    return ok;
+}
+
+static bool is_aligned(void *p, size_t align) {
+    return reinterpret_cast<uintptr_t>(p) % align == 0;
+}
+
+// correct use reports nothing, blocks keep their alignment and are filled.
+void clean_use() {
+    Heap heap;
+    std::vector<std::pair<void *, Layout>> blocks;
+    for (size_t align : { 1, 8, 16, 64, 256 }) {
+        for (size_t size : { 0, 1, 7, 24, 100, 1000 }) {
+            auto l = Layout::from_size_align(size, align).value();
+            auto p = static_cast<uint8_t *>(heap.allocate(l));
+            assert(p && is_aligned(p, align) && heap.owns(p));
+            for (size_t i = 0; i < size; ++i) {
+                assert(p[i] == TestGuards::alloc_fill);
+            }
+            std::memset(p, 0x11, size);
+            blocks.push_back({ p, l });
+        }
+    }
+    assert(heap.live() == blocks.size() && heap.check() == 0);
+    for (auto [p, l] : blocks) {
+        heap.deallocate(p, l);
+    }
+    assert(heap.live() == 0 && errors.empty());
+}
+
+// writes past either end of a block are caught when it is freed.
+void red_zones() {
+    GuardedAllocator<BumpAllocator, TestGuards> arena;
+    auto l = Layout::from_size_align(24, 8).value();
+    auto a = static_cast<char *>(arena.allocate(l));
+    a[24] = 0; // one past the end, in the layout's tail padding.
+    size_t damaged = arena.check();
+    bool reported = only(GuardError::overflow, a);
+    assert(damaged == 1 && reported);
+    arena.deallocate(a, l);
+    reported = only(GuardError::overflow, a);
+    assert(reported);
+
+    auto b = static_cast<char *>(arena.allocate(l));
+    b[-1] = 0;
+    arena.deallocate(b, l);
+    reported = only(GuardError::underflow, b);
+    assert(reported);
+
+    // the back zone is the layout's padding and `red_zone` more bytes.
+    auto c = static_cast<char *>(arena.allocate(
+        Layout::from_size_align(20, 8).value()));
+    c[24 + TestGuards::red_zone - 1] = 0;
+    arena.deallocate(c, Layout::from_size_align(20, 8).value());
+    reported = only(GuardError::overflow, c);
+    assert(reported);
+}
+
+// double and invalid frees are reported and not forwarded.
+void bad_frees() {
+    using Pool = FixedSizeAllocator<128, 8, HeapProvider, BasicStats>;
+    GuardedAllocator<Pool, TestGuards> pool;
+    auto l = Layout::from_size_align(32, 8).value();
+    void *p = pool.allocate(l);
+    pool.deallocate(p, l);
+    pool.deallocate(p, l);
+    bool reported = only(GuardError::double_free, p);
+    assert(reported);
+
+    int local;
+    pool.deallocate(&local, l);
+    reported = only(GuardError::invalid_free, &local);
+    assert(reported);
+
+    void *q = pool.allocate(l);
+    pool.deallocate(q, Layout::from_size_align(48, 8).value());
+    reported = only(GuardError::layout_mismatch, q);
+    assert(reported);
+
+    // nothing reached the pool twice.
+    auto s = pool.statistics();
+    assert(s.allocations == 2 && s.frees == 0);
+}
+
+// freed blocks are poisoned and held back; a write to one is caught when it
+// leaves the quarantine.
+void quarantine() {
+    using Pool = FixedSizeAllocator<128, 8, HeapProvider, BasicStats>;
+    GuardedAllocator<Pool, TestGuards> pool;
+    auto l = Layout::from_size_align(32, 8).value();
+    auto p = static_cast<uint8_t *>(pool.allocate(l));
+    pool.deallocate(p, l);
+    for (size_t i = 0; i < 32; ++i) {
+        assert(p[i] == TestGuards::free_fill);
+    }
+    p[3] = 0; // use after free.
+    for (size_t i = 0; i < TestGuards::quarantine; ++i) {
+        void *q = pool.allocate(l);
+        assert(q != p);
+        pool.deallocate(q, l);
+    }
+    bool reported = only(GuardError::use_after_free, p);
+    assert(reported);
+    assert(pool.statistics().frees == 1);
+}
+
+static sigjmp_buf fault;
+
+static void on_fault(int) { siglongjmp(fault, 1); }
+
+// whether writing to `p` faults.
+[[gnu::noinline]] static bool faults(volatile char *p) {
+    struct sigaction action = {}, old_segv, old_bus;
+    action.sa_handler = on_fault;
+    sigaction(SIGSEGV, &action, &old_segv);
+    sigaction(SIGBUS, &action, &old_bus);
+    bool faulted = false;
+    if (sigsetjmp(fault, 1) == 0) {
+        *p = 1;
+    } else {
+        faulted = true;
+    }
+    sigaction(SIGSEGV, &old_segv, nullptr);
+    sigaction(SIGBUS, &old_bus, nullptr);
+    return faulted;
+}
+
+// large blocks end against an inaccessible page.
+void guard_pages() {
+    GuardedAllocator<BumpAllocator, PagedGuards> arena;
+    auto l = Layout::from_size_align(10000, 16).value();
+    auto p = static_cast<volatile char *>(arena.allocate(l));
+    assert(p && is_aligned((void *)p, 16));
+    p[0] = 1;
+    p[9999] = 1;
+    // not from the arena.
+    assert(arena.allocator().used() == 0);
+
+    assert(faults(p + 10000)); // the guard page.
+
+    arena.deallocate((void *)p, l);
+    assert(errors.empty());
+    arena.reset();
+    assert(arena.live() == 0);
+}
+
+int main() {
+    clean_use();
+    red_zones();
+    bad_frees();
+    quarantine();
+    guard_pages();
+    std::cout << "guarded allocator: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "../alloy/inline_arena.hpp"
+#include "../alloy/slab_allocator.hpp"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <memory_resource>
+#include <vector>
+
+using namespace alloy;
+
+using Tracked = BasicBumpAllocator<HeapProvider, BasicStats>;
+
+static_assert(LayoutAllocator<inline_arena<256>>);
+
+static Layout bytes(size_t size, size_t align = 8) {
+    return Layout::from_size_align(size, align).value();
+}
+
+int main(void) {
+    {
+        inline_arena<4096, Tracked, 64, BasicStats> arena;
+
+        // small requests never reach the fallback.
+        std::vector<void *> blocks;
+        for (int i = 0; i < 100; ++i) {
+            void *p = arena.allocate(bytes(24));
+            assert(p && arena.owns_inline(p));
+            assert(reinterpret_cast<uintptr_t>(p) % 8 == 0);
+            blocks.push_back(p);
+        }
+        assert(arena.inline_used() == 2400);
+        assert(arena.fallback().statistics().allocations == 0);
+
+        // the last block rolls back, others stay until reset.
+        arena.deallocate(blocks.back(), bytes(24));
+        assert(arena.inline_used() == 2376);
+        arena.deallocate(blocks.front(), bytes(24));
+        assert(arena.inline_used() == 2376);
+
+        // too large for what's left, or too aligned: the fallback serves it.
+        void *big = arena.allocate(bytes(2000));
+        assert(big && !arena.owns_inline(big) && arena.owns(big));
+        void *page = arena.allocate(bytes(64, 4096));
+        assert(page && !arena.owns_inline(page));
+        assert(reinterpret_cast<uintptr_t>(page) % 4096 == 0);
+        assert(arena.fallback().statistics().allocations == 2);
+
+        // the buffer's own alignment is honored inline.
+        void *line = arena.allocate(bytes(64, 64));
+        assert(arena.owns_inline(line));
+        assert(reinterpret_cast<uintptr_t>(line) % 64 == 0);
+
+        AllocatorStats s = arena.statistics();
+        assert(s.allocations == 103 && s.frees == 2);
+
+        arena.reset();
+        assert(arena.inline_used() == 0 && !arena.owns(big));
+        void *whole = arena.allocate(bytes(4096));
+        assert(whole != nullptr);
+        assert(arena.inline_used() == 4096);
+
+        // with the buffer full even an empty block comes from the fallback,
+        // and goes back to it.
+        void *empty = arena.allocate(bytes(0));
+        assert(empty && !arena.owns_inline(empty));
+        arena.deallocate(empty, bytes(0));
+        assert(arena.fallback().statistics().frees == 1);
+        assert(arena.inline_used() == 4096);
+    }
+
+    // as a memory resource for scratch containers.
+    {
+        inline_arena<1024> scratch;
+        MemoryResource resource(scratch);
+        std::pmr::vector<int> v(&resource);
+        v.reserve(64);
+        assert(scratch.owns_inline(v.data()));
+        for (int i = 0; i < 10000; ++i) {
+            v.push_back(i);
+        }
+        assert(!scratch.owns_inline(v.data()) && v[9999] == 9999);
+    }
+
+    // any allocator can stand behind it.
+    {
+        inline_arena<512, SlabAllocator> arena;
+        void *p = arena.allocate(bytes(600));
+        assert(p && arena.fallback().owns(p));
+        arena.deallocate(p, bytes(600));
+    }
+
+    std::cout << "inline arena: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "../alloy/fixed_size_allocator.hpp"
+#include "../alloy/intrusive_list.hpp"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <vector>
+
+using namespace alloy;
+
+struct by_account {};
+
+// an order in its price level and in its account's list.
+struct Order : list_hook<>, list_hook<by_account> {
+    uint64_t id;
+    int64_t qty;
+
+    Order(uint64_t id, int64_t qty)
+        : id(id)
+        , qty(qty) {}
+};
+
+using Level = intrusive_list<Order>;
+using Account = intrusive_list<Order, by_account>;
+
+static_assert(std::bidirectional_iterator<Level::iterator>);
+static_assert(std::bidirectional_iterator<Level::const_iterator>);
+
+static std::vector<uint64_t> ids(const Level &level) {
+    std::vector<uint64_t> v;
+    for (const Order &o : level) {
+        v.push_back(o.id);
+    }
+    return v;
+}
+
+void fifo() {
+    std::vector<Order> orders;
+    for (uint64_t i = 0; i < 5; ++i) {
+        orders.emplace_back(i, 10);
+    }
+    Level level;
+    Order *none = level.pop_front();
+    assert(level.empty() && !level.front() && !none);
+    for (auto &o : orders) {
+        level.push_back(o);
+    }
+    assert(level.size() == 5 && level.front()->id == 0);
+    assert(level.back()->id == 4);
+
+    // cancel from the middle, then fill from the front.
+    auto next = level.erase(orders[2]);
+    assert(next->id == 3 && !orders[2].list_hook<>::is_linked());
+    assert((ids(level) == std::vector<uint64_t>{ 0, 1, 3, 4 }));
+    Order *first = level.pop_front();
+    assert(first->id == 0);
+    level.push_front(orders[2]);
+    level.insert(level.iterator_to(orders[4]), orders[0]);
+    assert((ids(level) == std::vector<uint64_t>{ 2, 1, 3, 0, 4 }));
+    Order *last = level.pop_back();
+    assert(last->id == 4 && level.size() == 4);
+
+    // backwards.
+    std::vector<uint64_t> reversed;
+    for (auto it = level.end(); it != level.begin();) {
+        reversed.push_back((--it)->id);
+    }
+    assert((reversed == std::vector<uint64_t>{ 0, 3, 1, 2 }));
+
+    level.clear();
+    for (auto &o : orders) {
+        assert(!o.list_hook<>::is_linked());
+    }
+}
+
+// every tag is a list of its own.
+void two_lists() {
+    Order a(1, 5), b(2, 6), c(3, 7);
+    Level level;
+    Account account;
+    level.push_back(a);
+    level.push_back(b);
+    level.push_back(c);
+    account.push_back(c);
+    account.push_back(a);
+    level.erase(a);
+    assert(level.size() == 2 && account.size() == 2);
+    assert(account.front() == &c && account.back() == &a);
+    assert(a.list_hook<by_account>::is_linked());
+
+    // copies come unlinked.
+    Order copy = a;
+    assert(!copy.list_hook<>::is_linked());
+    assert(!copy.list_hook<by_account>::is_linked());
+    account.clear();
+    level.clear();
+}
+
+void splice_and_move() {
+    Order o[4] = { { 0, 1 }, { 1, 1 }, { 2, 1 }, { 3, 1 } };
+    Level x, y;
+    x.push_back(o[0]);
+    x.push_back(o[1]);
+    y.push_back(o[2]);
+    y.push_back(o[3]);
+    x.splice(y);
+    assert(y.empty() && x.size() == 4);
+    assert((ids(x) == std::vector<uint64_t>{ 0, 1, 2, 3 }));
+
+    Level z(std::move(x));
+    assert(x.empty() && z.size() == 4);
+    assert(std::distance(z.begin(), z.end()) == 4);
+    x = std::move(z);
+    assert(z.empty() && (ids(x) == std::vector<uint64_t>{ 0, 1, 2, 3 }));
+    x.erase(x.begin());
+    assert(x.front()->id == 1);
+}
+
+// the nodes come from a pool, the list never allocates.
+void pooled_nodes() {
+    FixedSizeAllocatorFor<Order, HeapProvider, BasicStats> pool;
+    Level level;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        level.push_back(*::new (pool.allocate()) Order(i, 1));
+    }
+    assert(pool.statistics().allocations == 1000);
+    uint64_t sum = 0;
+    while (Order *o = level.pop_front()) {
+        sum += o->id;
+        std::destroy_at(o);
+        pool.deallocate(o);
+    }
+    assert(sum == 999 * 1000 / 2 && pool.statistics().bytes_in_use == 0);
+}
+
+int main() {
+    fifo();
+    two_lists();
+    splice_and_move();
+    pooled_nodes();
+    std::cout << "intrusive list: ok" << std::endl;
+    return 0;
+}
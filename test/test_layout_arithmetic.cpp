@@ -0,0 +1,80 @@
+#include "../alloy/memlayout.hpp"
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace alloy;
+
+constexpr size_t max = std::numeric_limits<size_t>::max();
+
+// the portable checks, used in constant evaluation.
+static_assert(checked_add(max - 1, size_t(1)).value() == max);
+static_assert(!checked_add(max, size_t(1)));
+static_assert(checked_mul(size_t(1) << 32, (size_t(1) << 31) + 1).value() ==
+              (size_t(1) << 63) + (size_t(1) << 32));
+static_assert(!checked_mul(size_t(1) << 32, size_t(1) << 32));
+static_assert(!checked_mul(uint32_t(1) << 16, uint32_t(1) << 16));
+static_assert(checked_mul(size_t(0), max).value() == 0);
+
+constexpr std::optional<Layout> fold_ints() {
+    std::array<Layout, 3> fields = { Layout::create<char>().value(),
+                                     Layout::create<int>().value(),
+                                     Layout::create<char>().value() };
+    std::array<size_t, 3> offsets{};
+    return Layout::from_size_align(0, 1)->extend_all(fields, offsets);
+}
+static_assert(fold_ints().value() == Layout::from_size_align(9, 4).value());
+
+// compares the run time paths with the constant evaluated ones.
+static void test_checked(std::mt19937_64 &rng) {
+    for (int i = 0; i < 100000; ++i) {
+        size_t x = rng() >> (rng() % 64), y = rng() >> (rng() % 64);
+        auto add = checked_add(x, y);
+        assert(add.has_value() == (x <= max - y));
+        assert(!add || add.value() == x + y);
+        auto mul = checked_mul(x, y);
+        assert(mul.has_value() == (x == 0 || y <= max / x));
+        assert(!mul || mul.value() == x * y);
+    }
+}
+
+static void test_extend_all(std::mt19937_64 &rng) {
+    std::vector<Layout> fields;
+    for (int i = 0; i < 5000; ++i) {
+        fields.push_back(
+            Layout::from_size_align(rng() % 100, size_t(1) << (rng() % 7))
+                .value());
+    }
+    std::vector<size_t> offsets(fields.size());
+    Layout start = Layout::from_size_align(3, 2).value();
+    auto all = start.extend_all(fields, offsets);
+    assert(all);
+
+    // the same as folding `extend`.
+    Layout acc = start;
+    for (size_t i = 0; i < fields.size(); ++i) {
+        auto [next, offset] = acc.extend(fields[i]).value();
+        assert(offsets[i] == offset);
+        acc = next;
+    }
+    assert(all.value() == acc);
+
+    // overflow anywhere in the chain fails the whole batch.
+    fields[fields.size() / 2] = Layout::from_size_align(max - 64, 1).value();
+    assert(!start.extend_all(fields, offsets));
+    assert(!start.extend_all(fields, std::span(offsets).first(10)));
+    assert(Layout::from_size_align(0, 1)->extend_all({}, {}).value() ==
+           Layout::from_size_align(0, 1).value());
+}
+
+int main(void) {
+    std::mt19937_64 rng(7);
+    test_checked(rng);
+    test_extend_all(rng);
+    std::cout << "layout arithmetic: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "../alloy/layout_builder.hpp"
+#include "../alloy/packed_tuple.hpp"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <random>
+
+using namespace alloy;
+
+struct A {
+    int a;
+    double b;
+    char c;
+    int d;
+};
+
+int main(void) {
+    // the same layout as the compile time description.
+    LayoutBuilder b;
+    b.add<int>().add<double>().add<char>().add<int>();
+    RecordLayout row = b.build().value();
+    constexpr auto expected = layout_of_struct<A>().value();
+    assert(row.layout() == expected.layout && row.size() == 4);
+    for (size_t i = 0; i < 4; ++i) {
+        assert(row[i].offset == expected.fields[i].offset);
+        assert(row[i].padding == expected.fields[i].padding);
+    }
+    assert(row.padding() == expected.padding() &&
+           row.tail_padding() == expected.tail_padding);
+
+    A a{ 1, 2.5, 'c', 4 };
+    assert(*static_cast<double *>(row.field(&a, 1)) == 2.5);
+    assert(*static_cast<const char *>(row.field(&a, 2)) == 'c');
+
+    // reordering matches reordered_layout and keeps field numbers.
+    RecordLayout packed = b.build(LayoutBuilder::Order::min_padding).value();
+    constexpr auto reordered = reordered_layout<int, double, char, int>();
+    assert(packed.layout() == reordered->layout);
+    assert(packed.padding() == reordered->padding());
+    assert(packed.offset(1) == 0 && packed.offset(0) == 8 &&
+           packed.offset(3) == 12 && packed.offset(2) == 16);
+
+    // a schema with thousands of columns.
+    std::mt19937_64 rng(3);
+    LayoutBuilder wide(4000);
+    Layout acc = Layout::from_size_align(0, 1).value();
+    std::vector<size_t> offsets;
+    for (int i = 0; i < 4000; ++i) {
+        size_t align = size_t(1) << (rng() % 4);
+        size_t size = align * (1 + rng() % 4);
+        wide.add(size, align);
+        auto [next, offset] =
+            acc.extend(Layout::from_size_align(size, align).value()).value();
+        offsets.push_back(offset);
+        acc = next;
+    }
+    RecordLayout w = wide.build().value();
+    assert(w.layout() == acc.pad_to_align());
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        assert(w.offset(i) == offsets[i]);
+    }
+    RecordLayout wp = wide.build(LayoutBuilder::Order::min_padding).value();
+    assert(wp.padding() <= w.padding() && wp.padding() < 8);
+    assert(wp.shares_cache_line(0, 0) == false);
+
+    // invalid fields and overflow fail the build.
+    LayoutBuilder bad;
+    bad.add(8, 8).add(4, 3);
+    assert(!bad.build());
+    bad.clear();
+    bad.add(SIZE_MAX - 64, 1).add(128, 8);
+    assert(bad.build() == std::nullopt);
+    assert(LayoutBuilder().build()->layout() ==
+           Layout::from_size_align(0, 1).value());
+
+    std::cout << to_string(row) << std::endl;
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "../alloy/layout_report.hpp"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+using namespace alloy;
+
+struct Order {
+    uint64_t id;
+    char side;
+    int32_t qty;
+    double price;
+    uint16_t venue;
+};
+
+struct OrderV2 {
+    uint64_t id;
+    char side;
+    double price; // moved before qty: 7 bytes of padding after side.
+    int32_t qty;
+    uint16_t venue;
+    uint64_t client;
+    uint64_t tag0, tag1, tag2, tag3; // push the record onto a second line.
+};
+
+static const std::string order_names[] = { "id", "side", "qty", "price",
+                                           "venue" };
+static const std::string v2_names[] = { "id",     "side",  "price", "qty",
+                                        "venue",  "client", "tag0", "tag1",
+                                        "tag2",   "tag3" };
+
+void reports() {
+    LayoutReport r = report_of<Order>("Order", order_names);
+    assert(r.layout == Layout::create<Order>().value());
+    assert(r.fields.size() == 5 && r.fields[3].name == "price");
+    assert(r.fields[3].info.offset == offsetof(Order, price));
+    assert(r.padding() == sizeof(Order) - 8 - 1 - 4 - 8 - 2);
+    assert(r.lines() == 1);
+    // 8 byte aligned, 32 bytes: some placements in an array cross a line.
+    assert(r.worst_lines() == 2);
+    assert(!r.fields[0].straddles());
+
+    // unnamed fields get numbers.
+    LayoutBuilder b;
+    b.add(8, 8).add(1, 1).add(60, 4);
+    LayoutReport row = report_of(b.build().value(), "row");
+    assert(row.fields[2].name == "field 2");
+    assert(row.fields[2].straddles() && row.lines() == 2);
+
+    std::string map = cache_line_map(r);
+    assert(map.find("Order: size 32, align 8") == 0);
+    assert(map.find("|aaaaaaaab...ccccddddddddee......|") !=
+           std::string::npos);
+    assert(map.find("d price") != std::string::npos);
+    assert(cache_line_map(row).find("straddles lines 0-1") !=
+           std::string::npos);
+}
+
+void json_round_trip() {
+    LayoutReport r = report_of<Order>("Order \"v1\"", order_names);
+    std::string json = to_json(r);
+    assert(json.find("\"worst_lines\": 2") != std::string::npos);
+    auto back = layout_report_from_json(json);
+    assert(back);
+    assert(back->name == r.name && back->layout == r.layout);
+    assert(back->tail_padding == r.tail_padding);
+    assert(back->fields.size() == r.fields.size());
+    for (size_t i = 0; i < r.fields.size(); ++i) {
+        assert(back->fields[i].name == r.fields[i].name);
+        assert(back->fields[i].info.offset == r.fields[i].info.offset);
+        assert(back->fields[i].info.padding == r.fields[i].info.padding);
+    }
+    assert(diff_layouts(r, back.value()).empty());
+
+    assert(!layout_report_from_json(""));
+    assert(!layout_report_from_json("{\"name\": \"x\"}"));
+    assert(!layout_report_from_json("{\"size\": 8, \"align\": 3}"));
+    assert(!layout_report_from_json("{\"size\": 8, \"align\": 8} trailing"));
+    auto minimal = layout_report_from_json(
+        "{\"size\": 4, \"align\": 4, \"extra\": [1, {\"a\": null}]}");
+    assert(minimal && minimal->layout.size() == 4 && minimal->fields.empty());
+}
+
+void diffs() {
+    LayoutReport before = report_of<Order>("Order", order_names);
+    LayoutReport after = report_of<OrderV2>("Order", v2_names);
+    LayoutDiff d = diff_layouts(before, after);
+    assert(d.regressed());
+    std::string text = to_string(d);
+    assert(text.find("! cache lines 1 -> 2") != std::string::npos);
+    assert(text.find("  field price offset 16 -> 16") == std::string::npos);
+    assert(text.find("  field qty offset 12 -> 24") != std::string::npos);
+    assert(text.find("field client added") != std::string::npos);
+
+    // shrinking is a change, not a regression.
+    LayoutDiff back = diff_layouts(after, before);
+    assert(!back.empty() && !back.regressed());
+    assert(to_string(diff_layouts(before, before)) == "no layout changes");
+}
+
+void objects() {
+    alignas(64) static char buffer[256];
+    uint64_t *a = reinterpret_cast<uint64_t *>(buffer);
+    auto *b = reinterpret_cast<Order *>(buffer + 48); // crosses a line.
+    SomeHasLayout objects[] = {
+        SomeHasLayout::create(a).value(),
+        SomeHasLayout::create(b).value(),
+        SomeHasLayout::create(buffer + 3, Layout::create<int>().value())
+            .value(),
+    };
+    auto ra = ObjectReport::of(objects[0]);
+    assert(ra.address_align >= 64 && ra.aligned() && ra.lines() == 1);
+    auto rb = ObjectReport::of(objects[1]);
+    assert(rb.address_align == 16 && rb.aligned() && rb.lines() == 2);
+    assert(rb.first_line() == reinterpret_cast<uintptr_t>(buffer));
+    auto rc = ObjectReport::of(objects[2]);
+    assert(rc.address_align == 1 && !rc.aligned());
+
+    std::string json = to_json(std::span<SomeHasLayout>(objects));
+    assert(json.find("\"lines\": 2") != std::string::npos);
+    assert(json.find("\"aligned\": false") != std::string::npos);
+    std::string map = cache_line_map(std::span<SomeHasLayout>(objects));
+    assert(map.find("(MISALIGNED)") != std::string::npos);
+    assert(map.find("|" + std::string(48, '.') + std::string(16, '#') + "|") !=
+           std::string::npos);
+}
+
+int main() {
+    reports();
+    json_round_trip();
+    diffs();
+    objects();
+    std::cout << "layout report: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "../alloy/linked_list_allocator.hpp"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace alloy;
+
+template <FitPolicy Policy> void run(const char *name) {
+    alignas(64) static char region[1 << 20];
+    LinkedListAllocator<Policy> heap(region + 3, sizeof(region) - 3);
+    const size_t capacity = heap.available();
+    assert(heap.free_blocks() == 1);
+
+    struct Block {
+        void *ptr;
+        Layout layout;
+    };
+    std::vector<Block> live;
+    std::mt19937 rng(42);
+    for (int i = 0; i < 20000; ++i) {
+        if (live.empty() || rng() % 3) {
+            auto layout = Layout::from_size_align(1 + rng() % 2000,
+                                                  size_t(1) << (rng() % 8))
+                              .value();
+            if (void *p = heap.allocate(layout)) {
+                assert(heap.owns(p));
+                assert(reinterpret_cast<uintptr_t>(p) % layout.align() == 0);
+                std::memset(p, i & 0xff, layout.size());
+                live.push_back({ p, layout });
+            }
+        } else {
+            size_t k = rng() % live.size();
+            heap.deallocate(live[k].ptr, live[k].layout);
+            live[k] = live.back();
+            live.pop_back();
+        }
+    }
+
+    // freeing everything coalesces back into a single block.
+    for (auto &b : live) {
+        heap.deallocate(b.ptr, b.layout);
+    }
+    assert(heap.free_blocks() == 1);
+    assert(heap.available() == capacity);
+
+    // requests larger than the region fail without touching the heap.
+    void *too_large =
+        heap.allocate(Layout::from_size_align(sizeof(region), 8).value());
+    void *aligned = heap.allocate(
+        Layout::from_size_align(heap.largest_free_block() / 2, 4096).value());
+    assert(!too_large && aligned);
+    heap.reset();
+    assert(heap.available() == capacity);
+
+    std::cout << name << ": ok" << std::endl;
+}
+
+int main(void) {
+    run<FitPolicy::first_fit>("first fit");
+    run<FitPolicy::next_fit>("next fit");
+    run<FitPolicy::best_fit>("best fit");
+
+    LinkedListAllocator<> empty;
+    void *none = empty.allocate(Layout::create<int>().value());
+    assert(!none);
+
+    // a heap owning a region mapped from the kernel.
+    LinkedListAllocator<FitPolicy::first_fit, PageProvider> mapped(1 << 20);
+    assert(mapped.capacity() > (1 << 20) - 64);
+    void *p = mapped.allocate(Layout::from_size_align(4096, 4096).value());
+    assert(p && reinterpret_cast<uintptr_t>(p) % 4096 == 0 && mapped.owns(p));
+    mapped.deallocate(p);
+    assert(mapped.free_blocks() == 1);
+    return 0;
+}
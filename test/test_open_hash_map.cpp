@@ -0,0 +1,155 @@
+#include "../alloy/bump_allocator.hpp"
+#include "../alloy/composite_allocator.hpp"
+#include "../alloy/open_hash_map.hpp"
+#include "../alloy/slab_allocator.hpp"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+using namespace alloy;
+
+// the slab serves small tables, the heap the rest.
+using Heap = Segregator<SlabAllocator::max_size, SlabAllocator,
+                        ProviderAllocator<HeapProvider>>;
+using Map = open_hash_map<uint64_t, uint64_t, Heap>;
+
+static_assert(std::forward_iterator<Map::iterator>);
+static_assert(std::forward_iterator<Map::const_iterator>);
+
+// counts the allocations that reach the heap.
+struct Counting : Heap {
+    size_t allocations = 0;
+    void *allocate(Layout l) noexcept {
+        ++allocations;
+        return Heap::allocate(l);
+    }
+};
+
+void basic() {
+    Heap heap;
+    Map m(heap);
+    bool erased = m.erase(1);
+    assert(m.empty() && !m.find(1) && !erased && m.capacity() == 0);
+    auto [v, inserted] = m.try_emplace(1, 10);
+    assert(inserted && *v == 10 && m.size() == 1);
+    auto [w, again] = m.try_emplace(1, 20);
+    assert(!again && w == v && *w == 10);
+    auto [u, added] = m.insert_or_assign(1, 30);
+    assert(!added && u == v && *m.find(1) == 30);
+    m[2] += 5;
+    assert(m.size() == 2 && *m.find(2) == 5 && m.contains(2));
+    erased = m.erase(1);
+    assert(erased && !m.contains(1) && m.size() == 1);
+
+    size_t n = 0;
+    for (auto &e : m) {
+        assert(e.key == 2 && e.value == 5);
+        ++n;
+    }
+    assert(n == 1);
+}
+
+// matches std::unordered_map through random inserts and erases, including
+// long probe runs across the end of the table.
+void against_reference() {
+    Heap heap;
+    Map m(heap);
+    std::unordered_map<uint64_t, uint64_t> reference;
+    std::mt19937_64 rng(7);
+    for (int i = 0; i < 200000; ++i) {
+        uint64_t key = rng() % 5000;
+        // keys that differ in their high bits only.
+        if (i % 3 == 0) {
+            key <<= 40;
+        }
+        if (rng() % 3) {
+            m.insert_or_assign(key, i);
+            reference[key] = i;
+        } else {
+            bool erased = m.erase(key);
+            bool expected = reference.erase(key) == 1;
+            assert(erased == expected);
+        }
+        assert(m.size() == reference.size());
+    }
+    for (auto &[k, v] : reference) {
+        assert(m.find(k) && *m.find(k) == v);
+    }
+    assert(size_t(std::distance(m.begin(), m.end())) == m.size());
+    for (const auto &e : std::as_const(m)) {
+        assert(reference.at(e.key) == e.value);
+    }
+    assert(m.size() <= m.capacity() - m.capacity() / 8);
+}
+
+// sized up front, the map takes one block and never allocates again.
+void reserved() {
+    Counting heap;
+    open_hash_map<uint64_t, uint64_t, Counting> m(heap);
+    m.reserve(10000);
+    size_t capacity = m.capacity();
+    assert(heap.allocations == 1 && capacity >= 10000);
+    assert(m.table_bytes() >= capacity * (1 + 2 * sizeof(uint64_t)));
+    for (int round = 0; round < 3; ++round) {
+        for (uint64_t i = 0; i < 10000; ++i) {
+            m.try_emplace(i * 7919, i);
+        }
+        for (uint64_t i = 0; i < 10000; i += 2) {
+            bool erased = m.erase(i * 7919);
+            assert(erased);
+        }
+    }
+    assert(heap.allocations == 1 && m.capacity() == capacity);
+    m.clear();
+    assert(m.empty() && m.capacity() == capacity);
+}
+
+// values with destructors and keys needing `Eq`, from an arena.
+void owned_values() {
+    BumpAllocator arena;
+    open_hash_map<std::string, std::unique_ptr<int>, BumpAllocator> m(arena);
+    for (int i = 0; i < 100; ++i) {
+        m.try_emplace(std::to_string(i), std::make_unique<int>(i));
+    }
+    assert(**m.find("42") == 42);
+    for (int i = 0; i < 100; i += 3) {
+        bool erased = m.erase(std::to_string(i));
+        assert(erased);
+    }
+    assert(m.size() == 66 && !m.find("99") && **m.find("98") == 98);
+
+    auto moved = std::move(m);
+    assert(m.empty() && moved.size() == 66 && **moved.find("1") == 1);
+}
+
+// values of the map inserted again as the table grows. Tables straight from
+// the heap, for the sanitizers to see them freed.
+void aliased_inserts() {
+    ProviderAllocator<HeapProvider> heap;
+    open_hash_map<uint64_t, std::string, decltype(heap)> m(heap);
+    m.try_emplace(0, std::string(100, 'v'));
+    for (uint64_t k = 1; k < 1000; ++k) {
+        size_t capacity = m.capacity();
+        m.try_emplace(k, *m.find(k % 2 ? k - 1 : 0));
+        assert(*m.find(k) == std::string(100, 'v'));
+        if (m.capacity() != capacity) {
+            assert(*m.find(0) == *m.find(k));
+        }
+    }
+    assert(m.size() == 1000);
+}
+
+int main() {
+    basic();
+    against_reference();
+    reserved();
+    owned_values();
+    aliased_inserts();
+    std::cout << "open hash map: ok" << std::endl;
+    return 0;
+}
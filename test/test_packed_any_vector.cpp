@@ -0,0 +1,116 @@
+#include "../alloy/packed_any_vector.hpp"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+
+using namespace alloy;
+
+struct alignas(64) Tick {
+    uint64_t time;
+    double price;
+};
+
+struct Counted {
+    static inline int live = 0;
+    int value;
+    explicit Counted(int v) noexcept
+        : value(v) {
+        ++live;
+    }
+    Counted(Counted &&o) noexcept
+        : value(o.value) {
+        ++live;
+    }
+    ~Counted() { --live; }
+};
+
+static bool is_aligned(const void *p, size_t align) {
+    return reinterpret_cast<uintptr_t>(p) % align == 0;
+}
+
+int main(void) {
+    packed_any_vector v;
+
+    // elements only pay the padding their own alignment needs.
+    v.emplace_back<char>('a');
+    v.emplace_back<int>(7);
+    v.emplace_back<char>('b');
+    v.emplace_back<double>(2.5);
+    assert(v.size() == 4 && v.bytes() == 24);
+    assert(v.offset(1) == 4 && v.offset(2) == 8 && v.offset(3) == 16);
+
+    v.push_back(std::string("a string long enough to allocate"));
+    v.emplace_back<Tick>(Tick{ 10, 99.5 });
+    v.emplace_back<std::unique_ptr<int>>(std::make_unique<int>(42));
+    for (int i = 0; i < 1000; ++i) {
+        v.emplace_back<Counted>(i);
+        v.emplace_back<uint16_t>(static_cast<uint16_t>(i));
+    }
+    assert(Counted::live == 1000);
+
+    // growth kept every element in place and aligned.
+    for (size_t i = 0; i < v.size(); ++i) {
+        assert(is_aligned(v.data(i), v.layout(i).align()));
+    }
+    assert(v.get<char>(0) == 'a' && v.get<int>(1) == 7);
+    assert(v.get<char>(2) == 'b' && v.get<double>(3) == 2.5);
+    assert(v.get<std::string>(4) == "a string long enough to allocate");
+    assert(v.get<Tick>(5).price == 99.5);
+    assert(*v.get<std::unique_ptr<int>>(6) == 42);
+    assert(v.get<Counted>(7 + 2 * 500).value == 500);
+    assert(v.get<uint16_t>(8 + 2 * 999) == 999);
+
+    // typed access is checked.
+    assert(v.holds<int>(1) && !v.holds<long>(1));
+    assert(v.get_if<float>(3) == nullptr);
+    bool threw = false;
+    try {
+        v.get<std::string>(0);
+    } catch (const std::bad_any_cast &) {
+        threw = true;
+    }
+    assert(threw);
+    assert(v.type(4) == typeid(std::string));
+
+    // erased views carry the layout of each element.
+    size_t n = 0, tick_index = 0;
+    for (auto it = v.begin(); it != v.end(); ++it, ++n) {
+        SomeHasLayout e = *it;
+        assert(e.ptr() == v.data(n));
+        if (e.layout().align() == 64) {
+            tick_index = it.index();
+        }
+    }
+    assert(n == v.size() && tick_index == 5);
+
+    // pop_back gives the tail bytes back.
+    size_t bytes = v.bytes();
+    v.emplace_back<Tick>(Tick{});
+    v.pop_back();
+    assert(v.bytes() == bytes);
+
+    packed_any_vector moved = std::move(v);
+    assert(v.empty() && moved.size() == 2007);
+    moved.clear();
+    assert(Counted::live == 0 && moved.bytes() == 0);
+
+    // an element of the vector appended again while the buffer grows.
+    {
+        packed_any_vector strings;
+        strings.push_back(std::string(100, 's'));
+        while (strings.bytes() + sizeof(std::string) <= strings.capacity()) {
+            strings.push_back(std::string("filler"));
+        }
+        size_t full = strings.capacity();
+        strings.push_back(strings.get<std::string>(0));
+        assert(strings.capacity() > full);
+        assert(strings.get<std::string>(strings.size() - 1) ==
+               std::string(100, 's'));
+        assert(strings.get<std::string>(0) == std::string(100, 's'));
+    }
+
+    std::cout << "packed any vector: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "../alloy/bump_allocator.hpp"
+#include "../alloy/page_provider.hpp"
+#include "../alloy/slab_allocator.hpp"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace alloy;
+
+// while set, mappings come back page aligned but never huge page aligned,
+// which is all mmap promises.
+static bool skew = false;
+static size_t skewed = 0;
+
+extern "C" void *mmap(void *addr, size_t len, int prot, int flags, int fd,
+                      off_t offset) {
+    auto map = [&](size_t n) {
+        return reinterpret_cast<void *>(
+            syscall(SYS_mmap, addr, n, prot, flags, fd, offset));
+    };
+    if (!skew || addr != nullptr || (flags & MAP_HUGETLB)) {
+        return map(len);
+    }
+    constexpr size_t huge = PageProvider::huge_page_size;
+    void *raw = map(len + huge);
+    if (raw == MAP_FAILED) {
+        return raw;
+    }
+    auto begin = reinterpret_cast<uintptr_t>(raw);
+    auto p = align_up(begin, huge) + PageProvider::page_size();
+    if (p != begin) {
+        munmap(raw, p - begin);
+    }
+    if (begin + huge != p) {
+        munmap(reinterpret_cast<void *>(p + len), begin + huge - p);
+    }
+    ++skewed;
+    return reinterpret_cast<void *>(p);
+}
+
+static bool is_aligned(void *p, size_t align) {
+    return reinterpret_cast<uintptr_t>(p) % align == 0;
+}
+
+// every byte of the chunk is mapped and the chunk has its alignment.
+static void check_chunk(PageProvider &pages, Layout layout) {
+    void *p = pages.allocate_chunk(layout);
+    assert(p != nullptr);
+    assert(is_aligned(p, std::max(layout.align(), pages.granularity())));
+    size_t size = align_up(layout.size(), pages.granularity());
+    std::memset(p, 0xab, size);
+    pages.deallocate_chunk(p, layout);
+}
+
+void aligned_chunks() {
+    using HugePages = PageProvider::HugePages;
+    for (auto huge : { HugePages::none, HugePages::transparent,
+                       HugePages::explicit_pages }) {
+        PageProvider pages({ .huge_pages = huge });
+        check_chunk(pages, Layout::from_size_align(100, 8).value());
+        check_chunk(pages, Layout::from_size_align(1 << 16, 1 << 16).value());
+        check_chunk(pages, Layout::from_size_align(3 << 20, 4 << 20).value());
+    }
+}
+
+// allocators over huge page chunks use them up to the last byte.
+void allocators() {
+    PageProvider pages({ .huge_pages = PageProvider::HugePages::transparent });
+    BasicSlabAllocator<PageProvider> slabs(pages);
+    auto layout = Layout::from_size_align(4096, 4096).value();
+    for (int i = 0; i < 1000; ++i) {
+        void *p = slabs.allocate(layout);
+        assert(p != nullptr && is_aligned(p, 4096));
+        std::memset(p, 0xcd, layout.size());
+    }
+
+    BasicBumpAllocator<PageProvider> arena(1 << 16, pages);
+    auto big = Layout::from_size_align(200000, 64).value();
+    for (int i = 0; i < 50; ++i) {
+        void *p = arena.allocate(big);
+        assert(p != nullptr && arena.owns(p));
+        std::memset(p, 0xef, big.size());
+    }
+}
+
+int main() {
+    skew = true;
+    aligned_chunks();
+    allocators();
+    skew = false;
+    assert(skewed > 0);
+    std::cout << "page provider: ok" << std::endl;
+    return 0;
+}
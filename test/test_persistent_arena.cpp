@@ -0,0 +1,142 @@
+#include "../alloy/persistent_arena.hpp"
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <new>
+#include <string>
+
+using namespace alloy;
+
+struct Node {
+    uint64_t value;
+    offset_ptr<Node> next;
+};
+
+struct List {
+    offset_ptr<Node> head;
+    uint64_t size;
+};
+
+template <typename Arena> static List *build(Arena &arena, uint64_t n) {
+    auto list = ::new (arena.allocate(Layout::create<List>().value())) List{};
+    for (uint64_t i = 0; i < n; ++i) {
+        auto node = ::new (arena.allocate(Layout::create<Node>().value()))
+            Node{ i, list->head };
+        list->head = node;
+        ++list->size;
+    }
+    arena.set_root(list);
+    return list;
+}
+
+static uint64_t sum(const List *list) {
+    uint64_t s = 0, n = 0;
+    for (const Node *p = list->head; p; p = p->next) {
+        s += p->value;
+        ++n;
+    }
+    assert(n == list->size);
+    return s;
+}
+
+static void test_offset_ptr() {
+    int values[4] = { 1, 2, 3, 4 };
+    offset_ptr<int> p = values;
+    assert(*p == 1 && p[2] == 3);
+
+    // a copy elsewhere still points at the same object.
+    auto copy = new offset_ptr<int>(p);
+    assert(copy->get() == values && *copy == p);
+    ++*copy;
+    assert(**copy == 2 && *copy - p == 1 && p < *copy);
+    delete copy;
+
+    offset_ptr<int> null;
+    assert(!null && null == nullptr && null.get() == nullptr);
+    offset_ptr<const int> c = p;
+    assert(c.get() == values);
+}
+
+static void test_arena(const std::string &path) {
+    {
+        auto arena = PersistentArena::create(path, 1 << 20).value();
+        List *list = build(arena, 1000);
+        assert(sum(list) == 999 * 1000 / 2);
+
+        // only the last allocation rolls back.
+        size_t used = arena.used();
+        void *p = arena.allocate(Layout::from_size_align(100, 64).value());
+        assert(reinterpret_cast<uintptr_t>(p) % 64 == 0);
+        arena.deallocate(p, Layout::from_size_align(100, 64).value());
+        assert(arena.used() <= used + 64 && arena.owns(list));
+        void *too_large =
+            arena.allocate(Layout::from_size_align(2 << 20, 8).value());
+        bool synced = arena.sync();
+        assert(too_large == nullptr && synced);
+    }
+
+    // both mappings are live, so the second one is at another address.
+    auto first = PersistentArena::open(path).value();
+    auto second = PersistentArena::open(path).value();
+    assert(first.base() != second.base());
+    assert(sum(second.root<List>()) == 999 * 1000 / 2);
+
+    // writes through one mapping are seen through the other.
+    List *list = first.root<List>();
+    list->head->value = 1000000;
+    assert(second.root<List>()->head->value == 1000000);
+
+    second.reset();
+    assert(second.root() == nullptr && first.used() == 0);
+
+    assert(!PersistentHeap<>::open(path));
+}
+
+static void test_heap(const std::string &path) {
+    size_t available = 0;
+    {
+        auto heap = PersistentHeap<FitPolicy::best_fit>::create(path, 1 << 20)
+                        .value();
+        size_t empty = heap.available();
+        List *list = build(heap, 1000);
+
+        // unlink and free every odd node.
+        for (Node *p = list->head; p && p->next; p = p->next) {
+            Node *odd = p->next;
+            p->next = odd->next;
+            heap.deallocate(odd);
+            --list->size;
+        }
+        assert(heap.heap().free_blocks() > 1 &&
+               heap.available() < empty);
+        available = heap.available();
+    }
+
+    auto heap = PersistentHeap<FitPolicy::best_fit>::open(path).value();
+    List *list = heap.root<List>();
+    assert(list->size == 500 && heap.available() == available);
+    assert(sum(list) == 2 * (499 * 500 / 2) + 500);
+
+    // freed blocks are reused after reopening.
+    void *p = heap.allocate(Layout::create<Node>().value());
+    assert(heap.owns(p) && heap.available() < available);
+
+    // a damaged block chain is refused.
+    reinterpret_cast<uint64_t *>(heap.base() +
+                                 details::persistent_data_offset)[0] = 3;
+    assert(!PersistentHeap<FitPolicy::best_fit>::open(path));
+}
+
+int main(void) {
+    std::string path = "/tmp/alloy_persistent_arena_" +
+                       std::to_string(getpid()) + ".bin";
+    test_offset_ptr();
+    test_arena(path);
+    test_heap(path);
+    assert(!PersistentArena::open("/nonexistent/arena.bin"));
+    std::remove(path.c_str());
+
+    std::cout << "persistent arena: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "../alloy/record_file.hpp"
+#include <cassert>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include <sys/resource.h>
+
+using namespace alloy;
+
+struct Tick {
+    uint64_t time;
+    double price;
+    uint32_t volume;
+    char side;
+};
+
+// same size as Tick, different fields.
+struct Quote {
+    uint64_t time;
+    double bid;
+    uint32_t size;
+    uint16_t venue;
+};
+
+static_assert(sizeof(Tick) == sizeof(Quote));
+static_assert(RecordWriter<Tick>::data_offset % 64 == 0);
+
+int main(void) {
+    auto path = std::filesystem::temp_directory_path() / "alloy_ticks.bin";
+
+    {
+        auto w = RecordWriter<Tick>::create(path, 16);
+        assert(w);
+        std::vector<Tick> batch;
+        for (uint32_t i = 0; i < 1000; ++i) {
+            batch.push_back({ i, i * 0.25, i * 10, i % 2 ? 'b' : 's' });
+        }
+        bool appended = w->append(Tick{ 0, -1.0, 0, 'x' });
+        assert(appended);
+        appended = w->append(batch);
+        assert(appended && w->size() == 1001);
+        bool finished = w->finish();
+        assert(finished);
+    }
+    assert(std::filesystem::file_size(path) ==
+           RecordWriter<Tick>::data_offset + 1001 * sizeof(Tick));
+
+    // records are used in place in the mapping.
+    {
+        auto r = RecordReader<Tick>::open(path);
+        assert(r && r->size() == 1001);
+        assert(r->records()[0].price == -1.0);
+        double sum = 0;
+        for (const Tick &t : r->records().subspan(1)) {
+            sum += t.price;
+        }
+        assert(sum == 0.25 * 999 * 1000 / 2);
+        assert((*r)[1000].side == 'b' && (*r)[1000].volume == 9990);
+    }
+
+    // a file that can't grow keeps the records written so far.
+    {
+        std::signal(SIGXFSZ, SIG_IGN);
+        rlimit limit;
+        getrlimit(RLIMIT_FSIZE, &limit);
+        rlimit small = limit;
+        small.rlim_cur = 64 * 1024;
+        setrlimit(RLIMIT_FSIZE, &small);
+
+        auto w = RecordWriter<Tick>::create(path, 1000);
+        assert(w);
+        std::vector<Tick> batch(10000, Tick{ 1, 2.0, 3, 'b' });
+        bool appended = w->append(batch);
+        assert(!appended && w->size() == 0);
+        for (uint32_t i = 0; i < 1000; ++i) {
+            appended = w->append(Tick{ i, 0.5, i, 's' });
+            assert(appended);
+        }
+        appended = w->append(batch);
+        assert(!appended && w->size() == 1000);
+        assert(w->bytes().size() ==
+               RecordWriter<Tick>::data_offset + 1000 * sizeof(Tick));
+
+        setrlimit(RLIMIT_FSIZE, &limit);
+        bool finished = w->finish();
+        assert(finished);
+        auto r = RecordReader<Tick>::open(path);
+        assert(r && r->size() == 1000 && (*r)[999].volume == 999);
+    }
+
+    // a type with another layout is refused.
+    assert(!RecordReader<Quote>::open(path));
+    assert(!RecordReader<uint64_t>::open(path));
+    assert(!RecordReader<Tick>::open(path.string() + ".missing"));
+
+    // the same format in a memory buffer.
+    RecordWriter<double> w;
+    for (int i = 0; i < 100; ++i) {
+        bool appended = w.append(i * 1.5);
+        assert(appended);
+    }
+    auto bytes = w.bytes();
+    auto r = RecordReader<double>::view(bytes);
+    assert(r && r->size() == 100 && (*r)[99] == 99 * 1.5);
+    assert(r->begin() ==
+           reinterpret_cast<const double *>(bytes.data() +
+                                            RecordWriter<double>::data_offset));
+
+    // truncated or misaligned buffers are refused.
+    assert(!RecordReader<double>::view(bytes.first(bytes.size() - 1)));
+    assert(!RecordReader<double>::view(bytes.first(100)));
+    std::vector<std::byte> shifted(bytes.size() + 1);
+    std::copy(bytes.begin(), bytes.end(), shifted.begin() + 1);
+    assert(!RecordReader<double>::view({ shifted.data() + 1, bytes.size() }));
+
+    auto header = RecordReader<Tick>::header_of(w.bytes());
+    assert(header && header->field_count == 1 && header->record_count == 100);
+
+    std::filesystem::remove(path);
+    std::cout << "record file: ok" << std::endl;
+    return 0;
+}
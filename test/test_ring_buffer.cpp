@@ -0,0 +1,180 @@
+#include "../alloy/composite_allocator.hpp"
+#include "../alloy/ring_buffer.hpp"
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace alloy;
+
+using Heap = ProviderAllocator<HeapProvider>;
+
+// counts live instances, throws when built from a negative number.
+struct Tracked {
+    static inline int live = 0;
+    int value;
+
+    explicit Tracked(int v)
+        : value(v) {
+        if (v < 0) {
+            throw std::invalid_argument("negative");
+        }
+        ++live;
+    }
+    Tracked(Tracked &&other) noexcept
+        : value(other.value) {
+        ++live;
+    }
+    ~Tracked() { --live; }
+};
+
+template <typename Ring> void fills_and_drains() {
+    Heap heap;
+    {
+        Ring ring(heap, 5);
+        assert(ring.capacity() == 8 && ring.empty());
+        for (int i = 0; i < 8; ++i) {
+            bool pushed = ring.try_emplace(i);
+            assert(pushed);
+        }
+        bool pushed = ring.try_emplace(8);
+        assert(!pushed && ring.size() == 8);
+        for (int i = 0; i < 3; ++i) {
+            auto v = ring.try_pop();
+            assert(v->value == i);
+        }
+        // wraps around.
+        for (int i = 8; i < 11; ++i) {
+            pushed = ring.try_emplace(i);
+            assert(pushed);
+        }
+        pushed = ring.try_emplace(11);
+        assert(!pushed);
+        for (int i = 3; i < 11; ++i) {
+            auto v = ring.try_pop();
+            assert(v->value == i);
+        }
+        auto none = ring.try_pop();
+        assert(!none && Tracked::live == 0);
+
+        // a throwing constructor leaves the ring as it was.
+        bool thrown = false;
+        try {
+            ring.try_emplace(-1);
+        } catch (const std::invalid_argument &) {
+            thrown = true;
+        }
+        assert(thrown && ring.empty());
+        bool first = ring.try_emplace(1);
+        bool second = ring.try_emplace(2);
+        assert(first && second);
+    }
+    // values left in the ring are destroyed with it.
+    assert(Tracked::live == 0);
+}
+
+// records what reaches the heap.
+struct Recording : Heap {
+    size_t allocations = 0;
+    Layout last;
+    void *allocate(Layout l) noexcept {
+        ++allocations;
+        last = l;
+        return Heap::allocate(l);
+    }
+};
+
+// the slots are one block from the allocator, on whole cache lines.
+void one_block() {
+    Recording heap;
+    {
+        mpmc_ring<uint64_t, Recording> ring(heap, 64);
+        // a sequence number and a value per cell.
+        assert(heap.allocations == 1 && heap.last.size() == 64 * 16);
+        assert(heap.last.align() == cache_line_size);
+        for (int i = 0; i < 1000; ++i) {
+            bool pushed = ring.try_push(i);
+            auto v = ring.try_pop();
+            assert(pushed && v == uint64_t(i));
+        }
+        spsc_ring<uint32_t, Recording> spsc(heap, 100);
+        assert(spsc.capacity() == 128 && heap.last.size() == 128 * 4);
+        assert(heap.allocations == 2);
+    }
+    assert(heap.allocations == 2);
+}
+
+void spsc_threads() {
+    constexpr uint64_t n = 200000;
+    Heap heap;
+    spsc_ring<uint64_t, Heap> ring(heap, 64);
+    std::thread producer([&] {
+        for (uint64_t i = 0; i < n;) {
+            if (ring.try_push(i)) {
+                ++i;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (uint64_t expected = 0; expected < n;) {
+        if (auto v = ring.try_pop()) {
+            assert(*v == expected);
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    assert(ring.empty());
+}
+
+void mpmc_threads() {
+    constexpr int n_threads = 3;
+    constexpr uint64_t n = 50000;
+    Heap heap;
+    mpmc_ring<uint64_t, Heap> ring(heap, 128);
+    std::atomic<uint64_t> popped{ 0 }, sum{ 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t) {
+        threads.emplace_back([&, t] {
+            for (uint64_t i = 0; i < n;) {
+                if (ring.try_push(uint64_t(t) * n + i)) {
+                    ++i;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        threads.emplace_back([&] {
+            while (popped.load() < n_threads * n) {
+                if (auto v = ring.try_pop()) {
+                    sum += *v;
+                    ++popped;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    uint64_t total = n_threads * n;
+    assert(popped == total && sum == total * (total - 1) / 2);
+    assert(ring.empty());
+}
+
+int main() {
+    fills_and_drains<spsc_ring<Tracked, Heap>>();
+    fills_and_drains<mpmc_ring<Tracked, Heap>>();
+    one_block();
+    spsc_threads();
+    mpmc_threads();
+    std::cout << "ring buffer: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "../alloy/slab_allocator.hpp"
+#include <barrier>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace alloy;
+
+struct A {
+    int a;
+    double b;
+    char c;
+    int d;
+};
+
+int main(void) {
+    // classes keep both the size and the alignment of the layout.
+    static_assert(SlabAllocator::class_of(Layout::create<char>().value()) == 0);
+    static_assert(SlabAllocator::size_classes[SlabAllocator::class_of(
+                      Layout::create<A>().value())] == 32);
+    static_assert(SlabAllocator::size_classes[SlabAllocator::class_of(
+                      Layout::from_size_align(80, 64).value())] == 128);
+    static_assert(SlabAllocator::class_of(
+                      Layout::from_size_align(10000, 8).value()) ==
+                  SlabAllocator::npos);
+    static_assert(SlabAllocator::class_of(Layout()) == SlabAllocator::npos);
+
+    SlabAllocator slab;
+    void *invalid = slab.allocate(Layout());
+    assert(invalid == nullptr);
+
+    for (size_t size = 1; size <= SlabAllocator::max_size; size += 37) {
+        for (size_t align = 1; align <= 256; align *= 4) {
+            auto l = Layout::from_size_align(size, align).value();
+            void *p = slab.allocate(l);
+            assert(p && slab.owns(p));
+            assert(reinterpret_cast<uintptr_t>(p) % align == 0);
+            std::memset(p, 0xab, size);
+            slab.deallocate(p, l);
+        }
+    }
+
+    // objects allocated on one thread and freed on another go back to the
+    // owning slab, which drains them once it runs out of objects.
+    constexpr size_t n_threads = 4;
+    constexpr size_t n_objects = 20000;
+    auto la = Layout::create<A>().value();
+    size_t cls = SlabAllocator::class_of(la);
+    std::vector<std::vector<A *>> handoff(n_threads);
+    std::vector<size_t> slabs(n_threads);
+    std::barrier sync(n_threads + 1);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < n_threads; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = 0; i < n_objects; ++i) {
+                auto p = static_cast<A *>(slab.allocate(la));
+                assert(p);
+                p->a = static_cast<int>(i);
+                handoff[t].push_back(p);
+            }
+            sync.arrive_and_wait();
+            for (A *p : handoff[(t + 1) % n_threads]) {
+                slab.deallocate(p, la);
+            }
+            sync.arrive_and_wait();
+            sync.arrive_and_wait();
+            for (size_t i = 0; i < n_objects; ++i) {
+                void *p = slab.allocate(la);
+                assert(p);
+            }
+        });
+    }
+    sync.arrive_and_wait();
+    sync.arrive_and_wait();
+    size_t before = slab.stats()[cls].slabs;
+    sync.arrive_and_wait();
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    auto stats = slab.stats()[cls];
+    std::cout << to_string(stats) << std::endl;
+    assert(stats.in_use() == n_objects * n_threads);
+    assert(stats.frees == n_objects * n_threads);
+    assert(stats.slabs == before);
+
+    slab.reset();
+    assert(slab.stats()[SlabAllocator::class_of(la)].slabs == 0);
+
+    std::cout << "slab allocator: ok" << std::endl;
+    return 0;
+}
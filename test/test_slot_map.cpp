@@ -0,0 +1,111 @@
+#include "../alloy/slot_map.hpp"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+using namespace alloy;
+
+static_assert(sizeof(slot_map<int>::handle) == 8);
+static_assert(sizeof(slot_map<int, uint16_t>::handle) == 4);
+
+struct alignas(32) Entity {
+    uint64_t id;
+    double x, y;
+};
+
+int main(void) {
+    slot_map<std::string> names;
+    auto a = names.insert("alice");
+    auto b = names.insert("bob");
+    auto c = names.emplace(3, 'c');
+    assert(names.size() == 3 && *names.get(b) == "bob" && names[c] == "ccc");
+
+    // erasing moves the last value into the hole, handles stay valid.
+    bool erased = names.erase(a);
+    assert(erased);
+    erased = names.erase(a);
+    assert(!erased && names.get(a) == nullptr && !names.contains(a));
+    assert(names.size() == 2 && names.data()[0] == "ccc");
+    assert(*names.get(b) == "bob" && *names.get(c) == "ccc");
+
+    // a reused slot doesn't revive old handles.
+    auto d = names.insert("dave");
+    assert(d.index == a.index && d.generation != a.generation);
+    assert(names.get(a) == nullptr && *names.get(d) == "dave");
+    assert(!names.contains(slot_map<std::string>::handle{}));
+
+    // iteration covers live values only.
+    std::string all;
+    for (const auto &n : names) {
+        all += n;
+    }
+    assert(all.size() == 3 + 3 + 4);
+    assert(names.handle_of(0) == c);
+
+    // against a reference map under random churn, with over aligned values.
+    std::mt19937_64 rng(22);
+    slot_map<Entity> entities;
+    std::unordered_map<uint64_t, slot_map<Entity>::handle> ref;
+    std::vector<slot_map<Entity>::handle> dead;
+    for (uint64_t id = 0; id < 50000; ++id) {
+        if (ref.empty() || rng() % 3) {
+            ref[id] = entities.insert({ id, double(id), 0 });
+        } else {
+            auto it = ref.begin();
+            std::advance(it, rng() % std::min<size_t>(ref.size(), 8));
+            bool erased = entities.erase(it->second);
+            assert(erased);
+            dead.push_back(it->second);
+            ref.erase(it);
+        }
+    }
+    assert(entities.size() == ref.size());
+    for (auto &[id, h] : ref) {
+        assert(entities.get(h) && entities.get(h)->id == id);
+        assert(reinterpret_cast<uintptr_t>(entities.get(h)) % 32 == 0);
+    }
+    for (auto h : dead) {
+        assert(!entities.contains(h));
+    }
+    size_t n = 0;
+    for (const Entity &e : entities) {
+        assert(ref.count(e.id));
+        ++n;
+    }
+    assert(n == ref.size());
+
+    // values are destroyed on clear and by the destructor.
+    auto token = std::make_shared<int>(0);
+    {
+        slot_map<std::shared_ptr<int>, uint16_t> owners;
+        for (int i = 0; i < 100; ++i) {
+            owners.insert(token);
+        }
+        owners.erase(owners.handle_of(10));
+        assert(token.use_count() == 100);
+        slot_map<std::shared_ptr<int>, uint16_t> moved = std::move(owners);
+        assert(owners.empty() && moved.size() == 99);
+    }
+    assert(token.use_count() == 1);
+
+    // a value of the map inserted again while the map grows.
+    {
+        slot_map<std::string> copies;
+        auto first = copies.insert(std::string(100, 'x'));
+        while (copies.size() < copies.capacity()) {
+            copies.insert("filler");
+        }
+        size_t full = copies.capacity();
+        auto again = copies.insert(copies[first]);
+        assert(copies.capacity() > full);
+        assert(copies[again] == std::string(100, 'x'));
+        assert(copies[first] == copies[again]);
+    }
+
+    std::cout << "slot map: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "../alloy/soa_vector.hpp"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+using namespace alloy;
+
+// counts live instances, throws when built or copied from a negative value.
+struct Tracked {
+    static inline int live = 0;
+    int value;
+
+    Tracked(int v)
+        : value(v) {
+        if (v < 0) {
+            throw std::invalid_argument("negative");
+        }
+        ++live;
+    }
+    Tracked(const Tracked &other)
+        : Tracked(other.value) {}
+    Tracked(Tracked &&other) noexcept
+        : value(other.value) {
+        ++live;
+    }
+    ~Tracked() { --live; }
+};
+
+int main(void) {
+    static_assert(Layout::array<int>(10).value().size() == 40);
+
+    soa_vector<int, double, char, int> v;
+    for (int i = 0; i < 1000; ++i) {
+        v.emplace_back(i, i * 0.5, char('a' + i % 26), -i);
+    }
+    assert(v.size() == 1000);
+
+    // every column is a dense, aligned array.
+    auto b = v.column<1>();
+    assert(b.size() == 1000);
+    assert(reinterpret_cast<uintptr_t>(b.data()) % 64 == 0);
+    assert(reinterpret_cast<uintptr_t>(v.column<2>().data()) % 64 == 0);
+    assert(std::accumulate(b.begin(), b.end(), 0.0) == 0.5 * 999 * 1000 / 2);
+
+    // rows are tuples of references into the columns.
+    auto [a, d, c, e] = v[10];
+    assert(a == 10 && d == 5.0 && c == 'k' && e == -10);
+    std::get<3>(v[10]) = 42;
+    assert(v.column<3>()[10] == 42);
+
+    int sum = 0;
+    for (auto row : v) {
+        sum += std::get<0>(row);
+    }
+    assert(sum == 999 * 1000 / 2);
+
+    // non trivial fields survive growth and copies.
+    soa_vector<std::string, int> s;
+    for (int i = 0; i < 100; ++i) {
+        s.emplace_back(std::to_string(i) + " is long enough to allocate", i);
+    }
+    auto copy = s;
+    s.clear();
+    assert(copy.size() == 100 && std::get<0>(copy[99]).starts_with("99"));
+
+    // fields of the vector appended again while it grows.
+    while (copy.size() < copy.capacity()) {
+        copy.emplace_back("filler", 0);
+    }
+    size_t full = copy.capacity();
+    copy.emplace_back(std::get<0>(copy[0]), std::get<1>(copy[0]));
+    assert(copy.capacity() > full);
+    assert(std::get<0>(copy[copy.size() - 1]) == std::get<0>(copy[0]));
+
+    // a throwing field destroys the fields built before it.
+    {
+        soa_vector<Tracked, Tracked, Tracked> t;
+        t.emplace_back(1, 2, 3);
+        bool thrown = false;
+        try {
+            t.emplace_back(4, 5, -1);
+        } catch (const std::invalid_argument &) {
+            thrown = true;
+        }
+        assert(thrown && t.size() == 1 && Tracked::live == 3);
+
+        // and so does a throwing copy, for the columns already copied.
+        t.emplace_back(4, 5, 6);
+        std::get<2>(t[1]).value = -1;
+        thrown = false;
+        try {
+            auto copy = t;
+        } catch (const std::invalid_argument &) {
+            thrown = true;
+        }
+        assert(thrown && Tracked::live == 6);
+    }
+    assert(Tracked::live == 0);
+
+    std::cout << "soa vector: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "../alloy/composite_allocator.hpp"
+#include "../alloy/fixed_size_allocator.hpp"
+#include "../alloy/static_layout.hpp"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+using namespace alloy;
+
+using Node = static_layout<uint32_t, double, char[3]>;
+
+static_assert(Node::count == 3);
+static_assert(Node::size == 24 && Node::align == 8);
+static_assert(Node::offsets[0] == 0 && Node::offset<1> == 8);
+static_assert(Node::offset<2> == 16 && Node::padding == 9);
+static_assert(Node::layout == Layout::fixed<24, 8>());
+static_assert(std::is_same_v<Node::type<1>, double>);
+
+// the constants are template arguments.
+static_assert(FixedSizeAllocator<Node::size, Node::align>::layout.size() ==
+              24);
+static_assert(std::array<char, Node::offset<2>>{}.size() == 16);
+
+static_assert(Layout::of<double>() == Layout::fixed<8, 8>());
+static_assert(std::is_same_v<FixedSizeAllocatorFor<Node::type<1>>,
+                             FixedSizeAllocator<8, 8>>);
+
+// only layouts that fit a block take the compile time path.
+template <typename P, size_t Size, size_t Align>
+concept StaticFit = requires(P &p) { p.template allocate<Size, Align>(); };
+static_assert(StaticFit<FixedSizeAllocator<32, 8>, 24, 8>);
+static_assert(!StaticFit<FixedSizeAllocator<32, 8>, 64, 8>);
+static_assert(!StaticFit<FixedSizeAllocator<32, 8>, 8, 32>);
+
+constexpr size_t max = std::numeric_limits<size_t>::max();
+
+// the errors, in constant expressions.
+static_assert(Layout::try_from_size_align(8, 3).error() ==
+              LayoutError::bad_align);
+static_assert(Layout::try_from_size_align(max, 2).error() ==
+              LayoutError::overflow);
+static_assert(Layout::try_from_size_align(24, 8)->size() == 24);
+static_assert(Layout::of<int>().try_repeat(max).error() ==
+              LayoutError::overflow);
+static_assert(Layout::of<int>().try_pad_to(12).error() ==
+              LayoutError::bad_align);
+static_assert(Layout::of<int>().try_align_to(6).error() ==
+              LayoutError::bad_align);
+
+void runtime_errors() {
+    auto fail = Layout::try_from_size_align(8, 3);
+    assert(!fail && !fail.has_value());
+    assert(to_string(fail.error()) ==
+           std::string("alignment is not a power of two"));
+    bool thrown = false;
+    try {
+        (void)fail.value();
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(fail.value_or(Layout::of<char>()) == Layout::of<char>());
+
+    // errors carry through `and_then`.
+    auto l = Layout::try_from_size_align(12, 4).and_then(
+        [](Layout l) { return l.try_align_to(16); });
+    assert(l && l->align() == 16 && l->size() == 12);
+    auto e = Layout::try_from_size_align(12, 4).and_then(
+        [](Layout l) { return l.try_align_to(24); });
+    assert(!e && e.error() == LayoutError::bad_align);
+    auto o = Layout::try_from_size_align(max - 2, 1).and_then(
+        [](Layout l) { return l.try_extend(Layout::of<int>()); });
+    assert(!o && o.error() == LayoutError::overflow);
+
+    // the optional API agrees.
+    std::optional<Layout> opt = Layout::try_from_size_align(8, 3);
+    assert(!opt && !Layout::from_size_align(8, 3));
+    assert((Layout::from_size_align(8, 8) == Layout::fixed<8, 8>()));
+    auto [array, stride] = Layout::of<Node::type<2>>().repeat(5).value();
+    assert(array.size() == 15 && stride == 3);
+}
+
+void fields() {
+    alignas(Node::align) char record[Node::size];
+    std::memset(record, 0, sizeof(record));
+    *Node::field<0>(record) = 7;
+    *Node::field<1>(record) = 2.5;
+    std::memcpy(*Node::field<2>(record), "ab", 3);
+    const void *r = record;
+    assert(*Node::field<0>(r) == 7 && *Node::field<1>(r) == 2.5);
+    assert(std::strcmp(*Node::field<2>(r), "ab") == 0);
+    assert(reinterpret_cast<const char *>(Node::field<1>(r)) == record + 8);
+}
+
+// records go straight to the pool that serves them.
+void allocate_records() {
+    using Pool = FixedSizeAllocator<32, 8, HeapProvider, BasicStats>;
+    using Heap = FixedSizeAllocator<256, 16, HeapProvider, BasicStats>;
+    Segregator<32, Pool, Heap> a;
+    void *p = allocate_for<Node>(a);
+    assert(p && a.small().owns(p));
+    *Node::field<1>(p) = 1.0;
+    using Big = static_layout<Node::type<1>[8], uint64_t[4]>;
+    void *q = allocate_for<Big>(a);
+    assert(q && a.large().owns(q));
+    assert(a.small().statistics().bytes_in_use == 32);
+    deallocate_for<Node>(a, p);
+    deallocate_for<Big>(a, q);
+    assert(a.small().statistics().frees == 1);
+    assert(a.large().statistics().frees == 1);
+
+    // a pool takes the record directly, and the fit was checked when
+    // compiling.
+    Pool pool;
+    void *r = pool.allocate<Node::size, Node::align>();
+    assert(r && pool.owns(r));
+    pool.deallocate<Node::size, Node::align>(r);
+    assert(pool.statistics().bytes_in_use == 0);
+}
+
+int main() {
+    runtime_errors();
+    fields();
+    allocate_records();
+    std::cout << "static layout: ok" << std::endl;
+    return 0;
+}
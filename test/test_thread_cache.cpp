@@ -0,0 +1,160 @@
+#include "../alloy/fixed_size_allocator.hpp"
+#include "../alloy/slab_allocator.hpp"
+#include "../alloy/thread_cache.hpp"
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace alloy;
+
+struct Message {
+    uint64_t id;
+    char payload[56];
+};
+
+// blocks pushed and popped concurrently come out exactly once.
+void treiber_stack() {
+    struct Item : TreiberStack::Node {
+        int value;
+    };
+    constexpr int n_threads = 4;
+    constexpr int n_items = 10000;
+    std::vector<Item> items(n_threads * n_items);
+    TreiberStack stack;
+    for (size_t i = 0; i < items.size(); ++i) {
+        items[i].value = static_cast<int>(i);
+        stack.push(&items[i]);
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t) {
+        threads.emplace_back([&] {
+            std::vector<Item *> mine;
+            for (int round = 0; round < 100; ++round) {
+                for (int i = 0; i < 100; ++i) {
+                    if (auto p = static_cast<Item *>(stack.pop())) {
+                        mine.push_back(p);
+                    }
+                }
+                for (Item *p : mine) {
+                    stack.push(p);
+                }
+                mine.clear();
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    std::set<int> seen;
+    while (auto p = static_cast<Item *>(stack.pop())) {
+        bool inserted = seen.insert(p->value).second;
+        assert(inserted);
+    }
+    assert(seen.size() == items.size());
+    assert(stack.empty());
+}
+
+// one thread allocates, another frees: the blocks come back through the
+// depot instead of growing the pool.
+void producer_consumer() {
+    using Pool = FixedSizeAllocatorFor<Message>;
+    ThreadCache<Pool> cache(size_t(256));
+    constexpr auto layout = Pool::layout;
+    constexpr size_t n_messages = 200000;
+    constexpr size_t window = 1024;
+
+    std::mutex mutex;
+    std::vector<Message *> queue;
+    std::atomic<size_t> consumed{ 0 };
+
+    std::thread producer([&] {
+        for (size_t i = 0; i < n_messages; ++i) {
+            while (i - consumed.load(std::memory_order_acquire) >= window)
+                ;
+            auto m = static_cast<Message *>(cache.allocate(layout));
+            assert(m);
+            m->id = i;
+            std::lock_guard lock(mutex);
+            queue.push_back(m);
+        }
+    });
+    std::thread consumer([&] {
+        size_t next = 0;
+        std::vector<Message *> batch;
+        while (next < n_messages) {
+            {
+                std::lock_guard lock(mutex);
+                batch.swap(queue);
+            }
+            for (Message *m : batch) {
+                assert(m->id == next);
+                ++next;
+                cache.deallocate(m, layout);
+            }
+            consumed.store(next, std::memory_order_release);
+            batch.clear();
+        }
+    });
+    producer.join();
+    consumer.join();
+
+    // the window plus what the two caches and the depot hold in flight.
+    size_t capacity = cache.central().capacity();
+    std::cout << "pool capacity: " << capacity << std::endl;
+    assert(capacity < window + 8 * ThreadCache<Pool>::cache_size + 512);
+
+    cache.reset();
+    void *p = cache.allocate(layout);
+    assert(p && cache.owns(p));
+    cache.deallocate(p, layout);
+}
+
+// size classes of the slab allocator each get their own bin.
+void slab_front_end() {
+    ThreadCache<SlabAllocator, 64> cache;
+    constexpr int n_threads = 4;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t) {
+        threads.emplace_back([&, t] {
+            std::vector<std::pair<void *, Layout>> live;
+            for (int i = 0; i < 20000; ++i) {
+                size_t size = 1 + (i * 37 + t) % 2000;
+                auto l = Layout::from_size_align(size, 8).value();
+                void *p = cache.allocate(l);
+                assert(p && reinterpret_cast<uintptr_t>(p) % 8 == 0);
+                std::memset(p, t, size);
+                live.emplace_back(p, l);
+                if (live.size() > 100) {
+                    cache.deallocate(live.front().first, live.front().second);
+                    live.erase(live.begin());
+                }
+            }
+            for (auto [p, l] : live) {
+                cache.deallocate(p, l);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    // too large for any class: straight to the central allocator.
+    void *large = cache.allocate(Layout::from_size_align(1 << 20, 8).value());
+    assert(!large);
+}
+
+int main(void) {
+    treiber_stack();
+    producer_consumer();
+    slab_front_end();
+    std::cout << "thread cache: ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Compare two layout dumps of a record, as written by
+// `to_json(const LayoutReport &)`, and report what changed. The exit status
+// is 1 when the new layout costs more cache lines (more lines per record,
+// more in the worst unaligned placement, or a field newly straddling two
+// lines), so the tool can gate a review.
+//
+//   g++ -std=c++20 -O2 tools/layout_diff.cpp -o layout_diff
+//   ./layout_diff [--map] [--line 64] before.json after.json
+#include "../alloy/layout_report.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace alloy;
+
+static std::optional<LayoutReport> load(const char *path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "layout_diff: can't open " << path << std::endl;
+        return {};
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    auto report = layout_report_from_json(text.str());
+    if (!report) {
+        std::cerr << "layout_diff: " << path << " is not a layout report"
+                  << std::endl;
+    }
+    return report;
+}
+
+static int usage() {
+    std::cerr << "usage: layout_diff [--map] [--line bytes] before.json "
+                 "after.json"
+              << std::endl;
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    bool map = false;
+    size_t line = cache_line_size;
+    const char *paths[2] = {};
+    int n_paths = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--map") {
+            map = true;
+        } else if (arg == "--line" && i + 1 < argc) {
+            line = std::strtoull(argv[++i], nullptr, 10);
+            if (!is_power_of_two(line)) {
+                return usage();
+            }
+        } else if (n_paths < 2 && arg.size() && arg[0] != '-') {
+            paths[n_paths++] = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if (n_paths != 2) {
+        return usage();
+    }
+
+    auto before = load(paths[0]);
+    auto after = load(paths[1]);
+    if (!before || !after) {
+        return 2;
+    }
+    if (map) {
+        std::cout << "before:\n"
+                  << cache_line_map(before.value(), line) << "\n\nafter:\n"
+                  << cache_line_map(after.value(), line) << "\n\n";
+    }
+    LayoutDiff diff = diff_layouts(before.value(), after.value(), line);
+    std::cout << to_string(diff) << std::endl;
+    return diff.regressed() ? 1 : 0;
+}
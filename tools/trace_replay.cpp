@@ -0,0 +1,148 @@
+// Replay an allocation trace, recorded with `Traced<A>` and `Tracer`,
+// against one allocator configuration and report its throughput, the
+// resident memory it took and its fragmentation. One configuration per run,
+// so the resident set of one doesn't leak into the numbers of the next:
+//
+//   g++ -std=c++20 -O2 tools/trace_replay.cpp -o trace_replay -pthread
+//   for a in malloc slab bump linked-list; do
+//       ./trace_replay $a app.trace
+//   done
+//
+// `--chunk bytes` sets the chunk size of the arenas, `--no-touch` leaves
+// the blocks alone, `--list` prints the configurations. To try other size
+// classes or compositions, add a line to `configurations`.
+#include "../alloy/alloy.h"
+#include "../alloy/allocation_trace.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace alloy;
+
+struct Malloc {
+    void *allocate(Layout l) noexcept {
+        if (l.align() <= alignof(std::max_align_t)) {
+            return std::malloc(l.size());
+        }
+        return std::aligned_alloc(l.align(), align_up(l.size(), l.align()));
+    }
+    void deallocate(void *p, Layout) noexcept { std::free(p); }
+    bool owns(const void *) noexcept { return false; }
+    void reset() noexcept {}
+};
+
+template <size_t S> using Pool = FixedSizeAllocator<S>;
+
+using Heap = LinkedListAllocator<FitPolicy::first_fit, PageProvider>;
+using Large = Segregator<(1 << 20), Heap, ProviderAllocator<PageProvider>>;
+using Segregated = Segregator<256, Bucketizer<32, 256, Pool>, Large>;
+
+// the free list heaps get a region of `heap_size` bytes.
+constexpr size_t heap_size = size_t(1) << 30;
+
+struct Config {
+    const char *name;
+    std::function<ReplayReport(std::span<const TraceEvent>, size_t,
+                               ReplayOptions)>
+        run;
+};
+
+template <typename A, typename... Args>
+static ReplayReport run(std::span<const TraceEvent> events,
+                        ReplayOptions options, Args &&...args) {
+    A allocator(std::forward<Args>(args)...);
+    return replay(events, allocator, options);
+}
+
+static const std::vector<Config> configurations = {
+    { "malloc",
+      [](auto events, size_t, auto options) {
+          return run<Malloc>(events, options);
+      } },
+    { "bump",
+      [](auto events, size_t chunk, auto options) {
+          return run<BumpAllocator>(events, options, chunk);
+      } },
+    { "concurrent-bump",
+      [](auto events, size_t chunk, auto options) {
+          return run<ConcurrentBumpAllocator>(events, options, chunk);
+      } },
+    { "slab",
+      [](auto events, size_t, auto options) {
+          return run<SlabAllocator>(events, options);
+      } },
+    { "cached-slab",
+      [](auto events, size_t, auto options) {
+          return run<ThreadCache<SlabAllocator>>(events, options);
+      } },
+    { "linked-list",
+      [](auto events, size_t, auto options) {
+          return run<Heap>(events, options, heap_size);
+      } },
+    { "best-fit",
+      [](auto events, size_t, auto options) {
+          return run<LinkedListAllocator<FitPolicy::best_fit, PageProvider>>(
+              events, options, heap_size);
+      } },
+    { "segregated",
+      [](auto events, size_t, auto options) {
+          return run<Segregated>(
+              events, options, Bucketizer<32, 256, Pool>(),
+              Large(Heap(heap_size), ProviderAllocator<PageProvider>()));
+      } },
+};
+
+static int usage() {
+    std::cerr << "usage: trace_replay [--list] [--chunk bytes] [--no-touch] "
+                 "allocator trace"
+              << std::endl;
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    size_t chunk = BumpAllocator::default_chunk_size;
+    ReplayOptions options;
+    std::vector<const char *> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--list") {
+            for (auto &c : configurations) {
+                std::cout << c.name << "\n";
+            }
+            return 0;
+        } else if (arg == "--chunk" && i + 1 < argc) {
+            chunk = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--no-touch") {
+            options.touch = false;
+        } else if (arg.size() && arg[0] != '-') {
+            args.push_back(argv[i]);
+        } else {
+            return usage();
+        }
+    }
+    if (args.size() != 2) {
+        return usage();
+    }
+
+    auto config = std::find_if(
+        configurations.begin(), configurations.end(),
+        [&](const Config &c) { return std::string(c.name) == args[0]; });
+    if (config == configurations.end()) {
+        std::cerr << "trace_replay: no configuration " << args[0]
+                  << ", see --list" << std::endl;
+        return 2;
+    }
+    auto trace = RecordReader<TraceEvent>::open(args[1]);
+    if (!trace) {
+        std::cerr << "trace_replay: " << args[1] << " is not a trace"
+                  << std::endl;
+        return 2;
+    }
+
+    ReplayReport report = config->run(trace->records(), chunk, options);
+    std::cout << config->name << ": " << to_string(report) << std::endl;
+    return 0;
+}